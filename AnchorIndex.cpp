@@ -0,0 +1,736 @@
+// Persistent sorted index of "anchor" addresses for the FindNext/PrevXRef commands.
+// Per segment a sorted array of anchor offsets, plus a parallel bitset per filter mode.
+// Built per segment on first use, kept up to date through IDB/IDP events, and saved with the database.
+// A loaded segment index is checked with a flags sweep on its first use, and rebuilt if the database was edited without the plugin.
+#include "StdAfx.h"
+#include "AnchorIndex.h"
+#include "LongScan.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+// Netnode the index is persisted in
+static const char NETNODE_NAME[] = "$ utilityfeature.anchors";
+static const uchar BLOB_TAG = 'A';
+static const UINT32 INDEX_VERSION = 1;
+
+// Cap on queued event addresses before we give up and invalidate everything instead.
+// Initial auto-analysis easily creates millions of xrefs.
+static const size_t PENDING_MAX = 0x100000;
+
+static const size_t NO_BIT = (size_t) -1;
+
+// Compact bitset that supports insert/erase at an index so it can be kept parallel to a sorted array
+class BITSET
+{
+public:
+	void clear() { words.clear(); }
+	void resize(size_t bits) { words.resize((bits + 63) / 64, 0); }
+
+	BOOL test(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+	void set(size_t i, BOOL v)
+	{
+		UINT64 bit = (1ull << (i & 63));
+		if (v)
+			words[i >> 6] |= bit;
+		else
+			words[i >> 6] &= ~bit;
+	}
+
+	// Insert a bit at 'i', shifting the bits above up by one. 'size' is the bit count before the insert.
+	void insert(size_t i, size_t size, BOOL v)
+	{
+		resize(size + 1);
+		size_t wi = (i >> 6);
+		for (size_t k = (words.size() - 1); k > wi; k--)
+			words[k] = ((words[k] << 1) | (words[k - 1] >> 63));
+
+		UINT32 b = (UINT32) (i & 63);
+		UINT64 lowMask = ((1ull << b) - 1);
+		UINT64 w = words[wi];
+		words[wi] = ((w & lowMask) | ((w & ~lowMask) << 1) | ((UINT64) (v != 0) << b));
+	}
+
+	// Remove the bit at 'i', shifting the bits above down by one. 'size' is the bit count before the erase.
+	void erase(size_t i, size_t size)
+	{
+		size_t wi = (i >> 6);
+		UINT32 b = (UINT32) (i & 63);
+		UINT64 lowMask = ((1ull << b) - 1);
+		UINT64 w = words[wi];
+		words[wi] = ((w & lowMask) | ((w >> 1) & ~lowMask));
+		for (size_t k = wi; (k + 1) < words.size(); k++)
+		{
+			words[k] |= ((words[k + 1] & 1) << 63);
+			words[k + 1] >>= 1;
+		}
+		resize(size - 1);
+	}
+
+	// Index of the first set bit at or after 'i', or NO_BIT
+	size_t next(size_t i, size_t size) const
+	{
+		if (i >= size)
+			return NO_BIT;
+		size_t wi = (i >> 6);
+		UINT64 w = (words[wi] & (~0ull << (i & 63)));
+		for (;;)
+		{
+			if (w)
+			{
+				DWORD bit;
+				_BitScanForward64(&bit, w);
+				size_t index = ((wi << 6) + bit);
+				return((index < size) ? index : NO_BIT);
+			}
+			if (++wi >= words.size())
+				return NO_BIT;
+			w = words[wi];
+		}
+	}
+
+	// Index of the last set bit at or before 'i', or NO_BIT
+	size_t prev(size_t i) const
+	{
+		if (i == NO_BIT)
+			return NO_BIT;
+		size_t wi = (i >> 6);
+		UINT32 b = (UINT32) (i & 63);
+		UINT64 w = (words[wi] & ((b == 63) ? ~0ull : ((2ull << b) - 1)));
+		for (;;)
+		{
+			if (w)
+			{
+				DWORD bit;
+				_BitScanReverse64(&bit, w);
+				return((wi << 6) + bit);
+			}
+			if (wi-- == 0)
+				return NO_BIT;
+			w = words[wi];
+		}
+	}
+
+	std::vector<UINT64> words;
+};
+
+// Anchor kind bits
+enum
+{
+	KIND_CODEREF  = (1 << 0),
+	KIND_DATAREF  = (1 << 1),
+	KIND_USERNAME = (1 << 2),
+};
+
+// Anchors of a single segment
+struct SEGANCHORS
+{
+	ea_t startEa, endEa;
+	std::vector<UINT32> offsets; // Sorted anchor offsets from 'startEa'
+	BITSET codeBits;             // Parallel to 'offsets', one per filter mode
+	BITSET dataBits;
+	BITSET userBits;
+	BOOL verified;               // Checked against the database, a loaded index can be stale from edits made without the plugin
+
+	BITSET *bits(ANCHOR_MODE mode)
+	{
+		switch (mode)
+		{
+			case ANCHOR_CODEREF:  return &codeBits;
+			case ANCHOR_DATAREF:  return &dataBits;
+			case ANCHOR_USERNAME: return &userBits;
+		};
+		return NULL;
+	}
+};
+typedef std::map<ea_t, SEGANCHORS> SEGMAP;
+
+static SEGMAP s_segments;          // Keyed by segment start address
+static std::vector<ea_t> s_pending; // Addresses with possibly changed anchor state
+static BOOL s_loaded = FALSE;      // Persisted index loaded for the current database
+static BOOL s_dirty = FALSE;       // Index changed since the last save
+static LONGSCAN s_longScan = LONGSCAN_BLOCK; // Long build/scan handling of the current lookup
+static BOOL s_stopped = FALSE;     // The current lookup's build or scan was cancelled or gave up
+
+// ======================================================================================
+
+static bool idaapi isAnchorFlags(flags64_t flags, void *ud)
+{
+	return((flags & (FF_REF | FF_NAME | FF_LABL)) != 0);
+}
+
+// Get anchor kind bits of an address
+static UINT32 getAnchorKind(ea_t ea, flags64_t flags)
+{
+	UINT32 kind = 0;
+	if (flags & FF_REF)
+	{
+		xrefblk_t xb;
+		for (bool ok = xb.first_to(ea, XREF_NOFLOW); ok; ok = xb.next_to())
+		{
+			kind |= (xb.iscode ? KIND_CODEREF : KIND_DATAREF);
+			if (kind == (KIND_CODEREF | KIND_DATAREF))
+				break;
+		}
+	}
+	if (has_user_name(flags))
+		kind |= KIND_USERNAME;
+	return kind;
+}
+
+// Index a segment with a single flags sweep.
+// The sweep is all SDK calls so it stays on this thread, past the long scan threshold with progress and cancel.
+// Returns FALSE if it was stopped, the partial index is then dropped.
+static BOOL buildSegment(segment_t *seg, SEGANCHORS &sa)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	sa.startEa = seg->start_ea;
+	sa.endEa = seg->end_ea;
+	sa.verified = TRUE;
+	sa.offsets.clear();
+	sa.codeBits.clear();
+	sa.dataBits.clear();
+	sa.userBits.clear();
+
+	std::vector<BYTE> kinds;
+	LongScanState state(s_longScan, seg->start_ea, seg->end_ea);
+	ea_t ea = seg->start_ea;
+	if (!isAnchorFlags(get_flags(ea), NULL))
+		ea = next_that(ea, seg->end_ea, isAnchorFlags);
+	while (ea != BADADDR)
+	{
+		sa.offsets.push_back((UINT32) (ea - seg->start_ea));
+		kinds.push_back((BYTE) getAnchorKind(ea, get_flags(ea)));
+		if (((sa.offsets.size() % 4096) == 0) && !state.Check(ea))
+		{
+			s_stopped = TRUE;
+			return FALSE;
+		}
+		ea = next_that(ea, seg->end_ea, isAnchorFlags);
+	};
+	TELEMETRY_ADD(TC_GET_FLAGS, (sa.offsets.size() + 1));
+	TELEMETRY_ADD(TC_NEXT_THAT, (sa.offsets.size() + 1));
+	TELEMETRY_ADD(TC_ADDRESSES, seg->size());
+
+	size_t count = sa.offsets.size();
+	sa.codeBits.resize(count);
+	sa.dataBits.resize(count);
+	sa.userBits.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		sa.codeBits.set(i, kinds[i] & KIND_CODEREF);
+		sa.dataBits.set(i, kinds[i] & KIND_DATAREF);
+		sa.userBits.set(i, kinds[i] & KIND_USERNAME);
+	}
+	s_dirty = TRUE;
+
+	TIMESTAMP buildTime = (GetTimeStamp() - startTime);
+	if (buildTime >= 0.5)
+	{
+		qstring segName;
+		get_segm_name(&segName, seg);
+		char buffer[32];
+		msg("Utility: Indexed %s anchors in segment \"%s\" in %s.\n", NumberCommaString(count, buffer), segName.c_str(), TimeString(buildTime));
+	}
+	return TRUE;
+}
+
+// ======================================================================================
+
+static void saveIndex()
+{
+	std::vector<BYTE> blob;
+	auto put = [&blob](const void *data, size_t size) { blob.insert(blob.end(), (PBYTE) data, ((PBYTE) data + size)); };
+
+	UINT32 header[2] = { INDEX_VERSION, (UINT32) s_segments.size() };
+	put(header, sizeof(header));
+	for (auto &it : s_segments)
+	{
+		SEGANCHORS &sa = it.second;
+		UINT64 range[2] = { sa.startEa, sa.endEa };
+		UINT32 count = (UINT32) sa.offsets.size();
+		put(range, sizeof(range));
+		put(&count, sizeof(count));
+		put(sa.offsets.data(), (count * sizeof(UINT32)));
+		put(sa.codeBits.words.data(), (sa.codeBits.words.size() * sizeof(UINT64)));
+		put(sa.dataBits.words.data(), (sa.dataBits.words.size() * sizeof(UINT64)));
+		put(sa.userBits.words.data(), (sa.userBits.words.size() * sizeof(UINT64)));
+	}
+
+	netnode node(NETNODE_NAME, 0, true);
+	node.delblob(0, BLOB_TAG);
+	node.setblob(blob.data(), blob.size(), 0, BLOB_TAG);
+	s_dirty = FALSE;
+}
+
+static void loadIndex()
+{
+	s_loaded = TRUE;
+	netnode node(NETNODE_NAME);
+	if (node == BADNODE)
+		return;
+
+	bytevec_t blob;
+	if (node.getblob(&blob, 0, BLOB_TAG) <= 0)
+		return;
+
+	const BYTE *p = blob.begin(), *end = blob.end();
+	auto get = [&p, end](void *data, size_t size) -> BOOL
+	{
+		if ((size_t) (end - p) < size)
+			return FALSE;
+		memcpy(data, p, size);
+		p += size;
+		return TRUE;
+	};
+
+	UINT32 header[2];
+	if (!get(header, sizeof(header)) || (header[0] != INDEX_VERSION))
+		return;
+
+	for (UINT32 i = 0; i < header[1]; i++)
+	{
+		UINT64 range[2];
+		UINT32 count;
+		if (!get(range, sizeof(range)) || !get(&count, sizeof(count)))
+			break;
+
+		SEGANCHORS sa;
+		sa.startEa = (ea_t) range[0];
+		sa.endEa = (ea_t) range[1];
+		sa.verified = FALSE;
+		sa.offsets.resize(count);
+		sa.codeBits.resize(count);
+		sa.dataBits.resize(count);
+		sa.userBits.resize(count);
+		size_t bitsSize = (sa.codeBits.words.size() * sizeof(UINT64));
+		if (!get(sa.offsets.data(), (count * sizeof(UINT32))) ||
+			!get(sa.codeBits.words.data(), bitsSize) ||
+			!get(sa.dataBits.words.data(), bitsSize) ||
+			!get(sa.userBits.words.data(), bitsSize))
+		{
+			msg("Utility: ** Anchor index data is corrupt, rebuilding. **\n");
+			s_segments.clear();
+			return;
+		}
+
+		// Only keep it if the segment still matches, otherwise it gets rebuilt on demand
+		segment_t *seg = getseg(sa.startEa);
+		if (seg && (seg->start_ea == sa.startEa) && (seg->end_ea == sa.endEa))
+			s_segments[sa.startEa] = std::move(sa);
+	}
+}
+
+static void resetIndex()
+{
+	s_segments.clear();
+	s_pending.clear();
+	s_loaded = s_dirty = FALSE;
+}
+
+// ======================================================================================
+
+// Re-evaluate a single address in its segment index
+static void updateAddress(ea_t ea)
+{
+	SEGMAP::iterator it = s_segments.upper_bound(ea);
+	if (it == s_segments.begin())
+		return;
+	SEGANCHORS &sa = (--it)->second;
+	if (ea >= sa.endEa)
+		return;
+
+	flags64_t flags = get_flags(ea);
+	BOOL isAnchor = isAnchorFlags(flags, NULL);
+	UINT32 offset = (UINT32) (ea - sa.startEa);
+	std::vector<UINT32>::iterator pos = std::lower_bound(sa.offsets.begin(), sa.offsets.end(), offset);
+	size_t index = (pos - sa.offsets.begin());
+	size_t count = sa.offsets.size();
+	BOOL present = ((pos != sa.offsets.end()) && (*pos == offset));
+
+	if (isAnchor)
+	{
+		UINT32 kind = getAnchorKind(ea, flags);
+		if (!present)
+		{
+			sa.offsets.insert(pos, offset);
+			sa.codeBits.insert(index, count, kind & KIND_CODEREF);
+			sa.dataBits.insert(index, count, kind & KIND_DATAREF);
+			sa.userBits.insert(index, count, kind & KIND_USERNAME);
+		}
+		else
+		{
+			sa.codeBits.set(index, kind & KIND_CODEREF);
+			sa.dataBits.set(index, kind & KIND_DATAREF);
+			sa.userBits.set(index, kind & KIND_USERNAME);
+		}
+		s_dirty = TRUE;
+	}
+	else
+	if (present)
+	{
+		sa.offsets.erase(pos);
+		sa.codeBits.erase(index, count);
+		sa.dataBits.erase(index, count);
+		sa.userBits.erase(index, count);
+		s_dirty = TRUE;
+	}
+}
+
+// Apply queued event changes
+static void flushPending()
+{
+	if (!s_loaded)
+		loadIndex();
+
+	if (!s_pending.empty())
+	{
+		std::sort(s_pending.begin(), s_pending.end());
+		s_pending.erase(std::unique(s_pending.begin(), s_pending.end()), s_pending.end());
+		for (ea_t ea : s_pending)
+			updateAddress(ea);
+		s_pending.clear();
+	}
+}
+
+static void queueAddress(ea_t ea)
+{
+	if (s_pending.size() < PENDING_MAX)
+		s_pending.push_back(ea);
+	else
+	{
+		// Too many changes to track, just drop the index and rebuild it on demand
+		s_segments.clear();
+		s_pending.clear();
+		s_loaded = s_dirty = TRUE;
+	}
+}
+
+// Invalidate any segment index that overlaps the given range
+static void invalidateRange(ea_t startEa, ea_t endEa)
+{
+	for (SEGMAP::iterator it = s_segments.begin(); it != s_segments.end();)
+	{
+		if ((it->second.startEa < endEa) && (startEa < it->second.endEa))
+		{
+			it = s_segments.erase(it);
+			s_dirty = TRUE;
+		}
+		else
+			++it;
+	}
+}
+
+// Check a loaded segment index against the database with one flags sweep, without the xref walks of a build.
+// The anchor offsets and user name bits have to match. Returns FALSE if they don't or the sweep was stopped.
+static BOOL verifySegment(segment_t *seg, const SEGANCHORS &sa)
+{
+	LongScanState state(s_longScan, seg->start_ea, seg->end_ea);
+	size_t index = 0, count = sa.offsets.size();
+	ea_t ea = seg->start_ea;
+	if (!isAnchorFlags(get_flags(ea), NULL))
+		ea = next_that(ea, seg->end_ea, isAnchorFlags);
+	while (ea != BADADDR)
+	{
+		if ((index >= count) || (sa.offsets[index] != (UINT32) (ea - seg->start_ea)) || (!sa.userBits.test(index) != !has_user_name(get_flags(ea))))
+			return FALSE;
+		if (((++index % 4096) == 0) && !state.Check(ea))
+		{
+			s_stopped = TRUE;
+			return FALSE;
+		}
+		ea = next_that(ea, seg->end_ea, isAnchorFlags);
+	};
+	TELEMETRY_ADD(TC_GET_FLAGS, ((index * 2) + 1));
+	TELEMETRY_ADD(TC_NEXT_THAT, (index + 1));
+	TELEMETRY_ADD(TC_ADDRESSES, seg->size());
+	return(index == count);
+}
+
+// Get a segment's anchors, building them if needed.
+// Returns NULL for segments too large for 32bit offsets, these are scanned directly instead, or if the build was stopped.
+static SEGANCHORS *getSegAnchors(segment_t *seg)
+{
+	if (seg->size() > 0xFFFFFFFF)
+		return NULL;
+
+	SEGMAP::iterator it = s_segments.find(seg->start_ea);
+	if ((it != s_segments.end()) && (it->second.endEa == seg->end_ea))
+	{
+		SEGANCHORS &sa = it->second;
+		if (sa.verified)
+			return &sa;
+
+		// First use since loaded
+		if (verifySegment(seg, sa))
+		{
+			sa.verified = TRUE;
+			return &sa;
+		}
+		if (s_stopped)
+			return NULL;
+		qstring segName;
+		get_segm_name(&segName, seg);
+		msg("Utility: Anchor index of segment \"%s\" is out of date, rebuilding.\n", segName.c_str());
+	}
+
+	SEGANCHORS &sa = s_segments[seg->start_ea];
+	if (!buildSegment(seg, sa))
+	{
+		s_segments.erase(seg->start_ea);
+		return NULL;
+	}
+	return &sa;
+}
+
+// ======================================================================================
+
+static bool idaapi isRefFlags(flags64_t flags, void *ud) { return((flags & FF_REF) != 0); }
+static bool idaapi isUserNameFlags(flags64_t flags, void *ud) { return has_user_name(flags); }
+
+// Return TRUE if the address is an anchor of the given mode
+static BOOL isModeAnchor(ea_t ea, ANCHOR_MODE mode)
+{
+	flags64_t flags = get_flags(ea);
+	TELEMETRY_COUNT(TC_GET_FLAGS);
+	switch (mode)
+	{
+		case ANCHOR_ANY:      return isAnchorFlags(flags, NULL);
+		case ANCHOR_USERNAME: return has_user_name(flags);
+		case ANCHOR_CODEREF:  return((getAnchorKind(ea, flags) & KIND_CODEREF) != 0);
+		case ANCHOR_DATAREF:  return((getAnchorKind(ea, flags) & KIND_DATAREF) != 0);
+	};
+	return FALSE;
+}
+
+// Direct scan fallback for unindexed segments, exclusive of 'ea'
+static ea_t scanSegment(segment_t *seg, ea_t ea, ANCHOR_MODE mode, BOOL forward)
+{
+	testf_t *testf = ((mode == ANCHOR_ANY) ? isAnchorFlags : ((mode == ANCHOR_USERNAME) ? isUserNameFlags : isRefFlags));
+	LongScanState state(s_longScan, ea, (forward ? seg->end_ea : seg->start_ea));
+	for (;;)
+	{
+		if (!state.Check(ea))
+		{
+			s_stopped = TRUE;
+			return BADADDR;
+		}
+		#ifdef UTILITY_TELEMETRY
+		ea_t from = ea;
+		#endif
+		ea = (forward ? next_that(ea, seg->end_ea, testf) : prev_that(ea, seg->start_ea, testf));
+		TELEMETRY_COUNT(TC_NEXT_THAT);
+		TELEMETRY_ADD(TC_ADDRESSES, ((ea != BADADDR) ? ((ea > from) ? (ea - from) : (from - ea)) : (forward ? (seg->end_ea - from) : (from - seg->start_ea))));
+		if ((ea == BADADDR) || isModeAnchor(ea, mode))
+			return ea;
+	};
+}
+
+// Find first anchor in segment at or after 'ea'
+static ea_t segmentNext(segment_t *seg, ea_t ea, ANCHOR_MODE mode)
+{
+	SEGANCHORS *sa = getSegAnchors(seg);
+	if (!sa)
+		return(s_stopped ? BADADDR : (isModeAnchor(ea, mode) ? ea : scanSegment(seg, ea, mode, TRUE)));
+
+	UINT32 offset = (UINT32) (ea - sa->startEa);
+	size_t index = (std::lower_bound(sa->offsets.begin(), sa->offsets.end(), offset) - sa->offsets.begin());
+	size_t count = sa->offsets.size();
+	if (BITSET *bits = sa->bits(mode))
+		index = bits->next(index, count);
+	if ((index == NO_BIT) || (index >= count))
+		return BADADDR;
+	return(sa->startEa + sa->offsets[index]);
+}
+
+// Find last anchor in segment at or before 'ea'
+static ea_t segmentPrev(segment_t *seg, ea_t ea, ANCHOR_MODE mode)
+{
+	SEGANCHORS *sa = getSegAnchors(seg);
+	if (!sa)
+		return(s_stopped ? BADADDR : scanSegment(seg, (ea + 1), mode, FALSE));
+
+	UINT32 offset = (UINT32) (ea - sa->startEa);
+	size_t index = (std::upper_bound(sa->offsets.begin(), sa->offsets.end(), offset) - sa->offsets.begin());
+	if (index == 0)
+		return BADADDR;
+	index--;
+	if (BITSET *bits = sa->bits(mode))
+		index = bits->prev(index);
+	if (index == NO_BIT)
+		return BADADDR;
+	return(sa->startEa + sa->offsets[index]);
+}
+
+ea_t AnchorIndexNext(ea_t ea, ANCHOR_MODE mode, LONGSCAN longScan, BOOL *stopped)
+{
+	flushPending();
+	if (stopped)
+		*stopped = FALSE;
+
+	// Start in the containing segment, or else the next one
+	int n = get_segm_num(ea);
+	if (n < 0)
+	{
+		segment_t *seg = get_next_seg(ea);
+		if (!seg)
+			return BADADDR;
+		n = get_segm_num(seg->start_ea);
+	}
+
+	s_longScan = longScan;
+	s_stopped = FALSE;
+	ea_t result = BADADDR;
+
+	int segCount = get_segm_qty();
+	for (; (n < segCount) && !s_stopped; n++)
+	{
+		segment_t *seg = getnseg(n);
+		ea_t from = ((ea >= seg->start_ea) ? (ea + 1) : seg->start_ea);
+		if (from >= seg->end_ea)
+			continue;
+		result = segmentNext(seg, from, mode);
+		if (result != BADADDR)
+			break;
+	}
+
+	if (stopped)
+		*stopped = s_stopped;
+	s_longScan = LONGSCAN_BLOCK;
+	return result;
+}
+
+ea_t AnchorIndexPrev(ea_t ea, ANCHOR_MODE mode, LONGSCAN longScan, BOOL *stopped)
+{
+	flushPending();
+	if (stopped)
+		*stopped = FALSE;
+
+	// Start in the containing segment, or else the previous one
+	int n = get_segm_num(ea);
+	if (n < 0)
+	{
+		segment_t *seg = get_prev_seg(ea);
+		if (!seg)
+			return BADADDR;
+		n = get_segm_num(seg->start_ea);
+	}
+
+	s_longScan = longScan;
+	s_stopped = FALSE;
+	ea_t result = BADADDR;
+
+	for (; (n >= 0) && !s_stopped; n--)
+	{
+		segment_t *seg = getnseg(n);
+		if (ea <= seg->start_ea)
+			continue;
+		ea_t from = ((ea < seg->end_ea) ? (ea - 1) : (seg->end_ea - 1));
+		result = segmentPrev(seg, from, mode);
+		if (result != BADADDR)
+			break;
+	}
+
+	if (stopped)
+		*stopped = s_stopped;
+	s_longScan = LONGSCAN_BLOCK;
+	return result;
+}
+
+// ======================================================================================
+
+// Track changes that can affect anchor state
+struct anchor_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
+		{
+			case idb_event::renamed:
+			queueAddress(va_arg(va, ea_t));
+			break;
+
+			case idb_event::segm_added:
+			{
+				segment_t *seg = va_arg(va, segment_t*);
+				invalidateRange(seg->start_ea, seg->end_ea);
+			}
+			break;
+
+			case idb_event::segm_deleted:
+			{
+				ea_t startEa = va_arg(va, ea_t);
+				ea_t endEa = va_arg(va, ea_t);
+				invalidateRange(startEa, endEa);
+			}
+			break;
+
+			case idb_event::segm_start_changed:
+			case idb_event::segm_end_changed:
+			{
+				segment_t *seg = va_arg(va, segment_t*);
+				ea_t oldEa = va_arg(va, ea_t);
+				invalidateRange(std::min(seg->start_ea, oldEa), std::max(seg->end_ea, oldEa));
+			}
+			break;
+
+			case idb_event::segm_moved:
+			case idb_event::allsegs_moved:
+			s_segments.clear();
+			s_pending.clear();
+			s_loaded = s_dirty = TRUE;
+			break;
+
+			case idb_event::savebase:
+			if (s_dirty)
+			{
+				flushPending();
+				saveIndex();
+			}
+			break;
+
+			case idb_event::closebase:
+			resetIndex();
+			break;
+		};
+		return 0;
+	}
+};
+
+// Xref changes come from the processor module side
+struct anchor_idp_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
+		{
+			case processor_t::ev_add_cref:
+			case processor_t::ev_add_dref:
+			case processor_t::ev_del_cref:
+			case processor_t::ev_del_dref:
+			{
+				va_arg(va, ea_t);
+				queueAddress(va_arg(va, ea_t));
+			}
+			break;
+		};
+		return 0;
+	}
+};
+
+static anchor_listener_t s_idbListener;
+static anchor_idp_listener_t s_idpListener;
+
+void AnchorIndexInit()
+{
+	hook_event_listener(HT_IDB, &s_idbListener);
+	hook_event_listener(HT_IDP, &s_idpListener);
+}
+
+void AnchorIndexTerm()
+{
+	unhook_event_listener(HT_IDP, &s_idpListener);
+	unhook_event_listener(HT_IDB, &s_idbListener);
+	resetIndex();
+}
@@ -0,0 +1,21 @@
+// Persistent sorted index of "anchor" addresses (addresses with an xref, name or label)
+// Used by the FindNext/PrevXRef commands to jump with a binary search instead of walking every address.
+#pragma once
+#include "LongScan.h"
+
+// Anchor filter modes
+enum ANCHOR_MODE
+{
+	ANCHOR_ANY,      // Any xref, name or label (the original FindNext/PrevXRef behavior)
+	ANCHOR_CODEREF,  // Only addresses with a code xref to them
+	ANCHOR_DATAREF,  // Only addresses with a data xref to them
+	ANCHOR_USERNAME, // Only addresses with a user defined name
+};
+
+void AnchorIndexInit();
+void AnchorIndexTerm();
+
+// Return the next/previous anchor address from 'ea' (exclusive), or BADADDR if none.
+// 'longScan' is what to do if a segment index build or direct scan runs long, 'stopped' is set if it was cancelled or gave up.
+ea_t AnchorIndexNext(ea_t ea, ANCHOR_MODE mode, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+ea_t AnchorIndexPrev(ea_t ea, ANCHOR_MODE mode, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
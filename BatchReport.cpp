@@ -0,0 +1,90 @@
+// Headless batch run for processing a corpus of databases.
+// Invoked from an IDA batch session (see "BatchRun.py") by the plugin's batch commands.
+#include "StdAfx.h"
+#include "BatchReport.h"
+#include "StubRenamer.h"
+#include "DataFill.h"
+
+// Append a quoted and escaped JSON string
+static void jsonString(qstring &out, LPCSTR str)
+{
+	out.append('"');
+	for (; *str; str++)
+	{
+		BYTE c = (BYTE) *str;
+		if ((c == '"') || (c == '\\'))
+		{
+			out.append('\\');
+			out.append((char) c);
+		}
+		else
+		if (c < ' ')
+			out.cat_sprnt("\\u%04X", c);
+		else
+			out.append((char) c);
+	}
+	out.append('"');
+}
+
+void RunBatchReport(BOOL survey)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	msg("Utility: Batch run:\n");
+
+	STUBNAMERSTATS stats = STUBNAMERSTATS();
+	RunStubNamer(TRUE, &stats);
+
+	FILLSURVEY fill = {};
+	if (survey)
+	{
+		SurveyFillRuns(fill);
+		char buffer[32];
+		msg(" Data fill survey: %u runs, %s bytes, %u struct runs, in %s.\n", fill.runs, NumberCommaString(fill.bytes, buffer), fill.structRuns, TimeString(fill.time));
+	}
+
+	char inputPath[QMAXPATH] = {};
+	get_input_file_path(inputPath, sizeof(inputPath));
+	LPCSTR idbPath = get_path(PATH_TYPE_IDB);
+
+	qstring json;
+	json.append("{\n  \"database\": ");
+	jsonString(json, idbPath);
+	json.append(",\n  \"input\": ");
+	jsonString(json, inputPath);
+	json.cat_sprnt(",\n  \"bits\": %u,\n", (plat.is64 ? 64 : 32));
+	json.cat_sprnt("  \"functions\": %u,\n  \"candidates\": %u,\n  \"named\": %u,\n  \"fingerprintNamed\": %u,\n", stats.functions, stats.candidates, stats.named, stats.fingerprintNamed);
+	json.append("  \"patterns\": {");
+	for (size_t i = 0; i < stats.prefixes.size(); i++)
+	{
+		json.append((i == 0) ? "\n    " : ",\n    ");
+		jsonString(json, stats.prefixes[i].first.c_str());
+		json.cat_sprnt(": %u", stats.prefixes[i].second);
+	}
+	json.append("\n  },\n");
+	json.cat_sprnt("  \"times\": {\n    \"compile\": %.6f,\n    \"snapshot\": %.6f,\n    \"classify\": %.6f,\n    \"nameIndex\": %.6f,\n    \"rename\": %.6f,\n    \"fingerprints\": %.6f,\n    \"stubNamer\": %.6f",
+		stats.compileTime, stats.snapshotTime, stats.classifyTime, stats.nameIndexTime, stats.renameTime, stats.fingerprintTime, stats.totalTime);
+	if (survey)
+		json.cat_sprnt(",\n    \"fillSurvey\": %.6f", fill.time);
+	json.cat_sprnt(",\n    \"total\": %.6f\n  }", (GetTimeStamp() - startTime));
+	if (survey)
+		json.cat_sprnt(",\n  \"fillSurvey\": {\n    \"runs\": %u,\n    \"bytes\": %llu,\n    \"structRuns\": %u\n  }", fill.runs, fill.bytes, fill.structRuns);
+	json.append("\n}\n");
+
+	// Report path
+	qstring reportPath;
+	if (!qgetenv("UTILITY_REPORT", &reportPath) || reportPath.empty())
+	{
+		reportPath = idbPath;
+		reportPath.append(".utility.json");
+	}
+
+	FILE *fp = fopen(reportPath.c_str(), "wb");
+	if (fp)
+	{
+		fwrite(json.c_str(), json.length(), 1, fp);
+		fclose(fp);
+		msg(" Report: \"%s\".\n", reportPath.c_str());
+	}
+	else
+		msg("Utility: ** Failed to write report \"%s\". **\n", reportPath.c_str());
+}
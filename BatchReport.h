@@ -0,0 +1,6 @@
+// Headless batch run for processing a corpus of databases, see "BatchRun.py"
+#pragma once
+
+// Run the stub namer, and the data fill survey if 'survey', with no UI.
+// Writes a JSON report to the "UTILITY_REPORT" environment variable path, or else next to the IDB.
+void RunBatchReport(BOOL survey);
@@ -0,0 +1,167 @@
+"""
+Batch run the Utility plugin stub namer, and optionally the data fill survey, over a corpus of IDA databases.
+
+Run from a command line, not from inside IDA:
+    python BatchRun.py --ida "C:\\Program Files\\IDA Professional 9.0\\idat.exe" --out reports D:\\IDBs
+    python BatchRun.py --ida idat --survey --save a.i64 b.idb ...
+
+Each database is opened headless with "idat -A -S<this script>". Inside IDA this same script waits for auto-analysis,
+runs the plugin's batch command, and exits. The plugin writes a JSON report per database, and at the end the reports
+are summed up into throughput and per-pattern hit rates.
+Databases are not saved unless "--save" is given, so an archive can be measured without changing it: the run exits
+with the database flagged to be discarded, and each database is checked to be unchanged afterwards.
+"""
+import argparse
+import glob
+import hashlib
+import json
+import os
+import subprocess
+import sys
+import time
+
+PLUGIN_NAME = "IDA_UtilityFeature"
+CMD_BATCH_STUB_NAMER = 19
+CMD_BATCH_SURVEY = 20
+IDB_EXTENSIONS = (".idb", ".i64")
+
+
+def run_in_ida():
+    """Inside IDA: run the batch command on the open database and exit."""
+    import ida_auto
+    import ida_loader
+    import ida_pro
+
+    ida_auto.auto_wait()
+    command = CMD_BATCH_SURVEY if os.environ.get("UTILITY_BATCH_SURVEY") == "1" else CMD_BATCH_STUB_NAMER
+    ida_loader.load_and_run_plugin(PLUGIN_NAME, command)
+    if os.environ.get("UTILITY_BATCH_SAVE") == "1":
+        ida_loader.save_database(None, 0)
+    else:
+        # IDA saves on a normal exit, this drops the new names and the plugin's netnodes instead
+        ida_loader.set_database_flag(ida_loader.DBFL_KILL)
+    ida_pro.qexit(0)
+
+
+def file_state(path):
+    """Modification time and hash of a database, to check a run without "--save" left it as it was."""
+    digest = hashlib.sha256()
+    with open(path, "rb") as fp:
+        for block in iter(lambda: fp.read(1024 * 1024), b""):
+            digest.update(block)
+    return os.path.getmtime(path), digest.hexdigest()
+
+
+def find_databases(paths):
+    databases = []
+    for path in paths:
+        if os.path.isdir(path):
+            for root, _, files in os.walk(path):
+                databases.extend(os.path.join(root, name) for name in files if name.lower().endswith(IDB_EXTENSIONS))
+        else:
+            databases.extend(glob.glob(path))
+    return sorted(databases)
+
+
+def run_database(args, database, report_path):
+    env = dict(os.environ)
+    env["UTILITY_REPORT"] = report_path
+    env["UTILITY_BATCH_SURVEY"] = "1" if args.survey else "0"
+    env["UTILITY_BATCH_SAVE"] = "1" if args.save else "0"
+    log_path = os.path.splitext(report_path)[0] + ".log"
+    command = [args.ida, "-A", "-L" + log_path, "-S" + os.path.abspath(__file__), database]
+    start = time.perf_counter()
+    try:
+        result = subprocess.run(command, env=env, timeout=args.timeout).returncode
+    except subprocess.TimeoutExpired:
+        result = "timeout"
+    return result, (time.perf_counter() - start)
+
+
+def summarize(reports, wall_time):
+    functions = sum(r["functions"] for r in reports)
+    candidates = sum(r["candidates"] for r in reports)
+    named = sum(r["named"] for r in reports)
+    namer_time = sum(r["times"]["stubNamer"] for r in reports)
+
+    print("\n%d databases, %d functions, %d candidates, %d named." % (len(reports), functions, candidates, named))
+    if namer_time > 0.0:
+        print(" Stub namer: %.2fs, %.0f functions per second." % (namer_time, functions / namer_time))
+    print(" Wall time, including IDA load: %.2fs." % wall_time)
+
+    for phase in ("compile", "snapshot", "classify", "nameIndex", "rename", "fillSurvey"):
+        total = sum(r["times"].get(phase, 0.0) for r in reports)
+        if total > 0.0:
+            print("  %-10s %8.3fs" % (phase, total))
+
+    # Hit rate of each pattern, per function and per bitness
+    for bits in (32, 64):
+        subset = [r for r in reports if r["bits"] == bits]
+        if not subset:
+            continue
+        subset_functions = sum(r["functions"] for r in subset)
+        hits = {}
+        for r in subset:
+            for prefix, count in r["patterns"].items():
+                hits[prefix] = hits.get(prefix, 0) + count
+        print(" %dbit, %d databases:" % (bits, len(subset)))
+        for prefix, count in sorted(hits.items(), key=lambda item: -item[1]):
+            print("  %-16s %8d  %6.3f%%" % (prefix, count, (100.0 * count / subset_functions) if subset_functions else 0.0))
+
+    if any("fillSurvey" in r for r in reports):
+        runs = sum(r["fillSurvey"]["runs"] for r in reports if "fillSurvey" in r)
+        size = sum(r["fillSurvey"]["bytes"] for r in reports if "fillSurvey" in r)
+        struct_runs = sum(r["fillSurvey"]["structRuns"] for r in reports if "fillSurvey" in r)
+        print(" Data fill survey: %d runs, %d bytes, %d struct runs." % (runs, size, struct_runs))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Batch run the Utility plugin stub namer over IDA databases.")
+    parser.add_argument("paths", nargs="+", help="Databases, wildcards, or directories to search")
+    parser.add_argument("--ida", required=True, help="Path to the IDA text mode executable (idat)")
+    parser.add_argument("--out", default="utility_reports", help="Report directory")
+    parser.add_argument("--survey", action="store_true", help="Also run the data fill survey")
+    parser.add_argument("--save", action="store_true", help="Save the databases with the new stub names")
+    parser.add_argument("--timeout", type=int, default=3600, help="Per database timeout in seconds")
+    args = parser.parse_args()
+
+    databases = find_databases(args.paths)
+    if not databases:
+        sys.exit("No databases found.")
+    os.makedirs(args.out, exist_ok=True)
+
+    reports = []
+    start = time.perf_counter()
+    for index, database in enumerate(databases):
+        name = "%04d_%s" % (index, os.path.basename(database))
+        report_path = os.path.abspath(os.path.join(args.out, name + ".json"))
+        if os.path.exists(report_path):
+            os.remove(report_path)
+        before = None if args.save else file_state(database)
+        result, elapsed = run_database(args, database, report_path)
+        if before and (file_state(database) != before):
+            print("%s: ** database changed by a run without --save **" % database)
+        try:
+            with open(report_path) as fp:
+                reports.append(json.load(fp))
+            print("%s: %d named, %.2fs" % (database, reports[-1]["named"], elapsed))
+        except (OSError, ValueError):
+            print("%s: ** failed (%s), see the log **" % (database, result))
+
+    if reports:
+        with open(os.path.join(args.out, "summary.json"), "w") as fp:
+            json.dump(reports, fp, indent=2)
+        summarize(reports, time.perf_counter() - start)
+
+
+if __name__ == "__main__":
+    try:
+        import idaapi  # noqa: F401
+        IN_IDA = True
+    except ImportError:
+        IN_IDA = False
+
+    if IN_IDA:
+        run_in_ida()
+    else:
+        main()
@@ -0,0 +1,249 @@
+// Padding and string run commands.
+// The run finding is the core SIMD one ("Core/ByteRuns.h") over the live database, this adds the segment walk and the
+// filter down to the runs that are still unformatted bytes, then the conversion batch.
+#include "StdAfx.h"
+#include "ByteRunScan.h"
+#include "IdaDatabase.h"
+#include "Core/ByteRuns.h"
+#include <algorithm>
+#include <vector>
+
+// Scan slices between long scan checks, the first one small since the next run is usually close
+static const size_t FIRST_SLICE_SIZE = (64 * 1024);
+static const size_t SYNC_SLICE_SIZE = (16 * SCAN_CHUNK_SIZE);
+
+// If the address is inside a collapsed hidden range return it, else NULL
+static hidden_range_t *getCollapsedRange(ea_t ea)
+{
+	hidden_range_t *hr = get_hidden_range(ea);
+	return((hr && !hr->visible) ? hr : NULL);
+}
+
+// Only runs that are all still unknown bytes, and padding nothing refers to (a referenced zero run is a variable)
+static BOOL isUnformattedRun(const BYTERUN &run)
+{
+	flags64_t flags = get_flags(run.startEa);
+	if (!is_unknown(flags) || (next_head(run.startEa, (run.startEa + run.size)) != BADADDR))
+		return FALSE;
+	return((run.kind != BYTERUN_PADDING) || !has_xref(flags));
+}
+
+// ======================================================================================
+
+static ea_t scanSegmentNext(LongScanState &state, const segment_t *seg, ea_t ea, uint32_t kinds)
+{
+	std::vector<BYTERUN> runs;
+	size_t sliceSize = FIRST_SLICE_SIZE;
+	while (ea < seg->end_ea)
+	{
+		ea_t sliceEnd = (ea + std::min((ea_t) sliceSize, (seg->end_ea - ea)));
+		sliceSize = std::min((sliceSize * 2), SYNC_SLICE_SIZE);
+		runs.clear();
+		FindByteRuns(LiveDatabase(), seg->start_ea, seg->end_ea, ea, sliceEnd, kinds, runs);
+		for (const BYTERUN &run : runs)
+		{
+			if (isUnformattedRun(run) && !getCollapsedRange(run.startEa))
+				return run.startEa;
+		}
+		ea = sliceEnd;
+		if (!state.Check(ea))
+			break;
+	}
+	return BADADDR;
+}
+
+static ea_t scanSegmentPrev(LongScanState &state, const segment_t *seg, ea_t ea, uint32_t kinds)
+{
+	std::vector<BYTERUN> runs;
+	size_t sliceSize = FIRST_SLICE_SIZE;
+	while (ea > seg->start_ea)
+	{
+		ea_t sliceStart = (ea - std::min((ea_t) sliceSize, (ea - seg->start_ea)));
+		sliceSize = std::min((sliceSize * 2), SYNC_SLICE_SIZE);
+		runs.clear();
+		FindByteRuns(LiveDatabase(), seg->start_ea, seg->end_ea, sliceStart, ea, kinds, runs);
+		for (auto it = runs.rbegin(); it != runs.rend(); ++it)
+		{
+			if (isUnformattedRun(*it) && !getCollapsedRange(it->startEa))
+				return it->startEa;
+		}
+		ea = sliceStart;
+		if (!state.Check(ea))
+			break;
+	}
+	return BADADDR;
+}
+
+static ea_t findNext(ea_t ea, uint32_t kinds, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+
+	ea++;
+	ea_t maxEa = inf_get_max_ea();
+	LongScanState state(longScan, ea, maxEa);
+
+	while ((ea < maxEa) && !state.Stopped())
+	{
+		// Jump over unloaded ranges, and with them any run of segments without initialized bytes, in one step
+		if (!is_loaded(ea))
+		{
+			ea = next_inited(ea, maxEa);
+			if (ea == BADADDR)
+				break;
+		}
+
+		segment_t *seg = getseg(ea);
+		if (!seg)
+		{
+			seg = get_next_seg(ea);
+			if (!seg)
+				break;
+			ea = seg->start_ea;
+			continue;
+		}
+
+		ea_t hit = scanSegmentNext(state, seg, ea, kinds);
+		if (hit != BADADDR)
+			return hit;
+		ea = seg->end_ea;
+	}
+
+	if (stopped)
+		*stopped = state.Stopped();
+	return BADADDR;
+}
+
+static ea_t findPrev(ea_t ea, uint32_t kinds, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+	if (ea == 0)
+		return BADADDR;
+
+	ea_t minEa = inf_get_min_ea();
+	LongScanState state(longScan, ea, minEa);
+
+	while ((ea > minEa) && !state.Stopped())
+	{
+		if (!is_loaded(ea - 1))
+		{
+			ea_t prev = prev_inited((ea - 1), minEa);
+			if (prev == BADADDR)
+				break;
+			ea = (prev + 1);
+		}
+
+		segment_t *seg = getseg(ea - 1);
+		if (!seg)
+		{
+			seg = get_prev_seg(ea - 1);
+			if (!seg)
+				break;
+			ea = seg->end_ea;
+			continue;
+		}
+
+		ea_t hit = scanSegmentPrev(state, seg, std::min(ea, seg->end_ea), kinds);
+		if (hit != BADADDR)
+			return hit;
+		ea = seg->start_ea;
+	}
+
+	if (stopped)
+		*stopped = state.Stopped();
+	return BADADDR;
+}
+
+ea_t FindNextPadding(ea_t ea, LONGSCAN longScan, BOOL *stopped) { return findNext(ea, BYTERUNS_PADDING, longScan, stopped); }
+ea_t FindPrevPadding(ea_t ea, LONGSCAN longScan, BOOL *stopped) { return findPrev(ea, BYTERUNS_PADDING, longScan, stopped); }
+ea_t FindNextStringRun(ea_t ea, LONGSCAN longScan, BOOL *stopped) { return findNext(ea, BYTERUNS_STRINGS, longScan, stopped); }
+ea_t FindPrevStringRun(ea_t ea, LONGSCAN longScan, BOOL *stopped) { return findPrev(ea, BYTERUNS_STRINGS, longScan, stopped); }
+
+// ======================================================================================
+
+static BOOL convertRun(const BYTERUN &run)
+{
+	switch (run.kind)
+	{
+		case BYTERUN_PADDING: return create_align(run.startEa, run.size, run.alignment);
+		case BYTERUN_ASCII: return create_strlit(run.startEa, run.size, STRTYPE_C);
+		case BYTERUN_UTF16: return create_strlit(run.startEa, run.size, STRTYPE_C_16);
+	};
+	return FALSE;
+}
+
+BOOL ConvertByteRuns(BOOL dryRun)
+{
+	ea_t eaScreen = get_screen_ea();
+	segment_t *seg = ((eaScreen != BADADDR) ? getseg(eaScreen) : NULL);
+	if (!seg)
+	{
+		msg("Utility: ** Not in a segment, aborted. **\n");
+		return FALSE;
+	}
+	qstring segName;
+	get_segm_name(&segName, seg);
+
+	// The whole segment in one pass, then down to the unformatted runs
+	TIMESTAMP startTime = GetTimeStamp();
+	std::vector<BYTERUN> runs;
+	FindByteRuns(LiveDatabase(), seg->start_ea, seg->end_ea, seg->start_ea, seg->end_ea, BYTERUNS_ALL, runs);
+	TIMESTAMP findTime = (GetTimeStamp() - startTime);
+	size_t foundCount = runs.size();
+	runs.erase(std::remove_if(runs.begin(), runs.end(), [](const BYTERUN &run) { return !isUnformattedRun(run); }), runs.end());
+	TIMESTAMP filterTime = ((GetTimeStamp() - startTime) - findTime);
+	if (runs.empty())
+	{
+		msg("Utility: Byte runs, no unformatted padding or strings found in \"%s\".\n", segName.c_str());
+		return FALSE;
+	}
+
+	// Report
+	UINT64 kindRuns[BYTERUN_KIND_COUNT] = {}, kindBytes[BYTERUN_KIND_COUNT] = {};
+	for (const BYTERUN &run : runs)
+	{
+		kindRuns[run.kind]++;
+		kindBytes[run.kind] += run.size;
+	}
+	char buffer[32];
+	msg("Utility: Byte runs%s, %s unformatted runs in \"%s\":\n", (dryRun ? " (dry run)" : ""), NumberCommaString(runs.size(), buffer), segName.c_str());
+	for (UINT32 i = 0; i < BYTERUN_KIND_COUNT; i++)
+	{
+		msg(" %-8s %s runs", ByteRunKindName((BYTERUNKIND) i), NumberCommaString(kindRuns[i], buffer));
+		msg(", %s bytes.\n", NumberCommaString(kindBytes[i], buffer));
+	}
+	msg(" Found in %s (%s), %s already formatted or referenced", TimeString(findTime), ByteRunsISA(), NumberCommaString((foundCount - runs.size()), buffer));
+	msg(" filtered out in %s.\n", TimeString(filterTime));
+	if (dryRun)
+		return TRUE;
+
+	// Apply grouped by kind, the align directives first, with one undo point and no auto-analysis churn in between
+	std::stable_sort(runs.begin(), runs.end(), [](const BYTERUN &a, const BYTERUN &b) { return(a.kind < b.kind); });
+	create_undo_point("Utility:ConvertByteRuns", "Convert padding and string runs");
+	bool autoEnabled = enable_auto(false);
+	startTime = GetTimeStamp();
+	WaitBox::show("Utility", "Converting..");
+	UINT32 converted = 0, failed = 0;
+	BOOL cancelled = FALSE;
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		if (convertRun(runs[i]))
+			converted++;
+		else
+			failed++;
+
+		if (WaitBox::isUpdateTime() && WaitBox::updateAndCancelCheck((int) (((double) i / (double) runs.size()) * 100.0)))
+		{
+			msg("Utility: * Byte run conversion cancelled at %014llX, undo to revert. *\n", runs[i].startEa);
+			cancelled = TRUE;
+			break;
+		}
+	}
+	WaitBox::hide();
+	enable_auto(autoEnabled);
+
+	msg(" Converted %s runs", NumberCommaString(converted, buffer));
+	msg(" (%s failed) in %s.\n", NumberCommaString(failed, buffer), TimeString(GetTimeStamp() - startTime));
+	return((converted > 0) && !cancelled);
+}
@@ -0,0 +1,15 @@
+// Padding and string run commands: jump to the next/previous run of alignment padding or an unformatted string, and
+// convert a segment's runs to align directives and string literals in one go
+#pragma once
+#include "LongScan.h"
+
+// Return the start of the next/previous unformatted padding or string run from 'ea' (exclusive), or BADADDR if none.
+// 'longScan' is what to do if it runs long, 'stopped' is set if it was cancelled or gave up before the end.
+ea_t FindNextPadding(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+ea_t FindPrevPadding(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+ea_t FindNextStringRun(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+ea_t FindPrevStringRun(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+
+// Find the unformatted padding and string runs in the current segment, report the counts and timing, then unless 'dryRun'
+// make the padding align directives and the strings string literals, with one undo point. Returns FALSE if cancelled or nothing done.
+BOOL ConvertByteRuns(BOOL dryRun);
@@ -0,0 +1,241 @@
+// Clone namer command.
+// The functions up to MAX_CLUSTER_BYTES that the stub patterns don't match are copied into one byte table on the main
+// thread, with their fixup bytes zeroed so relocated copies compare equal, then hashed in parallel and clustered in
+// one linear pass ("Core/FuncClusters.h"). Each cluster's unnamed members are named in one batch with one undo point.
+#include "StdAfx.h"
+#include "CloneNamer.h"
+#include "IdaDatabase.h"
+#include "StubPatterns.h"
+#include "ThreadPool.h"
+#include "Telemetry.h"
+#include "Core/FuncClusters.h"
+#include <WaitBoxEx.h>
+#include <undo.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+static const size_t HASH_GRAIN = 4096;  // Functions per parallel hash task
+static const UINT32 TOP_CLUSTERS = 8;   // Largest clusters listed in the report
+
+// Cluster member count histogram buckets: 2, 3-4, 5-8, 9-16, 17-64, 65 and up
+static const UINT32 SIZE_BUCKETS = 6;
+static const UINT32 s_bucketMax[SIZE_BUCKETS] = { 2, 4, 8, 16, 64, UINT_MAX };
+
+static UINT32 sizeBucket(size_t members)
+{
+	UINT32 i = 0;
+	while (members > s_bucketMax[i])
+		i++;
+	return i;
+}
+
+// Split a "prefix_N" name, returns FALSE if it's not of that form
+static BOOL parseSerialName(LPCSTR name, std::string &prefix, UINT &number)
+{
+	LPCSTR digits = strrchr(name, '_');
+	if (!digits || !isdigit((BYTE) digits[1]) || ((digits[1] == '0') && digits[2]))
+		return FALSE;
+	digits++;
+
+	char *end;
+	unsigned long value = strtoul(digits, &end, 10);
+	if (*end || (value > UINT_MAX))
+		return FALSE;
+
+	prefix.assign(name, (digits - name));
+	number = (UINT) value;
+	return TRUE;
+}
+
+// The cluster's shared name prefix and first free serial number.
+// A member's user name gives it, as is if it's already a "prefix_N" name, else the name plus "_".
+// With none named it's "clone<hash>_", and also if any member had fixups masked: those can relocate to different
+// globals or call targets, so one member's name doesn't say what the others do.
+// Either way the serial continues past the members already named with the prefix.
+static void clusterPrefix(const std::vector<ea_t> &starts, const std::vector<BYTE> &relocated, const FUNCCLUSTERS &clusters, size_t cluster, UINT64 hash, std::string &prefix, UINT &serial)
+{
+	char hashPrefix[32];
+	sprintf(hashPrefix, "clone%08X_", (UINT32) hash);
+	prefix.clear();
+	serial = 0;
+	qstring name;
+	std::string namePrefix;
+	UINT number;
+	BOOL anyRelocated = FALSE;
+	for (UINT32 i = clusters.starts[cluster]; i < clusters.starts[cluster + 1]; i++)
+		anyRelocated |= relocated[clusters.members[i]];
+	if (anyRelocated)
+		prefix = hashPrefix;
+
+	for (UINT32 i = clusters.starts[cluster]; i < clusters.starts[cluster + 1]; i++)
+	{
+		ea_t ea = starts[clusters.members[i]];
+		if (!has_user_name(get_flags(ea)) || (get_name(&name, ea, GN_NOT_DUMMY) <= 0))
+			continue;
+		BOOL isSerial = parseSerialName(name.c_str(), namePrefix, number);
+		if (prefix.empty())
+		{
+			if (isSerial)
+				prefix = namePrefix;
+			else
+			{
+				prefix = name.c_str();
+				prefix += '_';
+			}
+		}
+		if (isSerial && (namePrefix == prefix))
+			serial = std::max(serial, (number + 1));
+	}
+
+	if (prefix.empty())
+		prefix = hashPrefix;
+}
+
+BOOL RunCloneNamer(BOOL dryRun)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	IdaDatabase &db = LiveDatabase();
+	StubPatternsCompile(plat.is64);
+
+	// Copy the candidates' bytes, with their fixups zeroed
+	WaitBox::show("Utility", "Reading functions..");
+	CLONETABLE table;
+	std::vector<ea_t> starts;
+	std::vector<BYTE> relocated; // Per candidate, it had fixups masked
+	size_t funcCount = db.FunctionCount();
+	UINT32 stubs = 0, fixups = 0;
+	BYTE bytes[MAX_CLUSTER_BYTES];
+	BOOL cancelled = FALSE;
+	for (size_t n = 0; n < funcCount; n++)
+	{
+		DBFUNCTION f = db.Function(n);
+		if (!IsCloneCandidate(f))
+			continue;
+		size_t size = (size_t) (f.endEa - f.startEa);
+		TELEMETRY_COUNT(TC_GET_BYTES);
+		if (get_bytes(bytes, (ssize_t) size, f.startEa, GMB_READALL) != (ssize_t) size)
+			continue;
+		if ((size <= MAX_STUB_BYTES) && (StubPatternsMatch(bytes, size, f.startEa) != STUB_NO_MATCH))
+		{
+			stubs++;
+			continue;
+		}
+
+		UINT32 masked = MaskFixups(f.startEa, table.Add(bytes, size), size);
+		fixups += masked;
+		starts.push_back(f.startEa);
+		relocated.push_back(masked != 0);
+
+		if (WaitBox::isUpdateTime() && WaitBox::updateAndCancelCheck((int) ((n * 100) / funcCount)))
+		{
+			cancelled = TRUE;
+			break;
+		}
+	}
+	WaitBox::hide();
+	if (cancelled)
+	{
+		msg("Utility: * Clone namer cancelled. *\n");
+		return FALSE;
+	}
+	TIMESTAMP readTime = (GetTimeStamp() - startTime);
+
+	// Hash off the main thread, then cluster
+	TIMESTAMP hashStart = GetTimeStamp();
+	table.hashes.resize(table.Count());
+	ParallelFor(table.Count(), HASH_GRAIN, [&](size_t begin, size_t end) { table.Hash(begin, end); });
+	TIMESTAMP hashTime = (GetTimeStamp() - hashStart);
+
+	TIMESTAMP clusterStart = GetTimeStamp();
+	FUNCCLUSTERS clusters;
+	ClusterFunctions(table, clusters);
+	TIMESTAMP clusterTime = (GetTimeStamp() - clusterStart);
+
+	// Statistics
+	UINT32 histogram[SIZE_BUCKETS] = {};
+	UINT64 clusteredBytes = 0;
+	std::vector<UINT32> order(clusters.Count());
+	for (size_t i = 0; i < clusters.Count(); i++)
+	{
+		histogram[sizeBucket(clusters.MemberCount(i))]++;
+		clusteredBytes += ((UINT64) table.Size(clusters.members[clusters.starts[i]]) * clusters.MemberCount(i));
+		order[i] = (UINT32) i;
+	}
+	size_t top = std::min(order.size(), (size_t) TOP_CLUSTERS);
+	std::partial_sort(order.begin(), (order.begin() + top), order.end(), [&](UINT32 a, UINT32 b) { return(clusters.MemberCount(a) > clusters.MemberCount(b)); });
+
+	char buffer[32];
+	msg("Utility: Clone namer%s, %s functions up to %u bytes", (dryRun ? " (dry run)" : ""), NumberCommaString(table.Count(), buffer), (UINT32) MAX_CLUSTER_BYTES);
+	msg(" (%s stubs skipped,", NumberCommaString(stubs, buffer));
+	msg(" %s fixups masked):\n", NumberCommaString(fixups, buffer));
+	msg(" Clusters: %s", NumberCommaString(clusters.Count(), buffer));
+	msg(", of %s functions", NumberCommaString(clusters.members.size(), buffer));
+	msg(" (%s bytes), hash collisions: %u.\n", NumberCommaString(clusteredBytes, buffer), clusters.collisions);
+	msg(" Members:");
+	for (UINT32 i = 0; i < SIZE_BUCKETS; i++)
+	{
+		if (i == 0)
+			msg(" 2: %u,", histogram[i]);
+		else
+		if (i == (SIZE_BUCKETS - 1))
+			msg(" %u+: %u.\n", (s_bucketMax[i - 1] + 1), histogram[i]);
+		else
+			msg(" %u-%u: %u,", (s_bucketMax[i - 1] + 1), s_bucketMax[i], histogram[i]);
+	}
+	for (size_t i = 0; i < top; i++)
+	{
+		UINT32 first = clusters.members[clusters.starts[order[i]]];
+		msg(" %llX: %u functions of %u bytes.\n", starts[first], (UINT32) clusters.MemberCount(order[i]), (UINT32) table.Size(first));
+	}
+	msg(" Read in %s, hashed in %s,", TimeString(readTime), TimeString(hashTime));
+	msg(" clustered in %s.\n", TimeString(clusterTime));
+
+	if (dryRun || (clusters.Count() == 0))
+		return dryRun;
+	if (ask_yn(ASKBTN_YES, "HIDECANCEL\nName the unnamed functions of the %u clone clusters?", (UINT32) clusters.Count()) != ASKBTN_YES)
+		return FALSE;
+
+	// Name them all in one go, one undo point and no auto-analysis in between
+	create_undo_point("Utility:CloneNamer", "Name clone functions");
+	bool autoEnabled = enable_auto(false);
+	startTime = GetTimeStamp();
+	UINT32 named = 0, failed = 0;
+	std::string prefix;
+	char name[MAXNAMELEN];
+	for (size_t i = 0; i < clusters.Count(); i++)
+	{
+		UINT serial;
+		clusterPrefix(starts, relocated, clusters, i, table.hashes[clusters.members[clusters.starts[i]]], prefix, serial);
+		if ((prefix.size() + 12) > sizeof(name))
+			continue;
+
+		for (UINT32 j = clusters.starts[i]; j < clusters.starts[i + 1]; j++)
+		{
+			ea_t ea = starts[clusters.members[j]];
+			if (has_user_name(get_flags(ea)))
+				continue;
+
+			// Retry in case of a name taken outside the cluster
+			BOOL ok = FALSE;
+			for (UINT retry = 0; !ok && (retry < 16); retry++)
+			{
+				sprintf(name, "%s%u", prefix.c_str(), serial++);
+				TELEMETRY_COUNT(TC_SET_NAME);
+				ok = set_name(ea, name, (SN_NON_AUTO | SN_NOLIST | SN_NOWARN));
+			}
+			if (ok)
+				named++;
+			else
+			if (failed++ < 16)
+				msg("%llX ** Failed to set clone name: \"%s\" ** <Click Me>\n", ea, name);
+		}
+	}
+	enable_auto(autoEnabled);
+
+	msg(" Named %s functions", NumberCommaString(named, buffer));
+	msg(" in %s.\n", TimeString(GetTimeStamp() - startTime));
+	if (failed)
+		msg(" ** %u failed to name. **\n", failed);
+	return(named > 0);
+}
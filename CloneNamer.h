@@ -0,0 +1,6 @@
+// Clone namer command
+#pragma once
+
+// Cluster the byte identical small functions that aren't stubs, report the clusters, then unless 'dryRun' name the
+// unnamed members of each from a shared prefix. Returns FALSE if cancelled or nothing done.
+BOOL RunCloneNamer(BOOL dryRun);
@@ -0,0 +1,141 @@
+// Content classification of the unformatted runs for the auto-format pass
+#include "AutoFormat.h"
+#include "ZeroScan.h"
+#include <algorithm>
+#include <string.h>
+
+static inline bool isStringChar(uint8_t c) { return(((c >= 0x20) && (c < 0x7F)) || (c == '\t') || (c == '\r') || (c == '\n')); }
+
+// True if the bytes are one or more NUL terminated strings, each followed by less than MAX_STRING_PADDING zero bytes
+// of padding (the last one by any number). Short strings are fine as long as they average MIN_STRING_LENGTH characters,
+// that keeps tables of small numbers out.
+static bool isStrings(const uint8_t *bytes, size_t size)
+{
+	size_t i = 0, strings = 0, chars = 0;
+	while ((i < size) && bytes[i])
+	{
+		size_t start = i;
+		while ((i < size) && isStringChar(bytes[i]))
+			i++;
+		// Has to be terminated right after
+		if ((i >= size) || bytes[i])
+			return false;
+		strings++;
+		chars += (i - start);
+
+		// The terminator and the padding up to the next string
+		size_t padStart = ++i;
+		i += FindFirstNonZero(bytes + i, (size - i));
+		if ((i < size) && ((i - padStart) >= MAX_STRING_PADDING))
+			return false;
+	}
+	return((strings > 0) && (chars >= (strings * MIN_STRING_LENGTH)));
+}
+
+void GetRunStats(const uint8_t *bytes, size_t size, EA minEa, EA maxEa, bool is64, RUNSTATS &stats)
+{
+	stats = RUNSTATS();
+	stats.bytes = size;
+
+	// Zero bytes, a run of zero chunks at the time
+	for (size_t i = 0; i < size;)
+	{
+		size_t nonZero = (i + FindFirstNonZero(bytes + i, (size - i)));
+		stats.zeroBytes += (nonZero - i);
+		if (nonZero >= size)
+			break;
+		size_t zero = (nonZero + FindFirstZero(bytes + nonZero, (size - nonZero)));
+		i = zero;
+	}
+
+	if (stats.zeroBytes < size)
+	{
+		size_t ptrSize = (is64 ? sizeof(uint64_t) : sizeof(uint32_t));
+		for (size_t i = 0; (i + ptrSize) <= size; i += ptrSize)
+		{
+			uint64_t v = 0;
+			memcpy(&v, (bytes + i), ptrSize);
+			if (v == 0)
+				continue;
+			if ((v >= minEa) && (v < maxEa))
+				stats.ptrSlots++;
+			else
+				stats.nonPtrSlots++;
+		}
+
+		for (size_t i = 0; i < size;)
+		{
+			size_t start = i;
+			while ((i < size) && isStringChar(bytes[i]))
+				i++;
+			if ((i - start) >= MIN_STRING_LENGTH)
+				stats.textBytes += (i - start);
+			if (i == start)
+				i++;
+		}
+		if (size <= MAX_STRING_RUN)
+			stats.strings = isStrings(bytes, size);
+	}
+}
+
+void MergeRunStats(RUNSTATS &stats, const RUNSTATS &piece)
+{
+	stats.bytes += piece.bytes;
+	stats.zeroBytes += piece.zeroBytes;
+	stats.ptrSlots += piece.ptrSlots;
+	stats.nonPtrSlots += piece.nonPtrSlots;
+	stats.textBytes += piece.textBytes;
+	stats.strings = false;
+}
+
+RUNCLASS ClassifyRun(const RUNSTATS &stats, EA startEa, size_t pieces, bool is64)
+{
+	// Strings can end anywhere, the padding before the next bound needn't be a whole DWORD
+	if ((pieces == 1) && stats.strings)
+		return RUN_STRINGS;
+	if ((stats.bytes % sizeof(uint32_t)) != 0)
+		return RUN_OTHER;
+	if (stats.zeroBytes == stats.bytes)
+		return RUN_ZEROS;
+
+	// Only valid pointers and nulls, and at least half of the slots pointers
+	uint64_t ptrSize = (is64 ? sizeof(uint64_t) : sizeof(uint32_t));
+	if (((startEa % ptrSize) == 0) && ((stats.bytes % ptrSize) == 0) && (stats.nonPtrSlots == 0) && ((stats.ptrSlots * 2) >= (stats.bytes / ptrSize)))
+		return RUN_POINTERS;
+	// Mostly text that isn't clean strings, better left alone than made DWORDs
+	if ((stats.textBytes * 4) >= ((stats.bytes - stats.zeroBytes) * 3))
+		return RUN_OTHER;
+	return RUN_DWORDS;
+}
+
+RUNCLASS ClassifyFillRun(const IDatabase &db, const FILLRUN &run)
+{
+	RUNSTATS stats = RUNSTATS(), piece;
+	size_t pieces = 0;
+	for (EA ea = run.startEa; ea < run.endEa; ea += RUN_PIECE_SIZE, pieces++)
+	{
+		size_t size = (size_t) std::min((EA) RUN_PIECE_SIZE, (run.endEa - ea)), inited;
+		const uint8_t *bytes = db.ReadBytes(ea, size, true, inited);
+		if (inited != size)
+			return RUN_OTHER;
+		GetRunStats(bytes, size, db.MinEa(), db.MaxEa(), db.Is64(), piece);
+		if (pieces == 0)
+			stats = piece;
+		else
+			MergeRunStats(stats, piece);
+	}
+	return ClassifyRun(stats, run.startEa, pieces, db.Is64());
+}
+
+const char *RunClassName(RUNCLASS runClass)
+{
+	switch (runClass)
+	{
+		case RUN_ZEROS:    return "zeros";
+		case RUN_POINTERS: return "pointers";
+		case RUN_STRINGS:  return "strings";
+		case RUN_DWORDS:   return "dwords";
+		default: break;
+	};
+	return "other";
+}
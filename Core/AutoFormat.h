@@ -0,0 +1,47 @@
+// Content classification of the unformatted runs for the auto-format pass.
+// A run is read in pieces, each piece reduced to counts that merge in any order, so the pieces can be classified in parallel.
+#pragma once
+#include "Navigation.h"
+
+// Run classes, what the run would be formatted as
+enum RUNCLASS
+{
+	RUN_ZEROS,    // All zero
+	RUN_POINTERS, // Pointers into the database, and null ones
+	RUN_STRINGS,  // NUL terminated printable strings, each maybe zero padded to an alignment
+	RUN_DWORDS,   // Anything else DWORD sized
+	RUN_OTHER,    // Not a whole number of DWORDs, mostly text that isn't clean strings, or partly uninitialized; left alone
+
+	RUN_CLASS_COUNT
+};
+
+const size_t RUN_PIECE_SIZE = SCAN_CHUNK_SIZE;   // Piece size, pointer aligned
+const size_t MIN_STRING_LENGTH = 4;        // Shortest average string length, in characters
+const size_t MAX_STRING_PADDING = 16;      // Zero bytes after a terminator are less than this, strings aligned in a table
+const size_t MAX_STRING_RUN = (64 * 1024); // Longest run tested for strings, it has to be a single piece
+
+// Counts of a run piece, pieces start at pointer aligned offsets from the run start
+struct RUNSTATS
+{
+	uint64_t bytes;
+	uint64_t zeroBytes;
+	uint64_t ptrSlots;    // Pointer sized slots pointing into [minEa, maxEa)
+	uint64_t nonPtrSlots; // Non-zero pointer sized slots that don't
+	uint64_t textBytes;   // Characters in runs of at least MIN_STRING_LENGTH printable ones
+	bool strings;         // The piece is all strings and zero padding
+};
+
+// Get the counts of a piece, pointers being values in [minEa, maxEa)
+void GetRunStats(const uint8_t *bytes, size_t size, EA minEa, EA maxEa, bool is64, RUNSTATS &stats);
+
+// Add the counts of the next piece of the same run
+void MergeRunStats(RUNSTATS &stats, const RUNSTATS &piece);
+
+// Classify the run at 'startEa' from the counts of all its pieces, 'pieces' being how many there were
+RUNCLASS ClassifyRun(const RUNSTATS &stats, EA startEa, size_t pieces, bool is64);
+
+// Classify a run reading it a piece at the time, single threaded
+RUNCLASS ClassifyFillRun(const IDatabase &db, const FILLRUN &run);
+
+// Class display name
+const char *RunClassName(RUNCLASS runClass);
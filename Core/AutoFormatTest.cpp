@@ -0,0 +1,66 @@
+// Auto-format run classification checks, run by "ctest".
+// Each case is a run's bytes and the class it has to get.
+#include "AutoFormat.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static const EA RUN_EA = 0x140010000;
+static const EA MIN_EA = 0x140000000, MAX_EA = 0x140100000;
+
+static int s_failed = 0;
+
+static void check(const char *name, const std::vector<uint8_t> &bytes, RUNCLASS expected)
+{
+	RUNSTATS stats;
+	GetRunStats(bytes.data(), bytes.size(), MIN_EA, MAX_EA, true, stats);
+	RUNCLASS got = ClassifyRun(stats, RUN_EA, 1, true);
+	printf(" %-26s %-8s %s\n", name, RunClassName(got), ((got == expected) ? "ok" : "** FAILED **"));
+	if (got != expected)
+		s_failed++;
+}
+
+// The strings each NUL terminated and zero padded to 'align', then padded to a DWORD multiple
+static std::vector<uint8_t> stringTable(const std::vector<const char *> &strings, size_t align)
+{
+	std::vector<uint8_t> bytes;
+	for (const char *s : strings)
+	{
+		bytes.insert(bytes.end(), s, (s + strlen(s) + 1));
+		while (bytes.size() % align)
+			bytes.push_back(0);
+	}
+	while (bytes.size() % sizeof(uint32_t))
+		bytes.push_back(0);
+	return bytes;
+}
+
+int main()
+{
+	printf("Auto-format classification:\n");
+	check("packed strings", stringTable({ "kernel32.dll", "GetProcAddress", "LoadLibraryA" }, 1), RUN_STRINGS);
+	check("8 aligned strings", stringTable({ "Warning", "Error: %s\n", "ok", "Fatal", "Debug output" }, 8), RUN_STRINGS);
+	check("16 aligned strings", stringTable({ "config.ini", "Settings", "Path", "WindowWidth", "WindowHeight" }, 16), RUN_STRINGS);
+
+	// Too much padding between them, and text with binary in it, aren't strings but aren't DWORDs either
+	std::vector<uint8_t> farApart = stringTable({ "first string", "second string" }, 32);
+	check("32 aligned strings", farApart, RUN_OTHER);
+	std::vector<uint8_t> dirtyText = stringTable({ "Some text with\x01" "a control byte in it" }, 4);
+	check("text with binary", dirtyText, RUN_OTHER);
+
+	// Small numbers look like one character strings, their average length keeps them DWORDs
+	std::vector<uint8_t> smallNumbers;
+	for (uint32_t v = 0x41; v < 0x51; v++)
+		smallNumbers.insert(smallNumbers.end(), (uint8_t *) &v, ((uint8_t *) &v + sizeof(v)));
+	check("small numbers", smallNumbers, RUN_DWORDS);
+
+	std::vector<uint8_t> pointers;
+	for (EA ea = MIN_EA; ea < (MIN_EA + 0x100); ea += 0x10)
+		pointers.insert(pointers.end(), (uint8_t *) &ea, ((uint8_t *) &ea + sizeof(ea)));
+	check("pointers", pointers, RUN_POINTERS);
+	check("zeros", std::vector<uint8_t>(64, 0), RUN_ZEROS);
+
+	if (s_failed)
+		printf("** %d failed **\n", s_failed);
+	return((s_failed == 0) ? 0 : 1);
+}
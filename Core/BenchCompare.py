@@ -0,0 +1,62 @@
+"""
+Compare two "utility_bench --json" results and flag the regressions.
+
+    python BenchCompare.py baseline.json current.json [--threshold 10]
+
+A benchmark regresses when its mean latency grows by more than the threshold percent, or when it allocates more
+than the baseline did. Exits with 1 if anything regressed, so it can gate a build.
+Results from different configurations or checksums are reported, since their timings are not comparable.
+"""
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path, "r") as f:
+        return json.load(f)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two utility_bench JSON results.")
+    parser.add_argument("baseline", help="Baseline results")
+    parser.add_argument("current", help="Current results")
+    parser.add_argument("--threshold", type=float, default=10.0, help="Allowed mean latency growth, percent (default 10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+    if baseline.get("config") != current.get("config"):
+        print("** The results are from different configurations, the timings are not comparable **")
+    if baseline.get("isa") != current.get("isa"):
+        print("Zero scan ISA differs: %s, %s." % (baseline.get("isa"), current.get("isa")))
+
+    base_results = {r["name"]: r for r in baseline["results"]}
+    regressions = 0
+    print("%-26s %12s %12s %9s %10s  %s" % ("Benchmark", "Base us", "Current us", "Change", "Allocs", ""))
+    for r in current["results"]:
+        base = base_results.get(r["name"])
+        if base is None:
+            print("%-26s %12s %12.2f %9s %10u  new" % (r["name"], "-", r["meanUs"], "-", r["allocations"]))
+            continue
+
+        change = ((r["meanUs"] - base["meanUs"]) * 100.0 / base["meanUs"]) if base["meanUs"] > 0 else 0.0
+        notes = []
+        if change > args.threshold:
+            notes.append("SLOWER")
+        if r["allocations"] > base["allocations"]:
+            notes.append("MORE ALLOCATIONS (%u)" % base["allocations"])
+        if r["check"] != base["check"]:
+            notes.append("RESULTS DIFFER")
+        regressions += 1 if notes else 0
+        print("%-26s %12.2f %12.2f %8.1f%% %10u  %s" % (r["name"], base["meanUs"], r["meanUs"], change, r["allocations"], " ".join(notes)))
+
+    if regressions:
+        print("\n%u regressions." % regressions)
+        return 1
+    print("\nNo regressions.")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
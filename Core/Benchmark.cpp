@@ -0,0 +1,433 @@
+// Benchmark suite for the core side of the plugin commands, over a generated database.
+// Times each command per call, and counts the heap allocations made during the calls:
+//   FindNext/PrevXRef     Anchor flag walk from random points in the dense xref and the sparse label segments
+//   FindNext/PrevNotZ     Whole zero table scans, and short hops in half zero data
+//   FindNext/PrevValue    Whole zero table scans for a value, and a pointer range search through random data
+//   ConvertByteRuns       Padding and string runs of a whole segment, and next run hops in the data
+//   SetDataDwords/Qwords  Fill run bounds from random points in the sparse label segment
+//   StubRenamer           Candidate filter and classification of every function
+//   CloneNamer            Byte table, hashing and clustering of the small functions
+//   StubRenamer           Fingerprint file lookup of every small function
+// Writes a table to stdout and with "--json" the results for "BenchCompare.py" to diff between versions.
+#include "SyntheticDatabase.h"
+#include "ByteRuns.h"
+#include "Fingerprints.h"
+#include "FuncClusters.h"
+#include "Navigation.h"
+#include "StubClassifier.h"
+#include "ValueScan.h"
+#include "ZeroScan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+const uint32_t BENCH_VERSION = 1;
+
+// ======================================================================================
+
+// Global allocation counters, only the counts taken around each call go into the results
+static std::atomic<uint64_t> s_allocations(0);
+static std::atomic<uint64_t> s_allocatedBytes(0);
+
+void *operator new(size_t size)
+{
+	s_allocations++;
+	s_allocatedBytes += size;
+	if (void *p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static double timeStamp()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct BENCHRESULT
+{
+	std::string name;
+	uint32_t calls;
+	double totalTime;         // Seconds
+	double meanUs, p50Us, p99Us, maxUs;
+	uint64_t elements;        // Bytes or functions processed, over all the calls
+	uint64_t allocations;     // Over all the calls
+	uint64_t allocatedBytes;
+	uint64_t check;           // Result checksum, to see the runs did the same work
+};
+
+// Time 'calls' calls of 'func(i, elements)', which returns a value for the checksum
+template <typename FUNC> static BENCHRESULT measure(const char *name, uint32_t calls, FUNC func)
+{
+	BENCHRESULT r = {};
+	r.name = name;
+	r.calls = calls;
+	std::vector<double> latencies;
+	latencies.reserve(calls);
+	for (uint32_t i = 0; i < calls; i++)
+	{
+		uint64_t allocations = s_allocations, allocatedBytes = s_allocatedBytes;
+		double startTime = timeStamp();
+		uint64_t elements = 0;
+		r.check += func(i, elements);
+		double t = (timeStamp() - startTime);
+		r.allocations += (s_allocations - allocations);
+		r.allocatedBytes += (s_allocatedBytes - allocatedBytes);
+		r.elements += elements;
+		r.totalTime += t;
+		latencies.push_back(t * 1000000.0);
+	}
+
+	std::sort(latencies.begin(), latencies.end());
+	r.meanUs = ((r.totalTime * 1000000.0) / calls);
+	r.p50Us = latencies[latencies.size() / 2];
+	r.p99Us = latencies[std::min((size_t) ((latencies.size() * 99) / 100), (latencies.size() - 1))];
+	r.maxUs = latencies.back();
+	printf(" %-26s %8u %12.2f %12.2f %12.2f %14.0f %10llu\n", name, calls, r.meanUs, r.p50Us, r.p99Us,
+		((r.totalTime > 0.0) ? ((double) r.elements / r.totalTime) : 0.0), (unsigned long long) r.allocations);
+	return r;
+}
+
+// The FindNext/PrevXRef anchors: any xref, name or label
+static bool isAnchorFlags(uint32_t flags) { return((flags & (DBF_REF | DBF_NAME | DBF_LABL)) != 0); }
+
+static uint64_t addressCheck(EA ea) { return((ea != BAD_EA) ? ea : 0); }
+
+// ======================================================================================
+
+static void usage(const char *exe)
+{
+	SYNTHCONFIG c = DefaultSynthConfig();
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --bits <32|64>          Database bitness (%u)\n"
+		"  --functions <n>         Tiny function count (%u)\n"
+		"  --stub-ratio <0..1>     Share of the functions that are stubs (%.2f)\n"
+		"  --zero-mb <n>           Zero table size (%llu)\n"
+		"  --data-mb <n>           Sparse label segment size (%llu)\n"
+		"  --label-spacing <n>     Bytes between labels (%u)\n"
+		"  --rdata-mb <n>          Dense xref segment size (%llu)\n"
+		"  --xref-spacing <n>      Average bytes between xrefs (%u)\n"
+		"  --calls <n>             Calls per point lookup benchmark (1000)\n"
+		"  --scans <n>             Calls per whole segment/function scan benchmark (10)\n"
+		"  --seed <n>              Generator seed (%u)\n"
+		"  --json <path>           Write the results as JSON\n",
+		exe, (c.is64 ? 64 : 32), c.functions, c.stubRatio, (unsigned long long) (c.zeroBytes >> 20), (unsigned long long) (c.dataBytes >> 20),
+		c.labelSpacing, (unsigned long long) (c.rdataBytes >> 20), c.xrefSpacing, c.seed);
+}
+
+int main(int argc, char *argv[])
+{
+	SYNTHCONFIG config = DefaultSynthConfig();
+	uint32_t calls = 1000, scans = 10;
+	const char *jsonPath = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		const char *value = (((i + 1) < argc) ? argv[i + 1] : NULL);
+		if (!value)
+		{
+			usage(argv[0]);
+			return 1;
+		}
+		i++;
+
+		if (strcmp(arg, "--bits") == 0)
+			config.is64 = (atoi(value) == 64);
+		else
+		if (strcmp(arg, "--functions") == 0)
+			config.functions = (uint32_t) strtoul(value, NULL, 10);
+		else
+		if (strcmp(arg, "--stub-ratio") == 0)
+			config.stubRatio = atof(value);
+		else
+		if (strcmp(arg, "--zero-mb") == 0)
+			config.zeroBytes = (strtoull(value, NULL, 10) << 20);
+		else
+		if (strcmp(arg, "--data-mb") == 0)
+			config.dataBytes = (strtoull(value, NULL, 10) << 20);
+		else
+		if (strcmp(arg, "--label-spacing") == 0)
+			config.labelSpacing = (uint32_t) strtoul(value, NULL, 10);
+		else
+		if (strcmp(arg, "--rdata-mb") == 0)
+			config.rdataBytes = (strtoull(value, NULL, 10) << 20);
+		else
+		if (strcmp(arg, "--xref-spacing") == 0)
+			config.xrefSpacing = (uint32_t) strtoul(value, NULL, 10);
+		else
+		if (strcmp(arg, "--calls") == 0)
+			calls = std::max((uint32_t) strtoul(value, NULL, 10), 1u);
+		else
+		if (strcmp(arg, "--scans") == 0)
+			scans = std::max((uint32_t) strtoul(value, NULL, 10), 1u);
+		else
+		if (strcmp(arg, "--seed") == 0)
+			config.seed = (uint32_t) strtoul(value, NULL, 10);
+		else
+		if (strcmp(arg, "--json") == 0)
+			jsonPath = value;
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	double startTime = timeStamp();
+	SyntheticDatabase db(config);
+	double generateTime = (timeStamp() - startTime);
+	printf("Generated %ubit database, %u functions (%u stubs), %zu segments, %016llX to %016llX, in %.2f s.\n", (config.is64 ? 64 : 32), config.functions,
+		db.StubCount(), db.SegmentCount(), (unsigned long long) db.MinEa(), (unsigned long long) db.MaxEa(), generateTime);
+	printf("Zero scan: %s, value scan: %s, byte runs: %s\n\n", ZeroScanISA(), ValueScanISA(db.Is64() ? sizeof(uint64_t) : sizeof(uint32_t)), ByteRunsISA());
+
+	DBSEGMENT zero = db.Segment(db.FindSegment(".zero"));
+	DBSEGMENT data = db.Segment(db.FindSegment(".data"));
+	DBSEGMENT rdata = db.Segment(db.FindSegment(".rdata"));
+	DBSEGMENT text = db.Segment(db.FindSegment(".text"));
+
+	// The same random start points for every run of a seed
+	std::mt19937_64 rng(config.seed);
+	auto randomPoints = [&rng](const DBSEGMENT &seg, uint32_t count, uint32_t align)
+	{
+		std::vector<EA> points(count);
+		for (EA &ea : points)
+			ea = ((seg.startEa + (rng() % (seg.endEa - seg.startEa))) & ~(EA) (align - 1));
+		return points;
+	};
+	std::vector<EA> densePoints = randomPoints(rdata, calls, 1);
+	std::vector<EA> sparsePoints = randomPoints(data, calls, 1);
+	std::vector<EA> fillPoints = randomPoints(data, calls, 8);
+
+	StubClassifier classifier;
+	std::vector<std::string> errors;
+	classifier.Parse(STUB_BUILTIN_PATTERNS, "built-in", errors);
+	classifier.Compile(db.Is64());
+	classifier.SetImports(db);
+
+	printf(" %-26s %8s %12s %12s %12s %14s %10s\n", "Benchmark", "Calls", "Mean us", "P50 us", "P99 us", "Elements/s", "Allocs");
+	std::vector<BENCHRESULT> results;
+
+	// FindNext/PrevXRef, the elements are the bytes walked
+	results.push_back(measure("FindNextXRef.dense", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = db.NextThat(densePoints[i], db.MaxEa(), isAnchorFlags);
+		elements = (((hit != BAD_EA) ? hit : db.MaxEa()) - densePoints[i]);
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindPrevXRef.dense", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = db.PrevThat(densePoints[i], db.MinEa(), isAnchorFlags);
+		elements = (densePoints[i] - ((hit != BAD_EA) ? hit : db.MinEa()));
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindNextXRef.sparse", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = db.NextThat(sparsePoints[i], db.MaxEa(), isAnchorFlags);
+		elements = (((hit != BAD_EA) ? hit : db.MaxEa()) - sparsePoints[i]);
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindPrevXRef.sparse", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = db.PrevThat(sparsePoints[i], db.MinEa(), isAnchorFlags);
+		elements = (sparsePoints[i] - ((hit != BAD_EA) ? hit : db.MinEa()));
+		return addressCheck(hit);
+	}));
+
+	// FindNext/PrevNotZ, the whole zero table each way, then hops through half zero data
+	results.push_back(measure("FindNextNotZ.zeroTable", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = ScanNextNotZero(db, zero.startEa, zero.endEa);
+		elements = (((hit != BAD_EA) ? hit : zero.endEa) - zero.startEa);
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindPrevNotZ.zeroTable", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		EA endEa = (zero.endEa - 8);
+		EA hit = ScanPrevNotZero(db, zero.startEa, endEa);
+		elements = (endEa - ((hit != BAD_EA) ? hit : zero.startEa));
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindNextNotZ.data", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = ScanNextNotZero(db, sparsePoints[i], data.endEa);
+		elements = (((hit != BAD_EA) ? hit : data.endEa) - sparsePoints[i]);
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindPrevNotZ.data", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = ScanPrevNotZero(db, data.startEa, sparsePoints[i]);
+		elements = (sparsePoints[i] - ((hit != BAD_EA) ? hit : data.startEa));
+		return addressCheck(hit);
+	}));
+
+	// FindNext/PrevValue, a value that isn't in the zero table, then pointers into the code through random bytes
+	uint32_t ptrSize = (db.Is64() ? sizeof(uint64_t) : sizeof(uint32_t));
+	VALUEQUERY missing = ValueEqualQuery(ptrSize, 0x1234);
+	VALUEQUERY codePointers = ValueRangeQuery(ptrSize, text.startEa, (text.endEa - 1));
+	results.push_back(measure("FindNextValue.zeroTable", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = ScanNextValue(db, zero.startEa, zero.endEa, missing);
+		elements = (((hit != BAD_EA) ? hit : zero.endEa) - zero.startEa);
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindPrevValue.zeroTable", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = ScanPrevValue(db, zero.startEa, zero.endEa, missing);
+		elements = (zero.endEa - ((hit != BAD_EA) ? hit : zero.startEa));
+		return addressCheck(hit);
+	}));
+	results.push_back(measure("FindNextValue.codePointers", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA hit = ScanNextValue(db, densePoints[i], rdata.endEa, codePointers);
+		elements = (((hit != BAD_EA) ? hit : rdata.endEa) - densePoints[i]);
+		return addressCheck(hit);
+	}));
+
+	// Padding and string runs, the elements are the bytes classified
+	std::vector<BYTERUN> byteRuns;
+	results.push_back(measure("ConvertByteRuns.rdata", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		byteRuns.clear();
+		FindByteRuns(db, rdata.startEa, rdata.endEa, rdata.startEa, rdata.endEa, BYTERUNS_ALL, byteRuns);
+		elements = (rdata.endEa - rdata.startEa);
+		return (uint64_t) byteRuns.size();
+	}));
+	results.push_back(measure("FindNextString.data", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		BYTERUN run;
+		bool found = ScanNextByteRun(db, data.startEa, data.endEa, sparsePoints[i], data.endEa, BYTERUNS_STRINGS, run);
+		elements = ((found ? run.startEa : data.endEa) - sparsePoints[i]);
+		return (found ? run.startEa : 0);
+	}));
+
+	// SetDataDwords/Qwords fill run bounds, the elements are the run bytes
+	results.push_back(measure("SetDataDwords.extent", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA startEa, endEa;
+		FILLSTATUS status = FindFillBounds(db, fillPoints[i], sizeof(uint32_t), startEa, endEa);
+		elements = ((status == FILL_OK) ? (endEa - startEa) : 0);
+		return (uint64_t) status;
+	}));
+	results.push_back(measure("SetDataQwords.extent", calls, [&](uint32_t i, uint64_t &elements)
+	{
+		EA startEa, endEa;
+		FILLSTATUS status = FindFillBounds(db, fillPoints[i], sizeof(uint64_t), startEa, endEa);
+		elements = ((status == FILL_OK) ? (endEa - startEa) : 0);
+		return (uint64_t) status;
+	}));
+
+	// StubRenamer classification pass, the elements are functions
+	results.push_back(measure("StubRenamer.classify", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		uint64_t matched = 0;
+		size_t count = db.FunctionCount();
+		for (size_t n = 0; n < count; n++)
+		{
+			DBFUNCTION f = db.Function(n);
+			if (!IsStubCandidate(f))
+				continue;
+			size_t size = (size_t) (f.endEa - f.startEa), inited;
+			const uint8_t *bytes = db.ReadBytes(f.startEa, size, true, inited);
+			if ((inited == size) && (classifier.Match(bytes, size, f.startEa) != STUB_NO_MATCH))
+				matched++;
+		}
+		elements = count;
+		return matched;
+	}));
+
+	uint64_t matched = (results.back().check / scans);
+
+	// CloneNamer clustering pass, single threaded, the elements are functions
+	CLONETABLE clones;
+	FUNCCLUSTERS clusters;
+	results.push_back(measure("CloneNamer.cluster", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		clones.Clear();
+		size_t count = db.FunctionCount();
+		for (size_t n = 0; n < count; n++)
+		{
+			DBFUNCTION f = db.Function(n);
+			if (!IsCloneCandidate(f))
+				continue;
+			size_t size = (size_t) (f.endEa - f.startEa), inited;
+			const uint8_t *bytes = db.ReadBytes(f.startEa, size, true, inited);
+			if (inited == size)
+				clones.Add(bytes, size);
+		}
+		clones.hashes.resize(clones.Count());
+		clones.Hash(0, clones.Count());
+		ClusterFunctions(clones, clusters);
+		elements = count;
+		return (uint64_t) clusters.Count();
+	}));
+
+	// Fingerprint file lookups, over a file of all the small functions
+	const char *printsPath = "utility_bench.ufp";
+	std::vector<FINGERPRINT> prints;
+	for (size_t n = 0; n < clones.Count(); n++)
+	{
+		FINGERPRINT print = { clones.hashes[n], (uint32_t) clones.Size(n), 0, ("func_" + std::to_string(n)) };
+		NormalizeFingerprintName(print);
+		prints.push_back(print);
+	}
+	uint32_t written, ambiguous;
+	std::string error;
+	FingerprintFile printsFile;
+	if (!WriteFingerprints(printsPath, prints, written, ambiguous, error) || !printsFile.Open(printsPath, error))
+	{
+		fprintf(stderr, "** %s **\n", error.c_str());
+		return 1;
+	}
+	std::vector<FINGERPRINT>().swap(prints);
+	results.push_back(measure("StubRenamer.fingerprints", scans, [&](uint32_t i, uint64_t &elements)
+	{
+		uint64_t found = 0;
+		for (size_t n = 0; n < clones.Count(); n++)
+			found += (printsFile.Find(HashFunctionBytes(clones.Bytes(n), clones.Size(n)), (uint32_t) clones.Size(n)) != NULL);
+		elements = clones.Count();
+		return found;
+	}));
+	printsFile.Close();
+	remove(printsPath);
+	if (matched != db.StubCount())
+		printf("\n** Stub classifier matched %llu of %u generated stubs! **\n", (unsigned long long) matched, db.StubCount());
+
+	if (jsonPath)
+	{
+		FILE *fp = fopen(jsonPath, "wb");
+		if (!fp)
+		{
+			fprintf(stderr, "** Failed to create \"%s\" **\n", jsonPath);
+			return 1;
+		}
+		fprintf(fp, "{\n  \"version\": %u,\n  \"isa\": \"%s\",\n", BENCH_VERSION, ZeroScanISA());
+		fprintf(fp, "  \"config\": {\n    \"bits\": %u,\n    \"functions\": %u,\n    \"stubRatio\": %.4f,\n    \"zeroBytes\": %llu,\n    \"dataBytes\": %llu,\n"
+			"    \"labelSpacing\": %u,\n    \"rdataBytes\": %llu,\n    \"xrefSpacing\": %u,\n    \"calls\": %u,\n    \"scans\": %u,\n    \"seed\": %u\n  },\n",
+			(config.is64 ? 64 : 32), config.functions, config.stubRatio, (unsigned long long) config.zeroBytes, (unsigned long long) config.dataBytes,
+			config.labelSpacing, (unsigned long long) config.rdataBytes, config.xrefSpacing, calls, scans, config.seed);
+		fprintf(fp, "  \"generateTime\": %.6f,\n  \"stubs\": %u,\n  \"stubsMatched\": %llu,\n  \"results\": [", generateTime, db.StubCount(), (unsigned long long) matched);
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const BENCHRESULT &r = results[i];
+			fprintf(fp, "%s\n    {\n      \"name\": \"%s\",\n      \"calls\": %u,\n      \"totalTime\": %.9f,\n      \"meanUs\": %.3f,\n      \"p50Us\": %.3f,\n"
+				"      \"p99Us\": %.3f,\n      \"maxUs\": %.3f,\n      \"elements\": %llu,\n      \"elementsPerSecond\": %.1f,\n      \"allocations\": %llu,\n"
+				"      \"allocatedBytes\": %llu,\n      \"check\": %llu\n    }",
+				((i == 0) ? "" : ","), r.name.c_str(), r.calls, r.totalTime, r.meanUs, r.p50Us, r.p99Us, r.maxUs, (unsigned long long) r.elements,
+				((r.totalTime > 0.0) ? ((double) r.elements / r.totalTime) : 0.0), (unsigned long long) r.allocations, (unsigned long long) r.allocatedBytes,
+				(unsigned long long) r.check);
+		}
+		fprintf(fp, "\n  ]\n}\n");
+		fclose(fp);
+		printf("\nResults: \"%s\".\n", jsonPath);
+	}
+	return 0;
+}
@@ -0,0 +1,394 @@
+// Padding and string run search.
+// The SIMD part only reduces each 64 byte block to four bitmaps, a run starts and ends where a bitmap toggles,
+// so the scalar part costs per run rather than per byte. The UTF-16 bitmap is derived from the other two:
+// a printable byte at an even address with a zero byte after it, widened to cover both bytes.
+#include "ByteRuns.h"
+#include "ZeroScan.h"
+#include <string.h>
+#include <algorithm>
+
+#ifdef CORE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// Bytes of context read before a search range start, to tell if a run starts there, and after a chunk for the runs cut at its end
+static const size_t RUN_LEAD = 2;
+static const size_t RUN_OVERLAP = (MAX_BYTE_RUN + RUN_LEAD);
+// First chunk of a forward walk, doubling up to SCAN_CHUNK_SIZE, the next run is usually close
+static const size_t FIRST_CHUNK_SIZE = (16 * 1024);
+
+static const size_t MASK_BATCH = 64; // Blocks classified per call
+
+struct BLOCKMASKS
+{
+	uint64_t zero, cc, nop, print;
+};
+
+static inline bool isStringChar(uint8_t c) { return(((c >= 0x20) && (c < 0x7F)) || (c == '\t') || (c == '\r') || (c == '\n')); }
+
+static void blockMasksScalar(const uint8_t *p, size_t blocks, BLOCKMASKS *masks)
+{
+	for (size_t b = 0; b < blocks; b++, p += 64)
+	{
+		BLOCKMASKS m = {};
+		for (uint32_t i = 0; i < 64; i++)
+		{
+			uint64_t bit = (1ull << i);
+			if (p[i] == 0)
+				m.zero |= bit;
+			else
+			if (p[i] == 0xCC)
+				m.cc |= bit;
+			else
+			if (p[i] == 0x90)
+				m.nop |= bit;
+			else
+			if (isStringChar(p[i]))
+				m.print |= bit;
+		}
+		masks[b] = m;
+	}
+}
+
+#ifdef CORE_X86
+// Printable is (c - 0x20) < 0x5F unsigned, done signed with the sign bit flipped, or a tab, CR or LF
+static inline void masks16(__m128i v, uint32_t shift, BLOCKMASKS &m)
+{
+	__m128i t = _mm_xor_si128(_mm_sub_epi8(v, _mm_set1_epi8(0x20)), _mm_set1_epi8((char) 0x80));
+	__m128i print = _mm_cmplt_epi8(t, _mm_set1_epi8((char) (0x5F ^ 0x80)));
+	print = _mm_or_si128(print, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')))));
+	m.zero |= ((uint64_t) (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) << shift);
+	m.cc |= ((uint64_t) (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char) 0xCC))) << shift);
+	m.nop |= ((uint64_t) (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8((char) 0x90))) << shift);
+	m.print |= ((uint64_t) (uint32_t) _mm_movemask_epi8(print) << shift);
+}
+
+static void blockMasksSSE2(const uint8_t *p, size_t blocks, BLOCKMASKS *masks)
+{
+	for (size_t b = 0; b < blocks; b++, p += 64)
+	{
+		BLOCKMASKS m = {};
+		masks16(_mm_loadu_si128((const __m128i*) p), 0, m);
+		masks16(_mm_loadu_si128((const __m128i*) (p + 16)), 16, m);
+		masks16(_mm_loadu_si128((const __m128i*) (p + 32)), 32, m);
+		masks16(_mm_loadu_si128((const __m128i*) (p + 48)), 48, m);
+		masks[b] = m;
+	}
+}
+
+AVX2_TARGET static inline void masks32(__m256i v, uint32_t shift, BLOCKMASKS &m)
+{
+	__m256i t = _mm256_xor_si256(_mm256_sub_epi8(v, _mm256_set1_epi8(0x20)), _mm256_set1_epi8((char) 0x80));
+	__m256i print = _mm256_cmpgt_epi8(_mm256_set1_epi8((char) (0x5F ^ 0x80)), t);
+	print = _mm256_or_si256(print, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')))));
+	m.zero |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256())) << shift);
+	m.cc |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char) 0xCC))) << shift);
+	m.nop |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8((char) 0x90))) << shift);
+	m.print |= ((uint64_t) (uint32_t) _mm256_movemask_epi8(print) << shift);
+}
+
+AVX2_TARGET static void blockMasksAVX2(const uint8_t *p, size_t blocks, BLOCKMASKS *masks)
+{
+	for (size_t b = 0; b < blocks; b++, p += 64)
+	{
+		BLOCKMASKS m = {};
+		masks32(_mm256_loadu_si256((const __m256i*) p), 0, m);
+		masks32(_mm256_loadu_si256((const __m256i*) (p + 32)), 32, m);
+		masks[b] = m;
+	}
+}
+#endif // CORE_X86
+
+typedef void (*MASKFUNC)(const uint8_t *p, size_t blocks, BLOCKMASKS *masks);
+struct MASKFUNCS
+{
+	MASKFUNC blockMasks;
+	const char *isa;
+};
+
+static MASKFUNCS selectMaskFuncs()
+{
+#ifdef CORE_X86
+	if (HasAVX2())
+		return { blockMasksAVX2, "AVX2" };
+	return { blockMasksSSE2, "SSE2" };
+#else
+	return { blockMasksScalar, "scalar" };
+#endif
+}
+
+static const MASKFUNCS &maskFuncs()
+{
+	static const MASKFUNCS funcs = selectMaskFuncs();
+	return funcs;
+}
+
+const char *ByteRunsISA() { return maskFuncs().isa; }
+
+const char *ByteRunKindName(BYTERUNKIND kind)
+{
+	static const char *const names[BYTERUN_KIND_COUNT] = { "Padding", "ASCII", "UTF-16" };
+	return((kind < BYTERUN_KIND_COUNT) ? names[kind] : "?");
+}
+
+// ======================================================================================
+
+// The open run of a bitmap, 'carry' is the previous block's last bit
+struct BITRUN
+{
+	uint64_t carry;
+	size_t start;
+};
+
+// Call 'close(start, end)' for each run of set bits that ends in the block at 'base'
+template <typename CLOSE> static inline void bitRuns(uint64_t w, size_t base, BITRUN &r, CLOSE close)
+{
+	uint64_t t = (w ^ ((w << 1) | r.carry));
+	r.carry = (w >> 63);
+	while (t)
+	{
+		uint32_t i = LowestBit64(t);
+		if ((w >> i) & 1)
+			r.start = (base + i);
+		else
+			close(r.start, (base + i));
+		t &= (t - 1);
+	}
+}
+
+// Validates the bitmap runs of a buffer into byte runs
+class RunFinder
+{
+public:
+	RunFinder(const uint8_t *bytes, size_t size, EA ea, bool endCut, uint32_t kinds, std::vector<BYTERUN> &runs) :
+		m_bytes(bytes), m_size(size), m_ea(ea), m_endCut(endCut), m_kinds(kinds), m_runs(runs), m_pairCarry(0)
+	{
+		memset(m_bitRuns, 0, sizeof(m_bitRuns));
+		// UTF-16 characters start at even addresses
+		m_evenMask = ((ea & 1) ? 0xAAAAAAAAAAAAAAAAull : 0x5555555555555555ull);
+	}
+
+	void Block(const BLOCKMASKS &m, size_t base)
+	{
+		if (m_kinds & BYTERUNS_PADDING)
+		{
+			bitRuns(m.zero, base, m_bitRuns[0], [this](size_t start, size_t end) { padding(start, end, 0x00); });
+			bitRuns(m.cc, base, m_bitRuns[1], [this](size_t start, size_t end) { padding(start, end, 0xCC); });
+			bitRuns(m.nop, base, m_bitRuns[2], [this](size_t start, size_t end) { padding(start, end, 0x90); });
+		}
+		if (m_kinds & (1 << BYTERUN_ASCII))
+			bitRuns(m.print, base, m_bitRuns[3], [this](size_t start, size_t end) { ascii(start, end); });
+		if (m_kinds & (1 << BYTERUN_UTF16))
+		{
+			// The zero byte after the block's last one is the next block's first
+			uint64_t nextZero = ((((base + 64) < m_size) && (m_bytes[base + 64] == 0)) ? 1 : 0);
+			uint64_t chars = (m.print & ((m.zero >> 1) | (nextZero << 63)) & m_evenMask);
+			uint64_t pairs = (chars | (chars << 1) | m_pairCarry);
+			m_pairCarry = (chars >> 63);
+			bitRuns(pairs, base, m_bitRuns[4], [this](size_t start, size_t end) { utf16(start, end); });
+		}
+	}
+
+	// Close the runs still open at the buffer end
+	void Finish()
+	{
+		if (m_bitRuns[0].carry)
+			padding(m_bitRuns[0].start, m_size, 0x00);
+		if (m_bitRuns[1].carry)
+			padding(m_bitRuns[1].start, m_size, 0xCC);
+		if (m_bitRuns[2].carry)
+			padding(m_bitRuns[2].start, m_size, 0x90);
+		if (m_bitRuns[3].carry)
+			ascii(m_bitRuns[3].start, m_size);
+		if (m_bitRuns[4].carry)
+			utf16(m_bitRuns[4].start, m_size);
+	}
+
+private:
+	// Fill up to an address aligned to the next power of two above its length
+	void padding(size_t start, size_t end, uint8_t fill)
+	{
+		size_t length = (end - start);
+		if ((length < MIN_PADDING_RUN) || (m_endCut && (end == m_size)))
+			return;
+		uint32_t alignment = (HighestBit64(length) + 1);
+		if ((alignment > MAX_PADDING_ALIGN) || (((m_ea + end) & ((1ull << alignment) - 1)) != 0))
+			return;
+		m_runs.push_back({ (m_ea + start), (uint32_t) length, (uint8_t) BYTERUN_PADDING, fill, (uint8_t) alignment });
+	}
+
+	// Terminated right after, a run at the buffer end has no terminator to see
+	void ascii(size_t start, size_t end)
+	{
+		size_t length = (end - start);
+		if ((length < MIN_STRING_CHARS) || ((length + 1) > MAX_BYTE_RUN) || (end >= m_size) || m_bytes[end])
+			return;
+		m_runs.push_back({ (m_ea + start), (uint32_t) (length + 1), (uint8_t) BYTERUN_ASCII, 0, 0 });
+	}
+
+	void utf16(size_t start, size_t end)
+	{
+		size_t length = (end - start);
+		if (((length / 2) < MIN_STRING_CHARS) || ((length + 2) > MAX_BYTE_RUN) || ((end + 1) >= m_size) || m_bytes[end] || m_bytes[end + 1])
+			return;
+		m_runs.push_back({ (m_ea + start), (uint32_t) (length + 2), (uint8_t) BYTERUN_UTF16, 0, 0 });
+	}
+
+	const uint8_t *m_bytes;
+	size_t m_size;
+	EA m_ea;
+	bool m_endCut;
+	uint32_t m_kinds;
+	std::vector<BYTERUN> &m_runs;
+	BITRUN m_bitRuns[5]; // Zero, 0xCC, 0x90, printable, UTF-16 pairs
+	uint64_t m_evenMask, m_pairCarry;
+};
+
+void FindBufferRuns(const uint8_t *bytes, size_t size, EA ea, bool endCut, uint32_t kinds, std::vector<BYTERUN> &runs)
+{
+	size_t first = runs.size();
+	RunFinder finder(bytes, size, ea, endCut, kinds, runs);
+	BLOCKMASKS masks[MASK_BATCH];
+	MASKFUNC blockMasks = maskFuncs().blockMasks;
+	for (size_t offset = 0; offset < size; offset += (MASK_BATCH * 64))
+	{
+		size_t count = std::min((size - offset), (MASK_BATCH * 64));
+		size_t blocks = (count / 64);
+		blockMasks((bytes + offset), blocks, masks);
+		if (count % 64)
+		{
+			// The partial last block, padded with a byte of no class
+			uint8_t tail[64];
+			memset(tail, 0x01, sizeof(tail));
+			memcpy(tail, (bytes + offset + (blocks * 64)), (count % 64));
+			blockMasksScalar(tail, 1, &masks[blocks++]);
+		}
+		for (size_t b = 0; b < blocks; b++)
+			finder.Block(masks[b], (offset + (b * 64)));
+	}
+	finder.Finish();
+
+	// In address order. The zeros from a string's terminator on are padding only after it.
+	std::sort((runs.begin() + first), runs.end(), [](const BYTERUN &a, const BYTERUN &b) { return(a.startEa < b.startEa); });
+	size_t out = first;
+	EA stringEnd = 0;
+	for (size_t i = first; i < runs.size(); i++)
+	{
+		BYTERUN run = runs[i];
+		if (run.kind == BYTERUN_PADDING)
+		{
+			if (run.startEa < stringEnd)
+			{
+				EA endEa = (run.startEa + run.size);
+				if ((endEa <= stringEnd) || ((endEa - stringEnd) < MIN_PADDING_RUN))
+					continue;
+				run.startEa = stringEnd;
+				run.size = (uint32_t) (endEa - stringEnd);
+				run.alignment = (uint8_t) (HighestBit64(run.size) + 1);
+			}
+		}
+		else
+			stringEnd = (run.startEa + run.size);
+		runs[out++] = run;
+	}
+	runs.resize(out);
+}
+
+// ======================================================================================
+
+static bool isInitedFlags(uint32_t flags) { return((flags & DBF_IVL) != 0); }
+
+// Call 'found(run)' for the runs that start in [fromEa, toEa) of the segment range [startEa, endEa), in order, until it returns false.
+// Chunks overlap by RUN_OVERLAP, the runs are only taken from the part before it, so every run is whole in the chunk it's taken from.
+// They start at 'chunkSize' (more than RUN_OVERLAP) and double up to SCAN_CHUNK_SIZE.
+template <typename FOUND> static void walkRuns(const IDatabase &db, EA startEa, EA endEa, EA fromEa, EA toEa, uint32_t kinds, size_t chunkSize, FOUND found)
+{
+	std::vector<BYTERUN> runs;
+	EA readEnd = (((endEa - toEa) > RUN_OVERLAP) ? (toEa + RUN_OVERLAP) : endEa);
+	EA ea = (((fromEa - startEa) > RUN_LEAD) ? (fromEa - RUN_LEAD) : startEa);
+	while ((ea < readEnd) && (fromEa < toEa))
+	{
+		if (!isInitedFlags(db.Flags(ea)))
+		{
+			ea = db.NextInited(ea, readEnd);
+			if (ea == BAD_EA)
+				break;
+			fromEa = std::max(fromEa, ea);
+			continue;
+		}
+
+		size_t size = (size_t) std::min((EA) chunkSize, (readEnd - ea));
+		chunkSize = std::min((chunkSize * 2), SCAN_CHUNK_SIZE);
+		size_t inited;
+		const uint8_t *bytes = db.ReadBytes(ea, size, true, inited);
+		if (inited == 0)
+			break;
+
+		// Past the last chunk of the read range the bytes still continue if the segment does
+		bool endCut = ((inited == size) && ((ea + inited) < endEa));
+		runs.clear();
+		FindBufferRuns(bytes, inited, ea, endCut, kinds, runs);
+		EA takeEnd = std::min((endCut ? ((ea + inited) - RUN_OVERLAP) : (ea + inited)), toEa);
+		for (const BYTERUN &run : runs)
+		{
+			if ((run.startEa >= fromEa) && (run.startEa < takeEnd) && !found(run))
+				return;
+		}
+
+		if (endCut)
+		{
+			fromEa = takeEnd;
+			ea = (takeEnd - RUN_LEAD);
+		}
+		else
+		{
+			// An uninitialized span or the end follows, both true run ends
+			ea += inited;
+			fromEa = std::max(fromEa, ea);
+		}
+	}
+}
+
+void FindByteRuns(const IDatabase &db, EA startEa, EA endEa, EA fromEa, EA toEa, uint32_t kinds, std::vector<BYTERUN> &runs)
+{
+	walkRuns(db, startEa, endEa, fromEa, toEa, kinds, FIRST_CHUNK_SIZE, [&runs](const BYTERUN &run) { runs.push_back(run); return true; });
+}
+
+bool ScanNextByteRun(const IDatabase &db, EA startEa, EA endEa, EA fromEa, EA toEa, uint32_t kinds, BYTERUN &run)
+{
+	bool hit = false;
+	walkRuns(db, startEa, endEa, fromEa, toEa, kinds, FIRST_CHUNK_SIZE, [&run, &hit](const BYTERUN &r) { run = r; hit = true; return false; });
+	return hit;
+}
+
+bool ScanPrevByteRun(const IDatabase &db, EA startEa, EA endEa, EA fromEa, EA toEa, uint32_t kinds, BYTERUN &run)
+{
+	// Backwards a window at the time, each sized to be read in one chunk with its context, growing like the forward chunks
+	const size_t CONTEXT_SIZE = (RUN_OVERLAP + RUN_LEAD);
+	size_t chunkSize = FIRST_CHUNK_SIZE;
+	for (EA ea = toEa; ea > fromEa;)
+	{
+		if (!isInitedFlags(db.Flags(ea - 1)))
+		{
+			EA prev = db.PrevInited((ea - 1), fromEa);
+			if (prev == BAD_EA)
+				break;
+			ea = (prev + 1);
+		}
+
+		EA windowSize = (chunkSize - CONTEXT_SIZE);
+		EA windowStart = (((ea - fromEa) > windowSize) ? (ea - windowSize) : fromEa);
+		bool hit = false;
+		walkRuns(db, startEa, endEa, windowStart, ea, kinds, chunkSize, [&run, &hit](const BYTERUN &r) { run = r; hit = true; return true; });
+		if (hit)
+			return true;
+		ea = windowStart;
+		chunkSize = std::min((chunkSize * 2), SCAN_CHUNK_SIZE);
+	}
+	return false;
+}
@@ -0,0 +1,52 @@
+// Padding and string run search, the raw byte runs the FindNext/PrevPadding and FindNext/PrevString commands jump to
+// and the byte run conversion formats as align directives and string literals.
+// Each 64 byte block is classified with SIMD compares into bitmaps (zero, 0xCC, 0x90, printable), then the runs are
+// read off the bitmap transitions.
+#pragma once
+#include "Database.h"
+#include <vector>
+
+enum BYTERUNKIND
+{
+	BYTERUN_PADDING, // 0x00, 0xCC or 0x90 fill up to an aligned address
+	BYTERUN_ASCII,   // Printable 8bit characters, NUL terminated
+	BYTERUN_UTF16,   // Printable 16bit characters, two byte aligned and NUL terminated
+
+	BYTERUN_KIND_COUNT
+};
+
+// Kind masks for the searches
+const uint32_t BYTERUNS_PADDING = (1 << BYTERUN_PADDING);
+const uint32_t BYTERUNS_STRINGS = ((1 << BYTERUN_ASCII) | (1 << BYTERUN_UTF16));
+const uint32_t BYTERUNS_ALL = (BYTERUNS_PADDING | BYTERUNS_STRINGS);
+
+const size_t MIN_PADDING_RUN = 4;          // Shortest padding, in bytes
+const uint32_t MAX_PADDING_ALIGN = 12;     // Padding is shorter than its alignment, up to 4096
+const size_t MIN_STRING_CHARS = 4;         // Shortest string, in characters
+const size_t MAX_BYTE_RUN = 4096;          // Longest run, longer ones (like zero tables or text blobs) aren't found
+
+struct BYTERUN
+{
+	EA startEa;
+	uint32_t size;      // Bytes, strings with their terminator
+	uint8_t kind;       // BYTERUNKIND
+	uint8_t fill;       // Padding byte value
+	uint8_t alignment;  // Padding, log2 of the alignment its end is at
+};
+
+// Find the runs in a buffer at 'ea', in address order. Runs at the buffer start are taken to start there.
+// 'endCut' if the bytes continue past the buffer, then the runs touching its end are left out.
+void FindBufferRuns(const uint8_t *bytes, size_t size, EA ea, bool endCut, uint32_t kinds, std::vector<BYTERUN> &runs);
+
+// Find the runs that start in [fromEa, toEa) inside the segment range [startEa, endEa), appending them in address order.
+// The bytes around [fromEa, toEa) are read as needed to find the runs' true bounds. Uninitialized spans are skipped whole.
+void FindByteRuns(const IDatabase &db, EA startEa, EA endEa, EA fromEa, EA toEa, uint32_t kinds, std::vector<BYTERUN> &runs);
+
+// Get the first/last run that starts in [fromEa, toEa) inside the segment range [startEa, endEa), false if none
+bool ScanNextByteRun(const IDatabase &db, EA startEa, EA endEa, EA fromEa, EA toEa, uint32_t kinds, BYTERUN &run);
+bool ScanPrevByteRun(const IDatabase &db, EA startEa, EA endEa, EA fromEa, EA toEa, uint32_t kinds, BYTERUN &run);
+
+// Kind display name
+const char *ByteRunKindName(BYTERUNKIND kind);
+// Name of the instruction set in use, for benchmark output
+const char *ByteRunsISA();
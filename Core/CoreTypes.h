@@ -0,0 +1,70 @@
+// Portable core library base types and bit helpers.
+// The core has no IDA SDK or Windows dependencies so it can be built, profiled and run anywhere.
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Database address, always 64bit
+typedef uint64_t EA;
+const EA BAD_EA = ~(EA) 0;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CORE_X86
+#endif
+
+// Index of the lowest/highest set bit, 'v' can't be zero
+static inline uint32_t LowestBit32(uint32_t v)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanForward(&bit, v);
+	return bit;
+#else
+	return (uint32_t) __builtin_ctz(v);
+#endif
+}
+
+static inline uint32_t LowestBit64(uint64_t v)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanForward64(&bit, v);
+	return bit;
+#else
+	return (uint32_t) __builtin_ctzll(v);
+#endif
+}
+
+static inline uint32_t HighestBit32(uint32_t v)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanReverse(&bit, v);
+	return bit;
+#else
+	return (uint32_t) (31 - __builtin_clz(v));
+#endif
+}
+
+static inline uint32_t HighestBit64(uint64_t v)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanReverse64(&bit, v);
+	return bit;
+#else
+	return (uint32_t) (63 - __builtin_clzll(v));
+#endif
+}
+
+static inline uint32_t PopCount32(uint32_t v)
+{
+#ifdef _MSC_VER
+	return __popcnt(v);
+#else
+	return (uint32_t) __builtin_popcount(v);
+#endif
+}
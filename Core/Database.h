@@ -0,0 +1,91 @@
+// The small database interface the core algorithms run against.
+// Implemented over the live IDA database by the plugin ("IdaDatabase.h") and over a memory mapped snapshot
+// file by the core ("Snapshot.h").
+#pragma once
+#include "CoreTypes.h"
+#include <string>
+
+// Item flags, the low 32 bits of the IDA ones so the live implementation can pass them through as is
+const uint32_t DBF_VAL_MASK = 0x000000FF; // Byte value, if DBF_IVL
+const uint32_t DBF_IVL      = 0x00000100; // Byte has a value (initialized)
+const uint32_t DBF_CLS_MASK = 0x00000600; // Item class
+const uint32_t DBF_CODE     = 0x00000600;
+const uint32_t DBF_DATA     = 0x00000400;
+const uint32_t DBF_TAIL     = 0x00000200;
+const uint32_t DBF_UNK      = 0x00000000;
+const uint32_t DBF_REF      = 0x00001000; // Has references
+const uint32_t DBF_NAME     = 0x00004000; // Has a name
+const uint32_t DBF_LABL     = 0x00008000; // Has a dummy name
+
+static inline bool IsCodeFlags(uint32_t flags) { return((flags & DBF_CLS_MASK) == DBF_CODE); }
+static inline bool IsUnknownFlags(uint32_t flags) { return((flags & DBF_CLS_MASK) == DBF_UNK); }
+
+// Segment types
+enum DBSEGTYPE
+{
+	DBSEG_OTHER,
+	DBSEG_CODE,
+	DBSEG_DATA,
+	DBSEG_BSS,
+	DBSEG_XTRN,
+};
+
+struct DBSEGMENT
+{
+	EA startEa, endEa;
+	uint32_t type;  // DBSEGTYPE
+	char name[32];
+};
+
+// Function flags
+const uint32_t DBFUNC_NORET = 0x01; // Doesn't return
+const uint32_t DBFUNC_TAIL  = 0x02; // A function tail chunk
+
+struct DBFUNCTION
+{
+	EA startEa, endEa;
+	uint32_t flags; // DBFUNC_xx
+};
+
+// Largest ReadBytes() size
+const size_t SCAN_CHUNK_SIZE = (1024 * 1024);
+
+// Flag test for NextThat()/PrevThat()
+typedef bool (*FLAGTEST)(uint32_t flags);
+
+class IDatabase
+{
+public:
+	virtual ~IDatabase() {}
+
+	virtual bool Is64() const = 0;
+	virtual EA MinEa() const = 0;
+	virtual EA MaxEa() const = 0;
+
+	// Segments, in address order
+	virtual size_t SegmentCount() const = 0;
+	virtual DBSEGMENT Segment(size_t index) const = 0;
+
+	// Item flags of an address, 0 outside of the segments
+	virtual uint32_t Flags(EA ea) const = 0;
+
+	// First address in (ea, endEa) whose flags pass the test, or BAD_EA. Like the SDK next_that().
+	virtual EA NextThat(EA ea, EA endEa, FLAGTEST test) const = 0;
+	// Last address in [startEa, ea) whose flags pass the test, or BAD_EA. Like the SDK prev_that().
+	virtual EA PrevThat(EA ea, EA startEa, FLAGTEST test) const = 0;
+	// First initialized address in (ea, endEa), or last one in [startEa, ea), or BAD_EA. Like the SDK next/prev_inited().
+	virtual EA NextInited(EA ea, EA endEa) const = 0;
+	virtual EA PrevInited(EA ea, EA startEa) const = 0;
+
+	// Get the bytes of [ea, ea + size), 'size' up to SCAN_CHUNK_SIZE and within a segment.
+	// 'inited' gets the count of leading ('forward') or trailing initialized bytes, only those are valid, 0 on failure.
+	// The pointer is good until the next call; depending on the implementation it's a shared buffer, so not thread safe.
+	virtual const uint8_t *ReadBytes(EA ea, size_t size, bool forward, size_t &inited) const = 0;
+
+	// Functions, in address order
+	virtual size_t FunctionCount() const = 0;
+	virtual DBFUNCTION Function(size_t index) const = 0;
+
+	// Get the name at the address, false if it has none
+	virtual bool GetName(EA ea, std::string &name) const = 0;
+};
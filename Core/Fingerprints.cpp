@@ -0,0 +1,194 @@
+// Function fingerprint file
+#include "Fingerprints.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+// Directory size range, about an entry per slot
+const uint32_t MIN_DIRECTORY_BITS = 8;
+const uint32_t MAX_DIRECTORY_BITS = 24;
+
+static inline uint64_t align8(uint64_t offset) { return((offset + 7) & ~(uint64_t) 7); }
+
+static inline bool printLess(const FINGERPRINT &a, const FINGERPRINT &b)
+{
+	return((a.fingerprint != b.fingerprint) ? (a.fingerprint < b.fingerprint) : (a.size < b.size));
+}
+
+void NormalizeFingerprintName(FINGERPRINT &print)
+{
+	// Digits after the last '_', no leading zeros
+	size_t underscore = print.name.rfind('_');
+	if ((underscore == std::string::npos) || (underscore == 0) || ((underscore + 1) == print.name.size()))
+		return;
+	const char *digits = &print.name[underscore + 1];
+	if ((digits[0] == '0') && digits[1])
+		return;
+	for (const char *p = digits; *p; p++)
+	{
+		if ((*p < '0') || (*p > '9'))
+			return;
+	}
+	print.name.resize(underscore + 1);
+	print.flags |= FPF_SERIAL;
+}
+
+void MergeFingerprints(const FingerprintFile &file, std::vector<FINGERPRINT> &prints)
+{
+	std::sort(prints.begin(), prints.end(), printLess);
+	size_t count = prints.size();
+	for (size_t i = 0; i < file.Count(); i++)
+	{
+		const FPENTRY &entry = file.Entry(i);
+		FINGERPRINT print;
+		print.fingerprint = entry.fingerprint;
+		print.size = entry.size;
+		if (!std::binary_search(prints.begin(), (prints.begin() + count), print, printLess))
+		{
+			print.flags = entry.flags;
+			print.name = file.Name(entry);
+			prints.push_back(print);
+		}
+	}
+}
+
+bool WriteFingerprints(const char *path, std::vector<FINGERPRINT> &prints, uint32_t &written, uint32_t &ambiguous, std::string &error)
+{
+	// One entry per fingerprint, if all of its names agree
+	written = ambiguous = 0;
+	std::stable_sort(prints.begin(), prints.end(), printLess);
+	std::vector<FPENTRY> entries;
+	std::string strings;
+	for (size_t i = 0; i < prints.size();)
+	{
+		size_t end = (i + 1);
+		bool same = true;
+		uint32_t flags = prints[i].flags;
+		while ((end < prints.size()) && (prints[end].fingerprint == prints[i].fingerprint) && (prints[end].size == prints[i].size))
+		{
+			same &= ((((prints[end].flags ^ prints[i].flags) & ~FPF_RELOCATED) == 0) && (prints[end].name == prints[i].name));
+			flags |= prints[end].flags;
+			end++;
+		}
+		if (!same)
+			ambiguous++;
+		else
+		if (!prints[i].name.empty() && (strings.size() <= UINT32_MAX))
+		{
+			FPENTRY entry = { prints[i].fingerprint, (uint32_t) strings.size(), (uint16_t) std::min(prints[i].size, (uint32_t) UINT16_MAX), (uint16_t) flags };
+			entries.push_back(entry);
+			strings.append(prints[i].name.c_str(), (prints[i].name.size() + 1));
+		}
+		i = end;
+	}
+
+	FPHEADER header = {};
+	memcpy(header.magic, FINGERPRINT_MAGIC, sizeof(header.magic));
+	header.version = FINGERPRINT_VERSION;
+	header.directoryBits = MIN_DIRECTORY_BITS;
+	while ((header.directoryBits < MAX_DIRECTORY_BITS) && ((1ull << header.directoryBits) < entries.size()))
+		header.directoryBits++;
+
+	// Counting pass over the top bits, then the running sums
+	std::vector<uint32_t> directory(((size_t) 1 << header.directoryBits) + 1, 0);
+	uint32_t shift = (64 - header.directoryBits);
+	for (const FPENTRY &entry : entries)
+		directory[(size_t) (entry.fingerprint >> shift) + 1]++;
+	for (size_t i = 1; i < directory.size(); i++)
+		directory[i] += directory[i - 1];
+
+	header.directoryOffset = align8(sizeof(header));
+	header.entryCount = entries.size();
+	header.entriesOffset = align8(header.directoryOffset + (directory.size() * sizeof(uint32_t)));
+	header.stringsSize = strings.size();
+	header.stringsOffset = (header.entriesOffset + (entries.size() * sizeof(FPENTRY)));
+
+	FILE *fp = fopen(path, "wb");
+	if (!fp)
+	{
+		error = std::string("Failed to create \"") + path + "\"";
+		return false;
+	}
+	static const uint8_t zeros[8] = {};
+	size_t directoryBytes = (directory.size() * sizeof(uint32_t));
+	bool ok = ((fwrite(&header, sizeof(header), 1, fp) == 1) &&
+		(fwrite(zeros, (size_t) (header.directoryOffset - sizeof(header)), 1, fp) <= 1) &&
+		(fwrite(directory.data(), directoryBytes, 1, fp) == 1) &&
+		(fwrite(zeros, (size_t) (header.entriesOffset - (header.directoryOffset + directoryBytes)), 1, fp) <= 1) &&
+		(entries.empty() || (fwrite(entries.data(), (entries.size() * sizeof(FPENTRY)), 1, fp) == 1)) &&
+		(strings.empty() || (fwrite(strings.data(), strings.size(), 1, fp) == 1)));
+	if ((fclose(fp) != 0) || !ok)
+	{
+		error = std::string("Failed to write \"") + path + "\"";
+		return false;
+	}
+	written = (uint32_t) entries.size();
+	return true;
+}
+
+// ======================================================================================
+
+FingerprintFile::FingerprintFile() : m_header(NULL), m_directory(NULL), m_entries(NULL), m_strings(NULL), m_shift(0)
+{
+}
+
+void FingerprintFile::Close()
+{
+	m_file.Close();
+	m_header = NULL;
+	m_directory = NULL;
+	m_entries = NULL;
+	m_strings = NULL;
+}
+
+bool FingerprintFile::Open(const char *path, std::string &error)
+{
+	Close();
+	if (!m_file.Open(path, sizeof(FPHEADER), error))
+		return false;
+
+	// Validate the header and that every table is inside the file. Nothing is read past it here, so opening
+	// costs the same for any size; the directory slots and names are bounds checked as they're used.
+	const uint8_t *base = m_file.Base();
+	const FPHEADER *header = (const FPHEADER *) base;
+	uint64_t slots = (((uint64_t) 1 << std::min(header->directoryBits, MAX_DIRECTORY_BITS)) + 1);
+	bool valid = ((memcmp(header->magic, FINGERPRINT_MAGIC, sizeof(FINGERPRINT_MAGIC)) == 0) && (header->version == FINGERPRINT_VERSION) &&
+		(header->directoryBits >= 1) && (header->directoryBits <= MAX_DIRECTORY_BITS) && (header->entryCount <= UINT32_MAX) &&
+		m_file.InFile(header->directoryOffset, slots, sizeof(uint32_t)) &&
+		m_file.InFile(header->entriesOffset, header->entryCount, sizeof(FPENTRY)) &&
+		m_file.InFile(header->stringsOffset, header->stringsSize, 1) &&
+		((header->stringsSize == 0) || (base[header->stringsOffset + header->stringsSize - 1] == 0)));
+	if (!valid)
+	{
+		error = std::string("\"") + path + "\" is not a valid fingerprint file";
+		Close();
+		return false;
+	}
+	m_header = header;
+	m_directory = (const uint32_t *) (base + header->directoryOffset);
+	m_entries = (const FPENTRY *) (base + header->entriesOffset);
+	m_strings = (const char *) (base + header->stringsOffset);
+	m_shift = (64 - header->directoryBits);
+	return true;
+}
+
+const FPENTRY *FingerprintFile::Find(uint64_t fingerprint, uint32_t size) const
+{
+	if (!m_header)
+		return NULL;
+	size_t slot = (size_t) (fingerprint >> m_shift);
+	uint32_t end = (uint32_t) std::min((uint64_t) m_directory[slot + 1], m_header->entryCount);
+	for (uint32_t i = m_directory[slot]; i < end; i++)
+	{
+		const FPENTRY &entry = m_entries[i];
+		if (entry.fingerprint >= fingerprint)
+		{
+			if (entry.fingerprint > fingerprint)
+				break;
+			if (entry.size == size)
+				return &entry;
+		}
+	}
+	return NULL;
+}
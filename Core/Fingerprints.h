@@ -0,0 +1,89 @@
+// Function fingerprint file.
+// (fingerprint, name) pairs of small functions, carried from one database to the next, like the builds of a product.
+// A fingerprint is the HashFunctionBytes() of the function's bytes with their fixups zeroed ("FuncClusters.h").
+// The file is memory mapped and looked up in place: a directory indexed by the fingerprint's top bits points into the
+// sorted entries, so a lookup reads a directory slot and an entry or two, nothing is loaded up front.
+//
+// Layout, all offsets from the start of the file and 8 byte aligned:
+//   FPHEADER
+//   uint32_t directory[(1 << directoryBits) + 1], index of the first entry of each top bits value
+//   FPENTRY[entryCount], sorted by fingerprint then size
+//   Name strings, each zero terminated
+#pragma once
+#include "MappedFile.h"
+#include <vector>
+
+static const char FINGERPRINT_MAGIC[8] = { 'U', 'F', 'P', 'R', 'I', 'N', 'T', 0 };
+const uint32_t FINGERPRINT_VERSION = 2;
+
+// Entry flags
+const uint16_t FPF_SERIAL = 0x01;    // The name is a "prefix_" to add a serial number to
+const uint16_t FPF_RELOCATED = 0x02; // It had fixups masked, the copies can refer to different targets, so serial names only
+
+#pragma pack(push, 8)
+struct FPHEADER
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t directoryBits;
+	uint64_t directoryOffset;
+	uint64_t entryCount, entriesOffset;
+	uint64_t stringsSize, stringsOffset;
+};
+
+struct FPENTRY
+{
+	uint64_t fingerprint;
+	uint32_t stringOffset; // From 'stringsOffset'
+	uint16_t size;         // Function size
+	uint16_t flags;        // FPF_xx
+};
+#pragma pack(pop)
+
+// A fingerprint to write
+struct FINGERPRINT
+{
+	uint64_t fingerprint;
+	uint32_t size;
+	uint32_t flags;
+	std::string name;
+};
+
+// Read only, memory mapped, fingerprint file. Thread safe once opened.
+class FingerprintFile
+{
+public:
+	FingerprintFile();
+
+	bool Open(const char *path, std::string &error);
+	void Close();
+	bool IsOpen() const { return(m_header != NULL); }
+
+	size_t Count() const { return(m_header ? (size_t) m_header->entryCount : 0); }
+	const FPENTRY &Entry(size_t index) const { return m_entries[index]; }
+	// The entry's name, empty if it's bad
+	const char *Name(const FPENTRY &entry) const { return((entry.stringOffset < m_header->stringsSize) ? &m_strings[entry.stringOffset] : ""); }
+
+	// Return the entry of a function's fingerprint and size, or NULL if there's none
+	const FPENTRY *Find(uint64_t fingerprint, uint32_t size) const;
+
+private:
+	MappedFile m_file;
+	const FPHEADER *m_header;
+	const uint32_t *m_directory;
+	const FPENTRY *m_entries;
+	const char *m_strings;
+	uint32_t m_shift; // Fingerprint to directory index
+};
+
+// Turn a "prefix_N" name into a FPF_SERIAL "prefix_" one, so numbered names (clones and the like) carry over
+// without clashing. Other names are kept as is.
+void NormalizeFingerprintName(FINGERPRINT &print);
+
+// Add the file's entries for the fingerprints not already in 'prints'
+void MergeFingerprints(const FingerprintFile &file, std::vector<FINGERPRINT> &prints);
+
+// Write the fingerprints, sorted and deduplicated in place. A fingerprint with different names is ambiguous and dropped,
+// FPF_RELOCATED is kept if any of its copies had it.
+// Returns false with a reason on failure.
+bool WriteFingerprints(const char *path, std::vector<FINGERPRINT> &prints, uint32_t &written, uint32_t &ambiguous, std::string &error);
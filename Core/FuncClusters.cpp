@@ -0,0 +1,143 @@
+// Clustering of byte identical small functions
+#include "FuncClusters.h"
+#include <string.h>
+
+static inline uint64_t rotl64(uint64_t x, int bits) { return((x << bits) | (x >> (64 - bits))); }
+
+// Final avalanche, so the low bits used for the table index depend on every input bit
+static inline uint64_t mix64(uint64_t h)
+{
+	h ^= (h >> 33);
+	h *= 0xFF51AFD7ED558CCDull;
+	h ^= (h >> 33);
+	h *= 0xC4CEB9FE1A85EC53ull;
+	h ^= (h >> 33);
+	return h;
+}
+
+bool IsCloneCandidate(const DBFUNCTION &func)
+{
+	EA size = (func.endEa - func.startEa);
+	return(!(func.flags & DBFUNC_TAIL) && (size > 0) && (size <= MAX_CLUSTER_BYTES));
+}
+
+uint64_t HashFunctionBytes(const uint8_t *bytes, size_t size)
+{
+	const uint64_t PRIME1 = 0x9E3779B185EBCA87ull, PRIME2 = 0xC2B2AE3D27D4EB4Full;
+	uint64_t a = PRIME1, b = PRIME2;
+	size_t i = 0;
+	for (; (i + 16) <= size; i += 16)
+	{
+		uint64_t x, y;
+		memcpy(&x, &bytes[i], sizeof(x));
+		memcpy(&y, &bytes[i + 8], sizeof(y));
+		a = (rotl64((a ^ x) * PRIME1, 31) * PRIME2);
+		b = (rotl64((b ^ y) * PRIME2, 27) * PRIME1);
+	}
+
+	// The tail, zero padded; the size added at the end tells the padding from real zeros
+	if (i < size)
+	{
+		uint64_t tail[2] = {};
+		memcpy(tail, &bytes[i], (size - i));
+		a = (rotl64((a ^ tail[0]) * PRIME1, 31) * PRIME2);
+		b = (rotl64((b ^ tail[1]) * PRIME2, 27) * PRIME1);
+	}
+	return mix64(a + rotl64(b, 17) + ((uint64_t) size * 0x165667B19E3779F9ull));
+}
+
+// ======================================================================================
+
+uint8_t *CLONETABLE::Add(const uint8_t *source, size_t size)
+{
+	size_t offset = bytes.size();
+	bytes.insert(bytes.end(), source, (source + size));
+	offsets.push_back((uint32_t) bytes.size());
+	return &bytes[offset];
+}
+
+void CLONETABLE::Clear()
+{
+	bytes.clear();
+	offsets.assign(1, 0);
+	hashes.clear();
+}
+
+void CLONETABLE::Hash(size_t begin, size_t end)
+{
+	for (size_t n = begin; n < end; n++)
+		hashes[n] = HashFunctionBytes(Bytes(n), Size(n));
+}
+
+// ======================================================================================
+
+static const uint32_t NO_FUNC = 0xFFFFFFFF;
+
+void ClusterFunctions(const CLONETABLE &table, FUNCCLUSTERS &clusters)
+{
+	clusters.members.clear();
+	clusters.starts.clear();
+	clusters.collisions = 0;
+	uint32_t count = (uint32_t) table.Count();
+	if (count < 2)
+		return;
+
+	// Open addressing table of the group heads (first function of each distinct byte string), at most half full
+	size_t slotCount = 1024;
+	while (slotCount < ((size_t) count * 2))
+		slotCount <<= 1;
+	size_t slotMask = (slotCount - 1);
+	std::vector<uint32_t> slots(slotCount, NO_FUNC);
+
+	// Each group is a list through 'next', 'tail' and 'size' kept at its head
+	std::vector<uint32_t> next(count, NO_FUNC), tail(count), size(count, 0);
+	size_t memberCount = 0, clusterCount = 0;
+	for (uint32_t n = 0; n < count; n++)
+	{
+		uint64_t hash = table.hashes[n];
+		size_t slot = (size_t) (hash & slotMask);
+		for (;; slot = ((slot + 1) & slotMask))
+		{
+			uint32_t head = slots[slot];
+			if (head == NO_FUNC)
+			{
+				slots[slot] = n;
+				tail[n] = n;
+				size[n] = 1;
+				break;
+			}
+			if (table.hashes[head] == hash)
+			{
+				if ((table.Size(head) == table.Size(n)) && (memcmp(table.Bytes(head), table.Bytes(n), table.Size(n)) == 0))
+				{
+					next[tail[head]] = n;
+					tail[head] = n;
+					// A second member makes it a cluster
+					if (++size[head] == 2)
+					{
+						memberCount += 2;
+						clusterCount++;
+					}
+					else
+						memberCount++;
+					break;
+				}
+				clusters.collisions++;
+			}
+		}
+	}
+
+	// Walk the groups in head order, the heads being in function order
+	clusters.members.reserve(memberCount);
+	clusters.starts.reserve(clusterCount + 1);
+	for (uint32_t n = 0; n < count; n++)
+	{
+		if (size[n] >= 2)
+		{
+			clusters.starts.push_back((uint32_t) clusters.members.size());
+			for (uint32_t m = n; m != NO_FUNC; m = next[m])
+				clusters.members.push_back(m);
+		}
+	}
+	clusters.starts.push_back((uint32_t) clusters.members.size());
+}
@@ -0,0 +1,53 @@
+// Clustering of byte identical small functions (inlined accessors, compiler generated thunks and the like).
+// The functions are hashed in parallel from a table of their bytes, with the relocated bytes zeroed so copies
+// at different addresses hash the same, then grouped in one linear pass with an open addressing table.
+#pragma once
+#include "Database.h"
+#include <vector>
+
+// Largest function size clustered
+const size_t MAX_CLUSTER_BYTES = 128;
+
+// Return true if the function can be clustered: not a tail chunk, and 1 to MAX_CLUSTER_BYTES in size
+bool IsCloneCandidate(const DBFUNCTION &func);
+
+// Hash a function's bytes, 64 bits at the time in two independent lanes so it pipelines (and vectorizes)
+uint64_t HashFunctionBytes(const uint8_t *bytes, size_t size);
+
+// The function bytes, structure of arrays. Function n's bytes are [offsets[n], offsets[n + 1]).
+struct CLONETABLE
+{
+	std::vector<uint8_t> bytes;
+	std::vector<uint32_t> offsets;
+	std::vector<uint64_t> hashes; // HashFunctionBytes() of each
+
+	CLONETABLE() : offsets(1, 0) {}
+
+	size_t Count() const { return(offsets.size() - 1); }
+	const uint8_t *Bytes(size_t n) const { return &bytes[offsets[n]]; }
+	size_t Size(size_t n) const { return(offsets[n + 1] - offsets[n]); }
+
+	// Add a function's bytes, returns the copy to zero its relocated bytes in
+	uint8_t *Add(const uint8_t *source, size_t size);
+	void Clear();
+
+	// Hash the functions [begin, end), thread safe for disjoint ranges once all are added
+	void Hash(size_t begin, size_t end);
+};
+
+// Clusters of two or more identical functions, in the order of their first member.
+// Cluster n's function indexes are members[starts[n]] to members[starts[n + 1] - 1], in function order.
+struct FUNCCLUSTERS
+{
+	std::vector<uint32_t> members;
+	std::vector<uint32_t> starts;
+	uint32_t collisions; // Equal hashes with different bytes, told apart by the byte compare
+
+	FUNCCLUSTERS() : collisions(0) {}
+
+	size_t Count() const { return(starts.empty() ? 0 : (starts.size() - 1)); }
+	size_t MemberCount(size_t n) const { return(starts[n + 1] - starts[n]); }
+};
+
+// Group the hashed functions of the table into clusters
+void ClusterFunctions(const CLONETABLE &table, FUNCCLUSTERS &clusters);
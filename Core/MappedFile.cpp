@@ -0,0 +1,94 @@
+// Read only memory mapped file
+#include "MappedFile.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : m_base(NULL), m_size(0)
+{
+#ifdef _WIN32
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	m_file = -1;
+#endif
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_base)
+		UnmapViewOfFile(m_base);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	if (m_base)
+		munmap((void *) m_base, (size_t) m_size);
+	if (m_file != -1)
+		close(m_file);
+	m_file = -1;
+#endif
+	m_base = NULL;
+	m_size = 0;
+}
+
+bool MappedFile::Open(const char *path, uint64_t minSize, std::string &error)
+{
+	Close();
+
+#ifdef _WIN32
+	m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER size;
+	if ((m_file == INVALID_HANDLE_VALUE) || !GetFileSizeEx(m_file, &size))
+	{
+		error = std::string("Failed to open \"") + path + "\"";
+		Close();
+		return false;
+	}
+	m_size = (uint64_t) size.QuadPart;
+	if (m_size >= minSize)
+	{
+		m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_mapping)
+			m_base = (const uint8_t *) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	}
+#else
+	m_file = open(path, O_RDONLY);
+	struct stat st;
+	if ((m_file == -1) || (fstat(m_file, &st) != 0))
+	{
+		error = std::string("Failed to open \"") + path + "\"";
+		Close();
+		return false;
+	}
+	m_size = (uint64_t) st.st_size;
+	if ((m_size >= minSize) && (m_size > 0))
+	{
+		void *base = mmap(NULL, (size_t) m_size, PROT_READ, MAP_SHARED, m_file, 0);
+		if (base != MAP_FAILED)
+			m_base = (const uint8_t *) base;
+	}
+#endif
+	if (!m_base)
+	{
+		error = std::string("Failed to map \"") + path + "\"";
+		Close();
+		return false;
+	}
+	return true;
+}
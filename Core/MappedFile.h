@@ -0,0 +1,36 @@
+// Read only memory mapped file, for the core file formats that are read in place
+#pragma once
+#include <stdint.h>
+#include <string>
+
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile() { Close(); }
+
+	// Map the whole file, at least 'minSize' bytes of it. Returns false with a reason on failure.
+	bool Open(const char *path, uint64_t minSize, std::string &error);
+	void Close();
+
+	const uint8_t *Base() const { return m_base; }
+	uint64_t Size() const { return m_size; }
+
+	// True if 'count' items of 'size' bytes at 'offset' are inside the file
+	bool InFile(uint64_t offset, uint64_t count, uint64_t size) const
+	{
+		return((offset <= m_size) && ((count == 0) || ((m_size - offset) / count) >= size));
+	}
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+	const uint8_t *m_base;
+	uint64_t m_size;
+#ifdef _WIN32
+	void *m_file, *m_mapping;
+#else
+	int m_file;
+#endif
+};
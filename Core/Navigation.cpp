@@ -0,0 +1,161 @@
+// Navigation and fill run searches over an IDatabase
+#include "Navigation.h"
+#include "ZeroScan.h"
+#include "StructStride.h"
+#include <algorithm>
+#include <vector>
+
+static bool isInitedFlags(uint32_t flags) { return((flags & DBF_IVL) != 0); }
+
+EA ScanNextNotZero(const IDatabase &db, EA startEa, EA endEa)
+{
+	for (EA ea = startEa; ea < endEa;)
+	{
+		// Uninitialized bytes can't be "not zero", the original per-item loop didn't count them either
+		if (!isInitedFlags(db.Flags(ea)))
+		{
+			ea = db.NextInited(ea, endEa);
+			if (ea == BAD_EA)
+				break;
+		}
+
+		size_t size = (size_t) std::min((EA) SCAN_CHUNK_SIZE, (endEa - ea));
+		size_t inited;
+		const uint8_t *bytes = db.ReadBytes(ea, size, true, inited);
+		if (inited == 0)
+		{
+			ea = db.NextInited(ea, endEa);
+			if (ea == BAD_EA)
+				break;
+			continue;
+		}
+
+		size_t offset = FindFirstNonZero(bytes, inited);
+		if (offset < inited)
+			return(ea + offset);
+		ea += inited;
+	}
+	return BAD_EA;
+}
+
+EA ScanPrevNotZero(const IDatabase &db, EA startEa, EA endEa)
+{
+	for (EA ea = endEa; ea > startEa;)
+	{
+		if (!isInitedFlags(db.Flags(ea - 1)))
+		{
+			EA prev = db.PrevInited((ea - 1), startEa);
+			if (prev == BAD_EA)
+				break;
+			ea = (prev + 1);
+		}
+
+		size_t size = (size_t) std::min((EA) SCAN_CHUNK_SIZE, (ea - startEa));
+		EA chunkEa = (ea - size);
+		size_t inited;
+		const uint8_t *bytes = db.ReadBytes(chunkEa, size, false, inited);
+		if (inited == 0)
+		{
+			ea--;
+			continue;
+		}
+
+		size_t skip = (size - inited);
+		size_t offset = FindLastNonZero(bytes + skip, inited);
+		if (offset < inited)
+			return(chunkEa + skip + offset);
+		ea -= inited;
+	}
+	return BAD_EA;
+}
+
+// ======================================================================================
+
+bool IsFillBoundFlags(uint32_t flags)
+{
+	return(((flags & (DBF_REF | DBF_NAME | DBF_LABL)) != 0) || IsCodeFlags(flags));
+}
+
+FILLSTATUS FindFillBounds(const IDatabase &db, EA ea, uint32_t align, EA &startEa, EA &endEa)
+{
+	startEa = endEa = BAD_EA;
+
+	// Don't allow fill operation over code
+	if (IsCodeFlags(db.Flags(ea)))
+		return FILL_CODE;
+
+	// Nearest bound at or before, else the bottom of the database
+	startEa = (IsFillBoundFlags(db.Flags(ea)) ? ea : db.PrevThat(ea, db.MinEa(), IsFillBoundFlags));
+	if (startEa == BAD_EA)
+		startEa = db.MinEa();
+
+	// Should be at alignment
+	if ((startEa & (align - 1)) != 0)
+		return FILL_UNALIGNED;
+
+	// Next bound after
+	endEa = db.NextThat(ea, db.MaxEa(), IsFillBoundFlags);
+	if ((endEa == BAD_EA) || ((endEa - ea) < sizeof(uint32_t)))
+		return FILL_NO_RUN;
+	return FILL_OK;
+}
+
+static bool isFormattedFlags(uint32_t flags) { return !IsUnknownFlags(flags); }
+
+void CollectFillRuns(const IDatabase &db, size_t segIndex, uint32_t align, uint64_t minSize, std::vector<FILLRUN> &runs)
+{
+	runs.clear();
+	size_t n = ((segIndex == ALL_SEGMENTS) ? 0 : segIndex);
+	size_t endIndex = ((segIndex == ALL_SEGMENTS) ? db.SegmentCount() : std::min((segIndex + 1), db.SegmentCount()));
+	for (; n < endIndex; n++)
+	{
+		DBSEGMENT seg = db.Segment(n);
+		if ((seg.type == DBSEG_CODE) || (seg.type == DBSEG_XTRN))
+			continue;
+
+		for (EA startEa = seg.startEa; startEa < seg.endEa;)
+		{
+			EA endEa = db.NextThat(startEa, seg.endEa, IsFillBoundFlags);
+			if (endEa == BAD_EA)
+				endEa = seg.endEa;
+
+			// Aligned, long enough, initialized, and nothing formatted in it yet
+			uint32_t flags = db.Flags(startEa);
+			if (((startEa & (align - 1)) == 0) && ((endEa - startEa) >= minSize) && (flags & DBF_IVL) &&
+				IsUnknownFlags(flags) && (db.NextThat(startEa, endEa, isFormattedFlags) == BAD_EA))
+			{
+				FILLRUN run = { startEa, endEa };
+				runs.push_back(run);
+			}
+			startEa = endEa;
+		}
+	}
+}
+
+void CountFillRuns(const IDatabase &db, size_t sampleSlots, FILLRUNCOUNTS &counts)
+{
+	counts = FILLRUNCOUNTS();
+	uint32_t ptrSize = (db.Is64() ? sizeof(uint64_t) : sizeof(uint32_t));
+	sampleSlots = std::min(sampleSlots, (SCAN_CHUNK_SIZE / sizeof(uint32_t)));
+	std::vector<FILLRUN> runs;
+	CollectFillRuns(db, ALL_SEGMENTS, ptrSize, (ptrSize * 2), runs);
+	std::vector<uint8_t> classes;
+
+	for (const FILLRUN &run : runs)
+	{
+		counts.runs++;
+		counts.bytes += (run.endEa - run.startEa);
+
+		size_t slotCount = std::min((size_t) ((run.endEa - run.startEa) / sizeof(uint32_t)), sampleSlots);
+		size_t size = (slotCount * sizeof(uint32_t)), inited;
+		const uint8_t *bytes = db.ReadBytes(run.startEa, size, true, inited);
+		if (inited == size)
+		{
+			ClassifySlots(bytes, slotCount, db.MinEa(), db.MaxEa(), db.Is64(), classes);
+			double score = 0.0;
+			uint32_t stride = DetectStride(classes, db.Is64(), score);
+			if (((stride * sizeof(uint32_t)) > ptrSize) && ((run.endEa - run.startEa) >= (stride * sizeof(uint32_t) * 2)))
+				counts.structRuns++;
+		}
+	}
+}
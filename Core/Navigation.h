@@ -0,0 +1,45 @@
+// Navigation and fill run searches over an IDatabase
+#pragma once
+#include "Database.h"
+#include <vector>
+
+// Return the address of the first/last non-zero initialized byte in [startEa, endEa), or BAD_EA if none.
+// The range has to be inside a segment. Uninitialized spans are skipped whole.
+EA ScanNextNotZero(const IDatabase &db, EA startEa, EA endEa);
+EA ScanPrevNotZero(const IDatabase &db, EA startEa, EA endEa);
+
+// The flags the DWORD/QWORD/struct fill runs stop at: a reference, a name, a label or code
+bool IsFillBoundFlags(uint32_t flags);
+
+enum FILLSTATUS
+{
+	FILL_OK,
+	FILL_CODE,      // The address is code
+	FILL_UNALIGNED, // The run start isn't aligned
+	FILL_NO_RUN,    // No end found, or it's too short
+};
+
+// Find the unformatted run around 'ea', from the nearest fill bound at or before it up to the next one after it.
+// 'startEa' is still set on FILL_UNALIGNED for the error message.
+FILLSTATUS FindFillBounds(const IDatabase &db, EA ea, uint32_t align, EA &startEa, EA &endEa);
+
+struct FILLRUN
+{
+	EA startEa, endEa;
+};
+
+const size_t ALL_SEGMENTS = SIZE_MAX;
+
+// Collect the 'align' aligned, unformatted and initialized runs between fill bounds of at least 'minSize' bytes,
+// in the non-code segments or just in segment 'segIndex'
+void CollectFillRuns(const IDatabase &db, size_t segIndex, uint32_t align, uint64_t minSize, std::vector<FILLRUN> &runs);
+
+struct FILLRUNCOUNTS
+{
+	uint64_t runs;       // Aligned, unformatted and initialized runs between fill bounds
+	uint64_t bytes;
+	uint64_t structRuns; // Of those, the ones with a struct record stride
+};
+
+// Count the struct/data fill candidate runs in the non-code segments, sampling 'sampleSlots' DWORDs per run for the stride
+void CountFillRuns(const IDatabase &db, size_t sampleSlots, FILLRUNCOUNTS &counts);
@@ -0,0 +1,224 @@
+// Pointer table detection
+#include "PointerTables.h"
+#include <algorithm>
+#include <string.h>
+#ifdef CORE_X86
+#include <emmintrin.h>
+#endif
+
+void CodeTargets::Build(const IDatabase &db)
+{
+	m_code.clear();
+	m_functions.clear();
+	m_minEa = BAD_EA;
+	m_maxEa = 0;
+	for (size_t i = 0; i < db.SegmentCount(); i++)
+	{
+		DBSEGMENT seg = db.Segment(i);
+		if (seg.type == DBSEG_CODE)
+		{
+			m_code.push_back(seg);
+			m_minEa = std::min(m_minEa, seg.startEa);
+			m_maxEa = std::max(m_maxEa, seg.endEa);
+		}
+	}
+
+	m_functions.reserve(db.FunctionCount());
+	for (size_t i = 0; i < db.FunctionCount(); i++)
+	{
+		DBFUNCTION f = db.Function(i);
+		if (!(f.flags & DBFUNC_TAIL))
+			m_functions.push_back(f.startEa);
+	}
+	std::sort(m_functions.begin(), m_functions.end());
+}
+
+bool CodeTargets::IsTarget(EA ea, bool &isFunction) const
+{
+	isFunction = false;
+	if ((ea < m_minEa) || (ea >= m_maxEa))
+		return false;
+
+	// Last code segment starting at or before
+	auto seg = std::upper_bound(m_code.begin(), m_code.end(), ea, [](EA a, const DBSEGMENT &s) { return(a < s.startEa); });
+	if ((seg == m_code.begin()) || (ea >= (seg - 1)->endEa))
+		return false;
+	isFunction = std::binary_search(m_functions.begin(), m_functions.end(), ea);
+	return true;
+}
+
+// ======================================================================================
+
+// Run being built by the scan
+struct RUNSTATE
+{
+	PTRTABLE run;
+	bool open;
+};
+
+static inline void endRun(RUNSTATE &state, EA pieceEa, std::vector<PTRTABLE> &runs)
+{
+	if (state.open && ((state.run.count >= MIN_TABLE_ENTRIES) || (state.run.startEa == pieceEa)))
+		runs.push_back(state.run);
+	state.open = false;
+}
+
+static inline void addSlot(RUNSTATE &state, EA slotEa, uint64_t value, const CodeTargets &targets, EA pieceEa, std::vector<PTRTABLE> &runs)
+{
+	bool isFunction;
+	if (!targets.IsTarget(value, isFunction))
+	{
+		endRun(state, pieceEa, runs);
+		return;
+	}
+	if (!state.open)
+	{
+		state.run.startEa = slotEa;
+		state.run.count = state.run.functions = 0;
+		state.open = true;
+	}
+	state.run.count++;
+	state.run.functions += isFunction;
+}
+
+#ifdef CORE_X86
+// Mask of the DWORD lanes of 'v' in [lo, hi], both with the sign bias applied since the SSE2 compares are signed
+static inline int rangeMask32(__m128i v, __m128i lo, __m128i hi)
+{
+	v = _mm_xor_si128(v, _mm_set1_epi32((int) 0x80000000));
+	__m128i outside = _mm_or_si128(_mm_cmplt_epi32(v, lo), _mm_cmpgt_epi32(v, hi));
+	return(~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF);
+}
+#endif
+
+void FindPointerRuns(const uint8_t *bytes, size_t size, EA ea, bool is64, const CodeTargets &targets, std::vector<PTRTABLE> &runs)
+{
+	size_t ptrSize = (is64 ? sizeof(uint64_t) : sizeof(uint32_t));
+	RUNSTATE state = {};
+	if (targets.MinEa() >= targets.MaxEa())
+		return;
+	size_t i = 0;
+
+#ifdef CORE_X86
+	// Pre-filter 16 bytes at the time on the code bounds, only the slots in range get the exact test.
+	// For 64bit the bounds have to share their upper half, the high DWORD then just has to match.
+	EA lastEa = (targets.MaxEa() - 1);
+	if (!is64 || ((targets.MinEa() >> 32) == (lastEa >> 32)))
+	{
+		__m128i lo = _mm_set1_epi32((int) ((uint32_t) targets.MinEa() ^ 0x80000000));
+		__m128i hi = _mm_set1_epi32((int) ((uint32_t) lastEa ^ 0x80000000));
+		__m128i high = _mm_set1_epi32((int) (uint32_t) (lastEa >> 32));
+		for (; (i + 16) <= size; i += 16)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*) (bytes + i));
+			int mask = rangeMask32(v, lo, hi);
+			if (is64)
+			{
+				// Low DWORD in range and high DWORD matching, per QWORD lane
+				int highMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, high)));
+				mask = ((mask & (highMask >> 1)) & 5);
+			}
+			if (mask == 0)
+			{
+				endRun(state, ea, runs);
+				continue;
+			}
+
+			for (size_t j = 0; j < 16; j += ptrSize)
+			{
+				if (mask & (1 << (j / sizeof(uint32_t))))
+				{
+					uint64_t value = 0;
+					memcpy(&value, (bytes + i + j), ptrSize);
+					addSlot(state, (ea + i + j), value, targets, ea, runs);
+				}
+				else
+					endRun(state, ea, runs);
+			}
+		}
+	}
+#endif
+
+	for (; (i + ptrSize) <= size; i += ptrSize)
+	{
+		uint64_t value = 0;
+		memcpy(&value, (bytes + i), ptrSize);
+		addSlot(state, (ea + i), value, targets, ea, runs);
+	}
+
+	// Runs to the end of the piece are kept for joining
+	if (state.open)
+		runs.push_back(state.run);
+}
+
+void JoinPointerRuns(std::vector<PTRTABLE> &runs, bool is64)
+{
+	EA ptrSize = (is64 ? sizeof(uint64_t) : sizeof(uint32_t));
+	size_t out = 0;
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		if (out && ((runs[out - 1].startEa + (runs[out - 1].count * ptrSize)) == runs[i].startEa))
+		{
+			runs[out - 1].count += runs[i].count;
+			runs[out - 1].functions += runs[i].functions;
+		}
+		else
+			runs[out++] = runs[i];
+	}
+	runs.resize(out);
+	runs.erase(std::remove_if(runs.begin(), runs.end(), [](const PTRTABLE &t) { return(t.count < MIN_TABLE_ENTRIES); }), runs.end());
+}
+
+// ======================================================================================
+
+// Count the entries pointing to a function start
+static uint32_t countFunctions(const IDatabase &db, EA startEa, uint32_t count, const CodeTargets &targets)
+{
+	size_t ptrSize = (db.Is64() ? sizeof(uint64_t) : sizeof(uint32_t));
+	size_t chunkEntries = (SCAN_CHUNK_SIZE / ptrSize);
+	uint32_t functions = 0;
+	for (uint32_t i = 0; i < count;)
+	{
+		size_t entries = std::min((size_t) (count - i), chunkEntries), inited;
+		const uint8_t *bytes = db.ReadBytes((startEa + (i * ptrSize)), (entries * ptrSize), true, inited);
+		for (size_t j = 0; j < (inited / ptrSize); j++)
+		{
+			uint64_t value = 0;
+			memcpy(&value, (bytes + (j * ptrSize)), ptrSize);
+			bool isFunction;
+			functions += (targets.IsTarget(value, isFunction) && isFunction);
+		}
+		i += (uint32_t) entries;
+	}
+	return functions;
+}
+
+static bool isTableBoundFlags(uint32_t flags) { return(((flags & (DBF_REF | DBF_NAME | DBF_LABL)) != 0) || IsCodeFlags(flags)); }
+
+void SplitPointerTable(const IDatabase &db, const PTRTABLE &table, const CodeTargets &targets, std::vector<PTRTABLE> &tables)
+{
+	EA ptrSize = (db.Is64() ? sizeof(uint64_t) : sizeof(uint32_t));
+	EA endEa = (table.startEa + (table.count * ptrSize));
+	if (IsCodeFlags(db.Flags(table.startEa)))
+		return;
+
+	for (EA startEa = table.startEa; startEa < endEa;)
+	{
+		EA boundEa = db.NextThat(startEa, endEa, isTableBoundFlags);
+		if (boundEa == BAD_EA)
+			boundEa = endEa;
+		else
+		if (IsCodeFlags(db.Flags(boundEa)))
+			return;
+
+		// A bound inside an entry ends the table at that entry, the next one starts after it
+		EA partEnd = (startEa + (((boundEa - startEa) / ptrSize) * ptrSize));
+		PTRTABLE part = { startEa, (uint32_t) ((partEnd - startEa) / ptrSize), 0 };
+		if (part.count >= MIN_TABLE_ENTRIES)
+		{
+			part.functions = ((part.count == table.count) ? table.functions : countFunctions(db, startEa, part.count, targets));
+			tables.push_back(part);
+		}
+		startEa = ((boundEa == partEnd) ? boundEa : (partEnd + ptrSize));
+	}
+}
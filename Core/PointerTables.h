@@ -0,0 +1,45 @@
+// Pointer table detection, runs of pointer sized values pointing into code (vtables and other function tables).
+// The scan over a buffer is pure, so the pieces of a segment snapshot can be scanned in parallel, then the runs
+// cut at a piece edge joined back up in order.
+#pragma once
+#include "Database.h"
+#include <vector>
+
+const uint32_t MIN_TABLE_ENTRIES = 3;
+
+// The code a table entry can point to: anywhere in a code segment, and the function starts
+class CodeTargets
+{
+public:
+	void Build(const IDatabase &db);
+
+	// True if 'ea' is in a code segment, 'isFunction' set if it's a function start
+	bool IsTarget(EA ea, bool &isFunction) const;
+
+	// Bounds of all the code segments, for the SIMD pre-filter
+	EA MinEa() const { return m_minEa; }
+	EA MaxEa() const { return m_maxEa; }
+
+private:
+	std::vector<DBSEGMENT> m_code;
+	std::vector<EA> m_functions; // Sorted
+	EA m_minEa, m_maxEa;
+};
+
+struct PTRTABLE
+{
+	EA startEa;
+	uint32_t count;     // Entries
+	uint32_t functions; // Of those, the ones pointing to a function start
+};
+
+// Find the runs of pointers to code in the pointer aligned piece of 'size' bytes at 'ea'.
+// Keeps the runs of at least MIN_TABLE_ENTRIES, and any run touching either end of the piece for JoinPointerRuns().
+void FindPointerRuns(const uint8_t *bytes, size_t size, EA ea, bool is64, const CodeTargets &targets, std::vector<PTRTABLE> &runs);
+
+// Join the runs of consecutive pieces (in address order) that meet at a piece edge, then drop those shorter than MIN_TABLE_ENTRIES
+void JoinPointerRuns(std::vector<PTRTABLE> &runs, bool is64);
+
+// Split a table at the references and names inside it (each of those starts a new table), and drop it at code.
+// The parts of at least MIN_TABLE_ENTRIES are added to 'tables'. Main thread, it reads the database flags.
+void SplitPointerTable(const IDatabase &db, const PTRTABLE &table, const CodeTargets &targets, std::vector<PTRTABLE> &tables);
@@ -0,0 +1,99 @@
+// Database snapshot file.
+// A flat dump of the segments' item flags and bytes, the functions and the names, laid out so it can be
+// memory mapped and read in place. Lets the core algorithms run, and be profiled, outside of IDA.
+//
+// Layout, all offsets from the start of the file and 8 byte aligned:
+//   SNAPSHOTHEADER
+//   SNAPSHOTSEGMENT[segmentCount]
+//   Per segment: uint32_t flags[size], uint8_t bytes[size], uint64_t initedBitmap[(size + 63) / 64]
+//   SNAPSHOTFUNCTION[functionCount]
+//   SNAPSHOTNAME[nameCount], sorted by address
+//   Name strings, each zero terminated
+#pragma once
+#include "Database.h"
+#include "MappedFile.h"
+#include <vector>
+
+static const char SNAPSHOT_MAGIC[8] = { 'U', 'F', 'S', 'N', 'A', 'P', '1', 0 };
+const uint32_t SNAPSHOT_VERSION = 1;
+
+#pragma pack(push, 8)
+struct SNAPSHOTHEADER
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t is64;
+	EA minEa, maxEa;
+	uint64_t segmentCount, segmentsOffset;
+	uint64_t functionCount, functionsOffset;
+	uint64_t nameCount, namesOffset;
+	uint64_t stringsSize, stringsOffset;
+};
+
+struct SNAPSHOTSEGMENT
+{
+	EA startEa, endEa;
+	uint32_t type; // DBSEGTYPE
+	char name[32];
+	uint32_t pad;
+	uint64_t flagsOffset, bytesOffset, initedOffset;
+};
+
+struct SNAPSHOTFUNCTION
+{
+	EA startEa, endEa;
+	uint32_t flags; // DBFUNC_xx
+	uint32_t pad;
+};
+
+struct SNAPSHOTNAME
+{
+	EA ea;
+	uint32_t stringOffset; // From 'stringsOffset'
+	uint32_t length;
+};
+#pragma pack(pop)
+
+// Write a snapshot of a database, returns false with a reason on failure
+bool WriteSnapshot(const IDatabase &db, const char *path, std::string &error);
+
+// Read only, memory mapped, snapshot database.
+// Flags(), NextThat() and ReadBytes() are served in place from the mapping. Not thread safe, it caches the last segment.
+class SnapshotDatabase : public IDatabase
+{
+public:
+	SnapshotDatabase();
+	virtual ~SnapshotDatabase();
+
+	bool Open(const char *path, std::string &error);
+	void Close();
+	uint64_t FileSize() const { return m_file.Size(); }
+
+	virtual bool Is64() const;
+	virtual EA MinEa() const;
+	virtual EA MaxEa() const;
+	virtual size_t SegmentCount() const;
+	virtual DBSEGMENT Segment(size_t index) const;
+	virtual uint32_t Flags(EA ea) const;
+	virtual EA NextThat(EA ea, EA endEa, FLAGTEST test) const;
+	virtual EA PrevThat(EA ea, EA startEa, FLAGTEST test) const;
+	virtual EA NextInited(EA ea, EA endEa) const;
+	virtual EA PrevInited(EA ea, EA startEa) const;
+	virtual const uint8_t *ReadBytes(EA ea, size_t size, bool forward, size_t &inited) const;
+	virtual size_t FunctionCount() const;
+	virtual DBFUNCTION Function(size_t index) const;
+	virtual bool GetName(EA ea, std::string &name) const;
+
+private:
+	// Return the index of the segment holding the address, or -1
+	ptrdiff_t findSegment(EA ea) const;
+
+	MappedFile m_file;
+	const uint8_t *m_base;
+	const SNAPSHOTHEADER *m_header;
+	const SNAPSHOTSEGMENT *m_segments;
+	const SNAPSHOTFUNCTION *m_functions;
+	const SNAPSHOTNAME *m_names;
+	const char *m_strings;
+	mutable size_t m_lastSegment;
+};
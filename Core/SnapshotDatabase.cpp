@@ -0,0 +1,277 @@
+// Memory mapped snapshot database
+#include "Snapshot.h"
+#include <string.h>
+#include <algorithm>
+
+// Index of the first bit equal to 'set' in [begin, end) of the bitmap, or 'end' if none
+static uint64_t findBit(const uint64_t *bitmap, uint64_t begin, uint64_t end, bool set)
+{
+	uint64_t i = begin;
+	while (i < end)
+	{
+		uint64_t w = (set ? bitmap[i / 64] : ~bitmap[i / 64]);
+		w &= (~0ull << (i & 63));
+		if (w)
+			return std::min((((i / 64) * 64) + LowestBit64(w)), end);
+		i = (((i / 64) + 1) * 64);
+	}
+	return end;
+}
+
+// Index of the last bit equal to 'set' in [begin, end) of the bitmap, or BAD_EA if none
+static uint64_t findBitBack(const uint64_t *bitmap, uint64_t begin, uint64_t end, bool set)
+{
+	uint64_t i = end;
+	while (i > begin)
+	{
+		uint64_t last = (i - 1);
+		uint64_t w = (set ? bitmap[last / 64] : ~bitmap[last / 64]);
+		uint32_t topBit = (uint32_t) (last & 63);
+		if (topBit != 63)
+			w &= ((1ull << (topBit + 1)) - 1);
+		if (w)
+		{
+			uint64_t hit = (((last / 64) * 64) + HighestBit64(w));
+			return((hit >= begin) ? hit : BAD_EA);
+		}
+		i = ((last / 64) * 64);
+	}
+	return BAD_EA;
+}
+
+// ======================================================================================
+
+SnapshotDatabase::SnapshotDatabase() : m_base(NULL), m_header(NULL), m_segments(NULL), m_functions(NULL), m_names(NULL), m_strings(NULL), m_lastSegment(0)
+{
+}
+
+SnapshotDatabase::~SnapshotDatabase()
+{
+	Close();
+}
+
+void SnapshotDatabase::Close()
+{
+	m_file.Close();
+	m_base = NULL;
+	m_header = NULL;
+	m_segments = NULL;
+	m_functions = NULL;
+	m_names = NULL;
+	m_strings = NULL;
+	m_lastSegment = 0;
+}
+
+bool SnapshotDatabase::Open(const char *path, std::string &error)
+{
+	Close();
+	if (!m_file.Open(path, sizeof(SNAPSHOTHEADER), error))
+		return false;
+	m_base = m_file.Base();
+
+	// Validate the header and that every table is inside the file
+	m_header = (const SNAPSHOTHEADER *) m_base;
+	auto inFile = [this](uint64_t offset, uint64_t count, uint64_t size) { return m_file.InFile(offset, count, size); };
+	bool valid = ((memcmp(m_header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0) && (m_header->version == SNAPSHOT_VERSION) &&
+		inFile(m_header->segmentsOffset, m_header->segmentCount, sizeof(SNAPSHOTSEGMENT)) &&
+		inFile(m_header->functionsOffset, m_header->functionCount, sizeof(SNAPSHOTFUNCTION)) &&
+		inFile(m_header->namesOffset, m_header->nameCount, sizeof(SNAPSHOTNAME)) &&
+		inFile(m_header->stringsOffset, m_header->stringsSize, 1));
+	if (valid)
+	{
+		m_segments = (const SNAPSHOTSEGMENT *) (m_base + m_header->segmentsOffset);
+		m_functions = (const SNAPSHOTFUNCTION *) (m_base + m_header->functionsOffset);
+		m_names = (const SNAPSHOTNAME *) (m_base + m_header->namesOffset);
+		m_strings = (const char *) (m_base + m_header->stringsOffset);
+
+		for (uint64_t i = 0; valid && (i < m_header->segmentCount); i++)
+		{
+			const SNAPSHOTSEGMENT &seg = m_segments[i];
+			uint64_t size = (seg.endEa - seg.startEa);
+			valid = ((seg.endEa >= seg.startEa) && ((i == 0) || (seg.startEa >= m_segments[i - 1].endEa)) &&
+				inFile(seg.flagsOffset, size, sizeof(uint32_t)) && inFile(seg.bytesOffset, size, 1) &&
+				inFile(seg.initedOffset, ((size + 63) / 64), sizeof(uint64_t)));
+		}
+		for (uint64_t i = 0; valid && (i < m_header->nameCount); i++)
+			valid = ((m_names[i].stringOffset + (uint64_t) m_names[i].length) < m_header->stringsSize);
+	}
+	if (!valid)
+	{
+		error = std::string("\"") + path + "\" is not a valid snapshot file";
+		Close();
+		return false;
+	}
+	return true;
+}
+
+// ======================================================================================
+
+bool SnapshotDatabase::Is64() const { return(m_header->is64 != 0); }
+EA SnapshotDatabase::MinEa() const { return m_header->minEa; }
+EA SnapshotDatabase::MaxEa() const { return m_header->maxEa; }
+size_t SnapshotDatabase::SegmentCount() const { return (size_t) m_header->segmentCount; }
+size_t SnapshotDatabase::FunctionCount() const { return (size_t) m_header->functionCount; }
+
+DBSEGMENT SnapshotDatabase::Segment(size_t index) const
+{
+	const SNAPSHOTSEGMENT &ss = m_segments[index];
+	DBSEGMENT seg;
+	seg.startEa = ss.startEa;
+	seg.endEa = ss.endEa;
+	seg.type = ss.type;
+	memcpy(seg.name, ss.name, sizeof(seg.name));
+	return seg;
+}
+
+DBFUNCTION SnapshotDatabase::Function(size_t index) const
+{
+	const SNAPSHOTFUNCTION &sf = m_functions[index];
+	DBFUNCTION f = { sf.startEa, sf.endEa, sf.flags };
+	return f;
+}
+
+ptrdiff_t SnapshotDatabase::findSegment(EA ea) const
+{
+	// Most lookups are in the same segment as the last one
+	if (m_lastSegment < m_header->segmentCount)
+	{
+		const SNAPSHOTSEGMENT &seg = m_segments[m_lastSegment];
+		if ((ea >= seg.startEa) && (ea < seg.endEa))
+			return (ptrdiff_t) m_lastSegment;
+	}
+
+	const SNAPSHOTSEGMENT *end = (m_segments + m_header->segmentCount);
+	const SNAPSHOTSEGMENT *seg = std::upper_bound(m_segments, end, ea, [](EA v, const SNAPSHOTSEGMENT &s) { return(v < s.endEa); });
+	if ((seg == end) || (ea < seg->startEa))
+		return -1;
+	m_lastSegment = (size_t) (seg - m_segments);
+	return (ptrdiff_t) m_lastSegment;
+}
+
+uint32_t SnapshotDatabase::Flags(EA ea) const
+{
+	ptrdiff_t index = findSegment(ea);
+	if (index < 0)
+		return 0;
+	const SNAPSHOTSEGMENT &seg = m_segments[index];
+	return ((const uint32_t *) (m_base + seg.flagsOffset))[ea - seg.startEa];
+}
+
+EA SnapshotDatabase::NextThat(EA ea, EA endEa, FLAGTEST test) const
+{
+	const SNAPSHOTSEGMENT *end = (m_segments + m_header->segmentCount);
+	for (EA next = (ea + 1); (next < endEa) && (ea != BAD_EA);)
+	{
+		// First segment ending after the address
+		const SNAPSHOTSEGMENT *seg = std::upper_bound(m_segments, end, next, [](EA v, const SNAPSHOTSEGMENT &s) { return(v < s.endEa); });
+		if ((seg == end) || (seg->startEa >= endEa))
+			break;
+		next = std::max(next, seg->startEa);
+
+		const uint32_t *flags = (const uint32_t *) (m_base + seg->flagsOffset);
+		EA stop = std::min(endEa, seg->endEa);
+		for (; next < stop; next++)
+		{
+			if (test(flags[next - seg->startEa]))
+				return next;
+		}
+	}
+	return BAD_EA;
+}
+
+EA SnapshotDatabase::PrevThat(EA ea, EA startEa, FLAGTEST test) const
+{
+	for (EA prev = ea; prev > startEa;)
+	{
+		// Last segment starting before the address
+		const SNAPSHOTSEGMENT *seg = std::upper_bound(m_segments, (m_segments + m_header->segmentCount), (prev - 1), [](EA v, const SNAPSHOTSEGMENT &s) { return(v < s.startEa); });
+		if (seg == m_segments)
+			break;
+		seg--;
+		if (seg->endEa <= startEa)
+			break;
+		prev = std::min(prev, seg->endEa);
+
+		const uint32_t *flags = (const uint32_t *) (m_base + seg->flagsOffset);
+		EA stop = std::max(startEa, seg->startEa);
+		for (; prev > stop; prev--)
+		{
+			if (test(flags[(prev - 1) - seg->startEa]))
+				return(prev - 1);
+		}
+	}
+	return BAD_EA;
+}
+
+EA SnapshotDatabase::NextInited(EA ea, EA endEa) const
+{
+	const SNAPSHOTSEGMENT *end = (m_segments + m_header->segmentCount);
+	for (EA next = (ea + 1); (next < endEa) && (ea != BAD_EA);)
+	{
+		const SNAPSHOTSEGMENT *seg = std::upper_bound(m_segments, end, next, [](EA v, const SNAPSHOTSEGMENT &s) { return(v < s.endEa); });
+		if ((seg == end) || (seg->startEa >= endEa))
+			break;
+		next = std::max(next, seg->startEa);
+
+		EA stop = std::min(endEa, seg->endEa);
+		uint64_t hit = findBit((const uint64_t *) (m_base + seg->initedOffset), (next - seg->startEa), (stop - seg->startEa), true);
+		if (hit < (stop - seg->startEa))
+			return(seg->startEa + hit);
+		next = stop;
+	}
+	return BAD_EA;
+}
+
+EA SnapshotDatabase::PrevInited(EA ea, EA startEa) const
+{
+	for (EA prev = ea; prev > startEa;)
+	{
+		const SNAPSHOTSEGMENT *seg = std::upper_bound(m_segments, (m_segments + m_header->segmentCount), (prev - 1), [](EA v, const SNAPSHOTSEGMENT &s) { return(v < s.startEa); });
+		if (seg == m_segments)
+			break;
+		seg--;
+		if (seg->endEa <= startEa)
+			break;
+		prev = std::min(prev, seg->endEa);
+
+		EA stop = std::max(startEa, seg->startEa);
+		uint64_t hit = findBitBack((const uint64_t *) (m_base + seg->initedOffset), (stop - seg->startEa), (prev - seg->startEa), true);
+		if (hit != BAD_EA)
+			return(seg->startEa + hit);
+		prev = stop;
+	}
+	return BAD_EA;
+}
+
+const uint8_t *SnapshotDatabase::ReadBytes(EA ea, size_t size, bool forward, size_t &inited) const
+{
+	inited = 0;
+	ptrdiff_t index = findSegment(ea);
+	if ((index < 0) || (size == 0))
+		return NULL;
+	const SNAPSHOTSEGMENT &seg = m_segments[index];
+	if ((size > SCAN_CHUNK_SIZE) || ((seg.endEa - ea) < size))
+		return NULL;
+
+	// Zero copy, straight from the mapping
+	const uint64_t *bitmap = (const uint64_t *) (m_base + seg.initedOffset);
+	uint64_t offset = (ea - seg.startEa);
+	if (forward)
+		inited = (size_t) (findBit(bitmap, offset, (offset + size), false) - offset);
+	else
+	{
+		uint64_t last = findBitBack(bitmap, offset, (offset + size), false);
+		inited = ((last == BAD_EA) ? size : (size_t) ((offset + size) - (last + 1)));
+	}
+	return(m_base + seg.bytesOffset + offset);
+}
+
+bool SnapshotDatabase::GetName(EA ea, std::string &name) const
+{
+	const SNAPSHOTNAME *end = (m_names + m_header->nameCount);
+	const SNAPSHOTNAME *sn = std::lower_bound(m_names, end, ea, [](const SNAPSHOTNAME &n, EA v) { return(n.ea < v); });
+	if ((sn == end) || (sn->ea != ea))
+		return false;
+	name.assign((m_strings + sn->stringOffset), sn->length);
+	return true;
+}
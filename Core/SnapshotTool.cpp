@@ -0,0 +1,187 @@
+// Snapshot command line tool.
+// Runs the core algorithms over an exported database snapshot, outside of IDA:
+//   utility_snapshot <snapshot file> [stub patterns file]
+#include "Snapshot.h"
+#include "Navigation.h"
+#include "AutoFormat.h"
+#include "FuncClusters.h"
+#include "PointerTables.h"
+#include "StubClassifier.h"
+#include "ZeroScan.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+
+static const size_t SURVEY_SAMPLE_SLOTS = 1024;
+
+static double timeStamp()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char *segmentTypeName(uint32_t type)
+{
+	switch (type)
+	{
+		case DBSEG_CODE: return "code";
+		case DBSEG_DATA: return "data";
+		case DBSEG_BSS:  return "bss";
+		case DBSEG_XTRN: return "xtrn";
+	};
+	return "other";
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2)
+	{
+		fprintf(stderr, "Usage: %s <snapshot file> [stub patterns file]\n", argv[0]);
+		return 1;
+	}
+
+	std::string error;
+	SnapshotDatabase db;
+	double startTime = timeStamp();
+	if (!db.Open(argv[1], error))
+	{
+		fprintf(stderr, "** %s **\n", error.c_str());
+		return 1;
+	}
+	printf("\"%s\": %llu bytes, %ubit, %016llX to %016llX, opened in %.3f ms.\n", argv[1], (unsigned long long) db.FileSize(), (db.Is64() ? 64 : 32),
+		(unsigned long long) db.MinEa(), (unsigned long long) db.MaxEa(), ((timeStamp() - startTime) * 1000.0));
+
+	// Segments, with the first and last non-zero byte of each
+	printf("Segments (%s scan):\n", ZeroScanISA());
+	startTime = timeStamp();
+	for (size_t i = 0; i < db.SegmentCount(); i++)
+	{
+		DBSEGMENT seg = db.Segment(i);
+		EA first = ScanNextNotZero(db, seg.startEa, seg.endEa);
+		EA last = ScanPrevNotZero(db, seg.startEa, seg.endEa);
+		printf(" %-12s %-5s %016llX %016llX", seg.name, segmentTypeName(seg.type), (unsigned long long) seg.startEa, (unsigned long long) seg.endEa);
+		if (first != BAD_EA)
+			printf(", not zero %016llX to %016llX\n", (unsigned long long) first, (unsigned long long) last);
+		else
+			printf(", all zero\n");
+	}
+	printf(" Scanned in %.3f ms.\n", ((timeStamp() - startTime) * 1000.0));
+
+	// Stub classification with the built-in patterns, plus any from the file
+	StubClassifier classifier;
+	std::vector<std::string> errors;
+	classifier.Parse(STUB_BUILTIN_PATTERNS, "built-in", errors);
+	if (argc >= 3)
+	{
+		std::ifstream file(argv[2], std::ios::binary);
+		if (!file)
+		{
+			fprintf(stderr, "** Failed to open \"%s\" **\n", argv[2]);
+			return 1;
+		}
+		std::stringstream text;
+		text << file.rdbuf();
+		classifier.Parse(text.str().c_str(), argv[2], errors);
+	}
+	for (const std::string &e : errors)
+		fprintf(stderr, "** Stub pattern %s **\n", e.c_str());
+	classifier.Compile(db.Is64());
+	classifier.SetImports(db);
+
+	startTime = timeStamp();
+	std::vector<uint32_t> counts(classifier.PrefixCount(), 0);
+	size_t candidates = 0;
+	for (size_t i = 0; i < db.FunctionCount(); i++)
+	{
+		DBFUNCTION f = db.Function(i);
+		if (!IsStubCandidate(f))
+			continue;
+		candidates++;
+
+		size_t size = (size_t) (f.endEa - f.startEa), inited;
+		const uint8_t *bytes = db.ReadBytes(f.startEa, size, true, inited);
+		if (inited != size)
+			continue;
+		int match = classifier.Match(bytes, size, f.startEa);
+		if (match != STUB_NO_MATCH)
+			counts[match]++;
+	}
+	printf("Stubs: %zu functions, %zu candidates, %zu signatures, classified in %.3f ms.\n", db.FunctionCount(), candidates, classifier.SigCount(), ((timeStamp() - startTime) * 1000.0));
+	for (uint32_t i = 0; i < classifier.PrefixCount(); i++)
+		printf(" %-12s %u\n", classifier.Prefix(i), counts[i]);
+
+	startTime = timeStamp();
+	FILLRUNCOUNTS fill;
+	CountFillRuns(db, SURVEY_SAMPLE_SLOTS, fill);
+	printf("Fill runs: %llu, %llu bytes, %llu struct arrays, surveyed in %.3f ms.\n", (unsigned long long) fill.runs, (unsigned long long) fill.bytes,
+		(unsigned long long) fill.structRuns, ((timeStamp() - startTime) * 1000.0));
+
+	// What the auto-format pass would do
+	startTime = timeStamp();
+	std::vector<FILLRUN> runs;
+	CollectFillRuns(db, ALL_SEGMENTS, sizeof(uint32_t), (sizeof(uint32_t) * 2), runs);
+	uint64_t classRuns[RUN_CLASS_COUNT] = {}, classBytes[RUN_CLASS_COUNT] = {};
+	for (const FILLRUN &run : runs)
+	{
+		RUNCLASS runClass = ClassifyFillRun(db, run);
+		classRuns[runClass]++;
+		classBytes[runClass] += (run.endEa - run.startEa);
+	}
+	printf("Auto-format runs: %zu, classified in %.3f ms.\n", runs.size(), ((timeStamp() - startTime) * 1000.0));
+	for (uint32_t i = 0; i < RUN_CLASS_COUNT; i++)
+		printf(" %-12s %llu, %llu bytes\n", RunClassName((RUNCLASS) i), (unsigned long long) classRuns[i], (unsigned long long) classBytes[i]);
+
+	// Pointer tables to code in the data segments
+	startTime = timeStamp();
+	CodeTargets targets;
+	targets.Build(db);
+	size_t ptrSize = (db.Is64() ? sizeof(uint64_t) : sizeof(uint32_t));
+	std::vector<PTRTABLE> tables;
+	for (size_t i = 0; i < db.SegmentCount(); i++)
+	{
+		DBSEGMENT seg = db.Segment(i);
+		if ((seg.type == DBSEG_CODE) || (seg.type == DBSEG_XTRN) || (seg.type == DBSEG_BSS))
+			continue;
+		std::vector<PTRTABLE> segRuns;
+		EA startEa = ((seg.startEa + (ptrSize - 1)) & ~((EA) ptrSize - 1));
+		for (EA ea = startEa; ea < seg.endEa; ea += SCAN_CHUNK_SIZE)
+		{
+			size_t size = (size_t) std::min((EA) SCAN_CHUNK_SIZE, (seg.endEa - ea)), inited;
+			const uint8_t *bytes = db.ReadBytes(ea, size, true, inited);
+			if (inited == size)
+				FindPointerRuns(bytes, size, ea, db.Is64(), targets, segRuns);
+		}
+		JoinPointerRuns(segRuns, db.Is64());
+		for (const PTRTABLE &run : segRuns)
+			SplitPointerTable(db, run, targets, tables);
+	}
+	size_t functionTables = 0;
+	for (const PTRTABLE &table : tables)
+		functionTables += (table.functions == table.count);
+	printf("Pointer tables: %zu, %zu all function starts, found in %.3f ms.\n", tables.size(), functionTables, ((timeStamp() - startTime) * 1000.0));
+
+	// Byte identical small functions that aren't stubs. The snapshot has no fixups, so relocated bytes aren't masked here.
+	startTime = timeStamp();
+	CLONETABLE clones;
+	for (size_t i = 0; i < db.FunctionCount(); i++)
+	{
+		DBFUNCTION f = db.Function(i);
+		if (!IsCloneCandidate(f))
+			continue;
+		size_t size = (size_t) (f.endEa - f.startEa), inited;
+		const uint8_t *bytes = db.ReadBytes(f.startEa, size, true, inited);
+		if ((inited == size) && !(IsStubCandidate(f) && (classifier.Match(bytes, size, f.startEa) != STUB_NO_MATCH)))
+			clones.Add(bytes, size);
+	}
+	clones.hashes.resize(clones.Count());
+	clones.Hash(0, clones.Count());
+	FUNCCLUSTERS clusters;
+	ClusterFunctions(clones, clusters);
+	size_t largest = 0;
+	for (size_t i = 0; i < clusters.Count(); i++)
+		largest = std::max(largest, clusters.MemberCount(i));
+	printf("Clone clusters: %zu of %zu candidates in %zu clusters, largest %zu, %u hash collisions, clustered in %.3f ms.\n", clusters.members.size(),
+		clones.Count(), clusters.Count(), largest, clusters.collisions, ((timeStamp() - startTime) * 1000.0));
+	return 0;
+}
@@ -0,0 +1,166 @@
+// Database snapshot file writer
+#include "Snapshot.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+static bool hasNameFlags(uint32_t flags) { return((flags & DBF_NAME) != 0); }
+
+static inline uint64_t align8(uint64_t offset) { return((offset + 7) & ~(uint64_t) 7); }
+
+// Streaming writer that keeps the file offset and pads to the layout alignment
+class SnapshotFile
+{
+public:
+	SnapshotFile() : m_fp(NULL), m_offset(0), m_failed(false) {}
+	~SnapshotFile() { if (m_fp) fclose(m_fp); }
+
+	bool Create(const char *path) { m_fp = fopen(path, "wb"); return(m_fp != NULL); }
+
+	void Write(const void *data, size_t size)
+	{
+		if (!m_failed && size && (fwrite(data, size, 1, m_fp) != 1))
+			m_failed = true;
+		m_offset += size;
+	}
+
+	// Pad to 8 bytes, return the offset
+	uint64_t Align()
+	{
+		static const uint8_t zeros[8] = {};
+		Write(zeros, (size_t) (align8(m_offset) - m_offset));
+		return m_offset;
+	}
+
+	// Rewrite a placeholder near the start of the file
+	void Rewrite(uint64_t offset, const void *data, size_t size)
+	{
+		if (!m_failed && size && ((fseek(m_fp, (long) offset, SEEK_SET) != 0) || (fwrite(data, size, 1, m_fp) != 1)))
+			m_failed = true;
+	}
+
+	bool Close()
+	{
+		if (m_fp && (fclose(m_fp) != 0))
+			m_failed = true;
+		m_fp = NULL;
+		return !m_failed;
+	}
+
+	bool Failed() const { return m_failed; }
+
+private:
+	FILE *m_fp;
+	uint64_t m_offset;
+	bool m_failed;
+};
+
+bool WriteSnapshot(const IDatabase &db, const char *path, std::string &error)
+{
+	SnapshotFile file;
+	if (!file.Create(path))
+	{
+		error = std::string("Failed to create \"") + path + "\"";
+		return false;
+	}
+
+	SNAPSHOTHEADER header = {};
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.version = SNAPSHOT_VERSION;
+	header.is64 = db.Is64();
+	header.minEa = db.MinEa();
+	header.maxEa = db.MaxEa();
+
+	// Header and segment table placeholders, rewritten at the end with the offsets
+	std::vector<SNAPSHOTSEGMENT> segments(db.SegmentCount());
+	file.Write(&header, sizeof(header));
+	header.segmentCount = segments.size();
+	header.segmentsOffset = file.Align();
+	file.Write(segments.data(), (segments.size() * sizeof(SNAPSHOTSEGMENT)));
+
+	std::vector<uint32_t> flags;
+	std::vector<uint8_t> bytes;
+	std::vector<uint64_t> bitmap;
+	std::vector<SNAPSHOTNAME> names;
+	std::string strings;
+	std::string name;
+	for (size_t i = 0; (i < segments.size()) && !file.Failed(); i++)
+	{
+		DBSEGMENT seg = db.Segment(i);
+		SNAPSHOTSEGMENT &ss = segments[i];
+		ss.startEa = seg.startEa;
+		ss.endEa = seg.endEa;
+		ss.type = seg.type;
+		memcpy(ss.name, seg.name, sizeof(ss.name));
+		ss.name[sizeof(ss.name) - 1] = 0;
+
+		// One flags pass, the bytes and the initialized bitmap are taken from them
+		uint64_t size = (seg.endEa - seg.startEa);
+		bytes.assign((size_t) size, 0);
+		bitmap.assign((size_t) ((size + 63) / 64), 0);
+		ss.flagsOffset = file.Align();
+		for (uint64_t offset = 0; offset < size; offset += SCAN_CHUNK_SIZE)
+		{
+			size_t count = (size_t) std::min((uint64_t) SCAN_CHUNK_SIZE, (size - offset));
+			flags.resize(count);
+			for (size_t j = 0; j < count; j++)
+			{
+				uint64_t k = (offset + j);
+				flags[j] = db.Flags(seg.startEa + k);
+				if (flags[j] & DBF_IVL)
+				{
+					bytes[(size_t) k] = (uint8_t) (flags[j] & DBF_VAL_MASK);
+					bitmap[(size_t) (k / 64)] |= (1ull << (k & 63));
+				}
+			}
+			file.Write(flags.data(), (count * sizeof(uint32_t)));
+		}
+
+		ss.bytesOffset = file.Align();
+		file.Write(bytes.data(), bytes.size());
+		ss.initedOffset = file.Align();
+		file.Write(bitmap.data(), (bitmap.size() * sizeof(uint64_t)));
+
+		// Names, segments are in address order so these come out sorted
+		EA ea = seg.startEa;
+		if (!hasNameFlags(db.Flags(ea)))
+			ea = db.NextThat(ea, seg.endEa, hasNameFlags);
+		while (ea != BAD_EA)
+		{
+			if (db.GetName(ea, name))
+			{
+				SNAPSHOTNAME sn = { ea, (uint32_t) strings.size(), (uint32_t) name.size() };
+				names.push_back(sn);
+				strings.append(name.c_str(), (name.size() + 1));
+			}
+			ea = db.NextThat(ea, seg.endEa, hasNameFlags);
+		}
+	}
+
+	header.functionCount = db.FunctionCount();
+	header.functionsOffset = file.Align();
+	for (size_t i = 0; i < header.functionCount; i++)
+	{
+		DBFUNCTION f = db.Function(i);
+		SNAPSHOTFUNCTION sf = { f.startEa, f.endEa, f.flags, 0 };
+		file.Write(&sf, sizeof(sf));
+	}
+
+	header.nameCount = names.size();
+	header.namesOffset = file.Align();
+	file.Write(names.data(), (names.size() * sizeof(SNAPSHOTNAME)));
+	header.stringsSize = strings.size();
+	header.stringsOffset = file.Align();
+	file.Write(strings.data(), strings.size());
+	file.Align();
+
+	file.Rewrite(0, &header, sizeof(header));
+	file.Rewrite(header.segmentsOffset, segments.data(), (segments.size() * sizeof(SNAPSHOTSEGMENT)));
+
+	if (!file.Close())
+	{
+		error = std::string("Failed to write \"") + path + "\"";
+		return false;
+	}
+	return true;
+}
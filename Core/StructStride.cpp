@@ -0,0 +1,103 @@
+// Record stride detection for the struct array fill
+#include "StructStride.h"
+#include <algorithm>
+#include <string.h>
+#ifdef CORE_X86
+#include <emmintrin.h>
+#endif
+
+// Count equal bytes between two arrays
+static size_t countMatches(const uint8_t *a, const uint8_t *b, size_t size)
+{
+	size_t matches = 0, i = 0;
+#ifdef CORE_X86
+	for (; (i + 16) <= size; i += 16)
+		matches += PopCount32((uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + i)), _mm_loadu_si128((const __m128i*) (b + i)))));
+#endif
+	for (; i < size; i++)
+		matches += (a[i] == b[i]);
+	return matches;
+}
+
+void ClassifySlots(const uint8_t *bytes, size_t slotCount, EA minEa, EA maxEa, bool is64, std::vector<uint8_t> &classes)
+{
+	classes.resize(slotCount);
+	for (size_t i = 0; i < slotCount; i++)
+	{
+		if (is64 && ((i & 1) == 0) && ((i + 1) < slotCount))
+		{
+			uint64_t v;
+			memcpy(&v, (bytes + (i * sizeof(uint32_t))), sizeof(v));
+			if (v && (v >= minEa) && (v < maxEa))
+			{
+				classes[i] = SLOT_PTR;
+				classes[++i] = SLOT_PTR_HIGH;
+				continue;
+			}
+		}
+
+		uint32_t v;
+		memcpy(&v, (bytes + (i * sizeof(uint32_t))), sizeof(v));
+		if (v == 0)
+			classes[i] = SLOT_ZERO;
+		else
+		if (!is64 && (v >= minEa) && (v < maxEa))
+			classes[i] = SLOT_PTR;
+		else
+		if (v < 0x10000)
+			classes[i] = SLOT_SMALL;
+		else
+			classes[i] = SLOT_OTHER;
+	}
+}
+
+uint32_t DetectStride(const std::vector<uint8_t> &classes, bool is64, double &score)
+{
+	size_t slotCount = classes.size();
+	double scores[MAX_STRIDE_SLOTS + 1] = {};
+	double bestScore = 0.0;
+	uint32_t maxStride = (uint32_t) std::min((size_t) MAX_STRIDE_SLOTS, (slotCount / 2));
+	for (uint32_t stride = 1; stride <= maxStride; stride++)
+	{
+		// 64bit pointers can't be split across records
+		if (is64 && (stride & 1))
+			continue;
+		size_t size = (slotCount - stride);
+		scores[stride] = ((double) countMatches(classes.data(), classes.data() + stride, size) / (double) size);
+		bestScore = std::max(bestScore, scores[stride]);
+	}
+
+	// Multiples of the real stride score the same, take the shortest one close to the best
+	for (uint32_t stride = 1; stride <= maxStride; stride++)
+	{
+		if ((scores[stride] > 0.0) && (scores[stride] >= (bestScore * 0.97)))
+		{
+			score = scores[stride];
+			return stride;
+		}
+	}
+	return 0;
+}
+
+void RecordLayout(const std::vector<uint8_t> &classes, uint32_t stride, bool is64, std::vector<uint8_t> &layout)
+{
+	layout.resize(stride);
+	size_t records = (classes.size() / stride);
+	for (uint32_t j = 0; j < stride; j++)
+	{
+		uint32_t votes[SLOT_OTHER + 1] = {};
+		for (size_t r = 0; r < records; r++)
+			votes[classes[(r * stride) + j]]++;
+		layout[j] = (uint8_t) (std::max_element(votes, (votes + (SLOT_OTHER + 1))) - votes);
+	}
+
+	// A 64bit pointer needs both halves
+	for (uint32_t j = 0; j < stride; j++)
+	{
+		if (is64 && (layout[j] == SLOT_PTR) && (((j + 1) >= stride) || (layout[j + 1] != SLOT_PTR_HIGH)))
+			layout[j] = SLOT_OTHER;
+		else
+		if ((layout[j] == SLOT_PTR_HIGH) && ((j == 0) || (layout[j - 1] != SLOT_PTR)))
+			layout[j] = SLOT_OTHER;
+	}
+}
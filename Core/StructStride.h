@@ -0,0 +1,27 @@
+// Record stride detection for the struct array fill.
+// A run is reduced to a class per DWORD slot, then the record stride is the shortest lag with a near best
+// autocorrelation of that class sequence.
+#pragma once
+#include "CoreTypes.h"
+#include <vector>
+
+// DWORD slot classes
+enum
+{
+	SLOT_ZERO,     // Zero
+	SLOT_PTR,      // Pointer, or low half of a 64bit pointer
+	SLOT_PTR_HIGH, // High half of a 64bit pointer
+	SLOT_SMALL,    // Small integer value
+	SLOT_OTHER,
+};
+
+const uint32_t MAX_STRIDE_SLOTS = 32; // Up to 128 byte records
+
+// Classify the DWORD slots of a run, pointers being values in [minEa, maxEa)
+void ClassifySlots(const uint8_t *bytes, size_t slotCount, EA minEa, EA maxEa, bool is64, std::vector<uint8_t> &classes);
+
+// Detect the record stride in slots, 0 if none
+uint32_t DetectStride(const std::vector<uint8_t> &classes, bool is64, double &score);
+
+// Majority class of each slot of the record over the run
+void RecordLayout(const std::vector<uint8_t> &classes, uint32_t stride, bool is64, std::vector<uint8_t> &layout);
@@ -0,0 +1,414 @@
+// Stub function byte pattern matcher.
+//
+// Pattern text format, one per line, ';' starts a comment:
+//   <name prefix> <bitness: 32, 64 or *> <byte sequence>
+// The sequence is hex bytes, "??" for any byte (like an immediate operand), and can end with "RET" for any return instruction.
+// Or it can end with "IMPORT", four operand bytes that have to address a pointer in an import segment: RIP relative
+// on 64bit, absolute on 32bit. Like the "jmp [import]" thunk.
+// It can be any number of instructions, but has to match the whole function.
+// Where more than one pattern matches, the first one wins.
+#include "StubClassifier.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char STUB_BUILTIN_PATTERNS[] =
+	"nullSub_   *   RET                               ; return\n"
+
+	// Return bool true
+	"trueSub_   *   B0 01 RET                         ; mov al, 1\n"
+	"trueSub_   *   C6 C0 01 RET                      ; mov al, 1\n"
+
+	// Return bool false
+	"falseSub_  *   32 C0 RET                         ; xor al, al\n"
+	"falseSub_  *   30 C0 RET                         ; xor al, al\n"
+	"falseSub_  *   2A C0 RET                         ; sub al, al\n"
+	"falseSub_  *   28 C0 RET                         ; sub al, al\n"
+	"falseSub_  *   B0 00 RET                         ; mov al, 0\n"
+	"falseSub_  *   C6 C0 00 RET                      ; mov al, 0\n"
+
+	// Return 0/NULL/FALSE
+	"zeroSub_   32  33 C0 RET                         ; xor eax, eax\n"
+	"zeroSub_   32  31 C0 RET                         ; xor eax, eax\n"
+	"zeroSub_   32  2B C0 RET                         ; sub eax, eax\n"
+	"zeroSub_   32  29 C0 RET                         ; sub eax, eax\n"
+	"zeroSub_   32  B8 00 00 00 00 RET                ; mov eax, 0\n"
+	"zeroSub_   32  C7 C0 00 00 00 00 RET             ; mov eax, 0\n"
+	"zeroSub_   32  66 B8 00 00 RET                   ; mov ax, 0\n"
+	"zeroSub_   32  66 C7 C0 00 00 RET                ; mov ax, 0\n"
+	"zeroSub_   64  48 33 C0 RET                      ; xor rax, rax\n"
+	"zeroSub_   64  48 31 C0 RET                      ; xor rax, rax\n"
+	"zeroSub_   64  48 2B C0 RET                      ; sub rax, rax\n"
+	"zeroSub_   64  48 29 C0 RET                      ; sub rax, rax\n"
+	"zeroSub_   64  48 C7 C0 00 00 00 00 RET          ; mov rax, 0\n"
+	"zeroSub_   64  48 B8 00 00 00 00 00 00 00 00 RET ; mov rax, 0\n"
+
+	// Return BOOL TRUE
+	"trueSub_   32  B8 01 00 00 00 RET                ; mov eax, 1\n"
+	"trueSub_   32  C7 C0 01 00 00 00 RET             ; mov eax, 1\n"
+	"trueSub_   64  48 C7 C0 01 00 00 00 RET          ; mov rax, 1\n"
+	"trueSub_   64  48 B8 01 00 00 00 00 00 00 00 RET ; mov rax, 1\n"
+
+	// Return floating point zero
+	"fZeroSub_  32  D9 EE RET                         ; fldz\n"
+	"fZeroSub_  64  66 0F 73 D8 00 RET                ; psrldq xmm0, 0\n"
+
+	// Return any other constant, the ones above win
+	"constSub_  *   B8 ?? ?? ?? ?? RET                ; mov eax, imm\n"
+	"constSub_  64  48 C7 C0 ?? ?? ?? ?? RET          ; mov rax, imm\n"
+
+	// Return a global
+	"getGlobalSub_ 32 A1 ?? ?? ?? ?? RET              ; mov eax, [g]\n"
+	"getGlobalSub_ *  8B 05 ?? ?? ?? ?? RET           ; mov eax, [g] / [rip+g]\n"
+	"getGlobalSub_ 64 48 8B 05 ?? ?? ?? ?? RET        ; mov rax, [rip+g]\n"
+
+	// Return a field of 'this' (ecx/rcx, or rdi for the System V ABI)
+	"getFieldSub_ *   8B 01 RET                       ; mov eax, [ecx]\n"
+	"getFieldSub_ *   8B 41 ?? RET                    ; mov eax, [ecx+N]\n"
+	"getFieldSub_ *   8B 81 ?? ?? ?? ?? RET           ; mov eax, [ecx+N]\n"
+	"getFieldSub_ 64  48 8B 01 RET                    ; mov rax, [rcx]\n"
+	"getFieldSub_ 64  48 8B 41 ?? RET                 ; mov rax, [rcx+N]\n"
+	"getFieldSub_ 64  48 8B 81 ?? ?? ?? ?? RET        ; mov rax, [rcx+N]\n"
+	"getFieldSub_ 64  8B 07 RET                       ; mov eax, [rdi]\n"
+	"getFieldSub_ 64  8B 47 ?? RET                    ; mov eax, [rdi+N]\n"
+	"getFieldSub_ 64  8B 87 ?? ?? ?? ?? RET           ; mov eax, [rdi+N]\n"
+	"getFieldSub_ 64  48 8B 07 RET                    ; mov rax, [rdi]\n"
+	"getFieldSub_ 64  48 8B 47 ?? RET                 ; mov rax, [rdi+N]\n"
+	"getFieldSub_ 64  48 8B 87 ?? ?? ?? ?? RET        ; mov rax, [rdi+N]\n"
+
+	// Jump thunk to an import
+	"thunkSub_  *   FF 25 IMPORT                      ; jmp [import]\n"
+	"thunkSub_  64  48 FF 25 IMPORT                   ; rex.w jmp [import]\n";
+
+// What "RET" stands for
+static const char *const s_returnSequences[] =
+{
+	"C3",       // retn
+	"F3 C3",    // rep retn
+	"C2 ?? ??", // retn N
+	"CB",       // retf
+	"CA ?? ??", // retf N
+};
+
+bool IsStubCandidate(const DBFUNCTION &func)
+{
+	EA size = (func.endEa - func.startEa);
+	return(!(func.flags & (DBFUNC_NORET | DBFUNC_TAIL)) && (size > 0) && (size <= MAX_STUB_BYTES));
+}
+
+// ======================================================================================
+
+static inline int hexNibble(char c)
+{
+	if ((c >= '0') && (c <= '9'))
+		return(c - '0');
+	c |= 0x20;
+	if ((c >= 'a') && (c <= 'f'))
+		return(c - 'a' + 10);
+	return -1;
+}
+
+static void splitTokens(const std::string &line, std::vector<std::string> &tokens)
+{
+	tokens.clear();
+	size_t pos = 0;
+	for (;;)
+	{
+		pos = line.find_first_not_of(" \t\r", pos);
+		if (pos == std::string::npos)
+			break;
+		size_t end = line.find_first_of(" \t\r", pos);
+		if (end == std::string::npos)
+			end = line.size();
+		tokens.push_back(line.substr(pos, (end - pos)));
+		pos = end;
+	}
+}
+
+// Name prefixes end with the '_' the serial number follows
+static bool isValidPrefix(const std::string &prefix)
+{
+	if ((prefix.size() < 2) || (prefix.size() > 32) || (prefix.back() != '_') || isdigit((uint8_t) prefix[0]))
+		return false;
+	for (size_t i = 0; i < (prefix.size() - 1); i++)
+	{
+		if (!isalnum((uint8_t) prefix[i]) && (prefix[i] != '_'))
+			return false;
+	}
+	return true;
+}
+
+static inline uint32_t sigKey(const uint8_t *bytes, size_t size)
+{
+	return (uint32_t) ((size << 8) | bytes[0]);
+}
+
+// ======================================================================================
+
+StubClassifier::StubClassifier() : m_compiledBits(0)
+{
+	Clear();
+	for (const char *sequence : s_returnSequences)
+	{
+		std::vector<std::string> tokens;
+		splitTokens(sequence, tokens);
+		PATTERNLINE pl = {};
+		parseSequence(tokens, 0, pl);
+		m_returns.push_back(pl);
+	}
+}
+
+// Parse the byte sequence tokens from 'first' on, returns an error string or NULL
+const char *StubClassifier::parseSequence(const std::vector<std::string> &tokens, size_t first, PATTERNLINE &pl)
+{
+	for (size_t i = first; i < tokens.size(); i++)
+	{
+		const std::string &token = tokens[i];
+		if (token == "RET")
+		{
+			if (i != (tokens.size() - 1))
+				return "RET has to end the sequence";
+			pl.ret = true;
+		}
+		else
+		if (token == "IMPORT")
+		{
+			if (i != (tokens.size() - 1))
+				return "IMPORT has to end the sequence";
+			pl.import = true;
+			pl.bytes.insert(pl.bytes.end(), 4, 0);
+			pl.mask.insert(pl.mask.end(), 4, 0);
+		}
+		else
+		if (token == "??")
+		{
+			pl.bytes.push_back(0);
+			pl.mask.push_back(0);
+		}
+		else
+		{
+			if ((token.size() != 2) || (hexNibble(token[0]) < 0) || (hexNibble(token[1]) < 0))
+				return "expected a hex byte, \"??\" or \"RET\"";
+			pl.bytes.push_back((uint8_t) ((hexNibble(token[0]) << 4) | hexNibble(token[1])));
+			pl.mask.push_back(0xFF);
+		}
+	}
+
+	if (pl.bytes.empty() && !pl.ret)
+		return "empty byte sequence";
+	if ((pl.bytes.size() + (pl.ret ? 1 : 0)) > MAX_STUB_BYTES)
+		return "sequence is longer than the largest stub size";
+	return NULL;
+}
+
+uint32_t StubClassifier::prefixIndex(const std::string &prefix)
+{
+	for (uint32_t i = 0; i < (uint32_t) m_prefixes.size(); i++)
+	{
+		if (m_prefixes[i] == prefix)
+			return i;
+	}
+	m_prefixes.push_back(prefix);
+	return (uint32_t) (m_prefixes.size() - 1);
+}
+
+uint32_t StubClassifier::Parse(const char *text, const char *source, std::vector<std::string> &errors)
+{
+	uint32_t count = 0, lineNumber = 0;
+	std::vector<std::string> tokens;
+	while (*text)
+	{
+		// Next line, less any comment
+		const char *end = strchr(text, '\n');
+		std::string line(text, (end ? (size_t) (end - text) : strlen(text)));
+		text += (line.size() + (end ? 1 : 0));
+		lineNumber++;
+		size_t comment = line.find(';');
+		if (comment != std::string::npos)
+			line.resize(comment);
+
+		splitTokens(line, tokens);
+		if (tokens.empty())
+			continue;
+
+		PATTERNLINE pl = {};
+		const char *error = NULL;
+		if (tokens.size() < 3)
+			error = "expected <name prefix> <32, 64 or *> <byte sequence>";
+		else
+		if (!isValidPrefix(tokens[0]))
+			error = "name prefix has to be a C identifier ending with a '_'";
+		else
+		if ((tokens[1] != "32") && (tokens[1] != "64") && (tokens[1] != "*"))
+			error = "bitness has to be 32, 64 or *";
+		else
+			error = parseSequence(tokens, 2, pl);
+
+		if (error)
+		{
+			errors.push_back(std::string("\"") + source + "\" line " + std::to_string(lineNumber) + ": " + error);
+			continue;
+		}
+
+		pl.prefix = prefixIndex(tokens[0]);
+		pl.bits = ((tokens[1] == "*") ? 0 : atoi(tokens[1].c_str()));
+		m_lines.push_back(pl);
+		count++;
+	}
+
+	// Has to be recompiled to see the new lines
+	m_compiledBits = 0;
+	return count;
+}
+
+void StubClassifier::addSig(const PATTERNLINE &pl, const PATTERNLINE *ret)
+{
+	size_t size = (pl.bytes.size() + (ret ? ret->bytes.size() : 0));
+	if (size > MAX_STUB_BYTES)
+		return;
+
+	STUBSIG sig = {};
+	sig.prefix = pl.prefix;
+	sig.size = (uint8_t) size;
+	sig.import = pl.import;
+	memcpy(sig.bytes, pl.bytes.data(), pl.bytes.size());
+	memcpy(sig.mask, pl.mask.data(), pl.mask.size());
+	if (ret)
+	{
+		memcpy(&sig.bytes[pl.bytes.size()], ret->bytes.data(), ret->bytes.size());
+		memcpy(&sig.mask[pl.bytes.size()], ret->mask.data(), ret->mask.size());
+	}
+
+	m_sigs.push_back(sig);
+}
+
+void StubClassifier::Clear()
+{
+	m_sigs.clear();
+	m_bucketSigs.clear();
+	memset(m_bucketStart, 0, sizeof(m_bucketStart));
+	for (std::vector<uint32_t> &wild : m_wildSigs)
+		wild.clear();
+	m_compiledBits = 0;
+}
+
+bool StubClassifier::Compile(bool is64)
+{
+	uint32_t bits = (is64 ? 64 : 32);
+	if (bits == m_compiledBits)
+		return false;
+
+	Clear();
+	for (const PATTERNLINE &pl : m_lines)
+	{
+		if (pl.bits && (pl.bits != bits))
+			continue;
+		if (!pl.ret)
+			addSig(pl, NULL);
+		else
+		{
+			for (const PATTERNLINE &ret : m_returns)
+				addSig(pl, &ret);
+		}
+	}
+
+	// Group the sigs by key, a counting sort keeps the pattern order in each group
+	std::vector<uint32_t> counts(BUCKET_COUNT, 0);
+	for (const STUBSIG &sig : m_sigs)
+	{
+		if (sig.mask[0])
+			counts[sigKey(sig.bytes, sig.size)]++;
+	}
+	for (size_t key = 0; key < BUCKET_COUNT; key++)
+		m_bucketStart[key + 1] = (m_bucketStart[key] + counts[key]);
+	m_bucketSigs.resize(m_bucketStart[BUCKET_COUNT]);
+	for (size_t key = 0; key < BUCKET_COUNT; key++)
+		counts[key] = m_bucketStart[key];
+	for (uint32_t index = 0; index < (uint32_t) m_sigs.size(); index++)
+	{
+		const STUBSIG &sig = m_sigs[index];
+		if (sig.mask[0])
+			m_bucketSigs[counts[sigKey(sig.bytes, sig.size)]++] = index;
+		else
+			m_wildSigs[sig.size].push_back(index);
+	}
+	m_compiledBits = bits;
+	return true;
+}
+
+size_t StubClassifier::BucketCount() const
+{
+	size_t count = 0;
+	for (size_t key = 0; key < BUCKET_COUNT; key++)
+		count += (m_bucketStart[key + 1] != m_bucketStart[key]);
+	return count;
+}
+
+void StubClassifier::SetImports(const IDatabase &db)
+{
+	m_imports.clear();
+	for (size_t i = 0; i < db.SegmentCount(); i++)
+	{
+		DBSEGMENT seg = db.Segment(i);
+		if (seg.type == DBSEG_XTRN)
+			m_imports.push_back(seg);
+	}
+}
+
+// The last four bytes of the function address an import pointer
+bool StubClassifier::isImportOperand(const uint8_t *bytes, size_t size, EA ea) const
+{
+	if ((ea == BAD_EA) || m_imports.empty())
+		return false;
+	int32_t operand;
+	memcpy(&operand, (bytes + (size - sizeof(operand))), sizeof(operand));
+	EA target = ((m_compiledBits == 64) ? (ea + size + (int64_t) operand) : (EA) (uint32_t) operand);
+	for (const DBSEGMENT &seg : m_imports)
+	{
+		if ((target >= seg.startEa) && (target < seg.endEa))
+			return true;
+	}
+	return false;
+}
+
+static inline bool isOfSig(const uint8_t *bytes, const uint8_t *sigBytes, const uint8_t *sigMask, uint32_t size)
+{
+	for (uint32_t i = 0; i < size; i++)
+	{
+		if ((bytes[i] & sigMask[i]) != sigBytes[i])
+			return false;
+	}
+	return true;
+}
+
+int StubClassifier::Match(const uint8_t *bytes, size_t size, EA ea) const
+{
+	if ((size == 0) || (size > MAX_STUB_BYTES))
+		return STUB_NO_MATCH;
+
+	// First match in pattern order, from either the grouped or the wildcard sigs
+	uint32_t first = UINT32_MAX;
+	uint32_t key = sigKey(bytes, size);
+	for (uint32_t i = m_bucketStart[key]; i < m_bucketStart[key + 1]; i++)
+	{
+		uint32_t index = m_bucketSigs[i];
+		const STUBSIG &sig = m_sigs[index];
+		if (isOfSig(bytes, sig.bytes, sig.mask, sig.size) && (!sig.import || isImportOperand(bytes, size, ea)))
+		{
+			first = index;
+			break;
+		}
+	}
+	for (uint32_t index : m_wildSigs[size])
+	{
+		if (index >= first)
+			break;
+		const STUBSIG &sig = m_sigs[index];
+		if (isOfSig(bytes, sig.bytes, sig.mask, sig.size) && (!sig.import || isImportOperand(bytes, size, ea)))
+		{
+			first = index;
+			break;
+		}
+	}
+	return((first != UINT32_MAX) ? (int) m_sigs[first].prefix : STUB_NO_MATCH);
+}
@@ -0,0 +1,88 @@
+// Stub function byte pattern matcher.
+// Pattern text is compiled per database bitness into whole function signatures, grouped in a table indexed by the size
+// and first byte, with wildcard led signatures kept in a list per size. Everything is matched from the one copy of the
+// function bytes, the only thing looked up outside of them is an IMPORT operand's target segment.
+#pragma once
+#include "Database.h"
+#include <string>
+#include <vector>
+
+// Largest stub function size the patterns can match
+const size_t MAX_STUB_BYTES = 16;
+
+// No pattern matched
+const int STUB_NO_MATCH = -1;
+
+// The built-in pattern text
+extern const char STUB_BUILTIN_PATTERNS[];
+
+// Return true if the function could be a stub: returns, not a tail chunk, and 1 to MAX_STUB_BYTES in size
+bool IsStubCandidate(const DBFUNCTION &func);
+
+class StubClassifier
+{
+public:
+	StubClassifier();
+
+	// Parse pattern text, returns the count of patterns added.
+	// Bad lines are skipped, with a "<source> line <n>: <reason>" string added to 'errors' for each.
+	uint32_t Parse(const char *text, const char *source, std::vector<std::string> &errors);
+
+	// Compile the parsed patterns for a bitness, returns false if already compiled for it
+	bool Compile(bool is64);
+	void Clear();
+
+	// Set the import segments the IMPORT operands have to point into, from the database's DBSEG_XTRN ones
+	void SetImports(const IDatabase &db);
+
+	// Return the name prefix index of the first pattern that matches the bytes of the function at 'ea' exactly, or STUB_NO_MATCH.
+	// With 'ea' BAD_EA the IMPORT patterns don't match. Thread safe between compiles.
+	int Match(const uint8_t *bytes, size_t size, EA ea = BAD_EA) const;
+
+	// Stub name prefixes, like "zeroSub_", in the order they first appear in the patterns
+	uint32_t PrefixCount() const { return (uint32_t) m_prefixes.size(); }
+	const char *Prefix(uint32_t index) const { return m_prefixes[index].c_str(); }
+
+	size_t SigCount() const { return m_sigs.size(); }
+	size_t BucketCount() const;
+
+private:
+	// A parsed pattern line
+	struct PATTERNLINE
+	{
+		uint32_t prefix;           // Name prefix index
+		uint32_t bits;             // 32, 64, or 0 for either
+		bool ret;                  // Ends with any return
+		bool import;               // Ends with a jump operand through an import pointer
+		std::vector<uint8_t> bytes;
+		std::vector<uint8_t> mask; // 0 for wildcard bytes
+	};
+
+	// A compiled whole function signature
+	struct STUBSIG
+	{
+		uint32_t prefix;
+		uint8_t size;
+		bool import;
+		uint8_t bytes[MAX_STUB_BYTES];
+		uint8_t mask[MAX_STUB_BYTES];
+	};
+
+	static const char *parseSequence(const std::vector<std::string> &tokens, size_t first, PATTERNLINE &pl);
+	uint32_t prefixIndex(const std::string &prefix);
+	void addSig(const PATTERNLINE &pl, const PATTERNLINE *ret);
+	bool isImportOperand(const uint8_t *bytes, size_t size, EA ea) const;
+
+	std::vector<std::string> m_prefixes;
+	std::vector<PATTERNLINE> m_lines;
+	std::vector<PATTERNLINE> m_returns;
+
+	static const size_t BUCKET_COUNT = ((MAX_STUB_BYTES + 1) * 256);
+
+	std::vector<STUBSIG> m_sigs;                          // In pattern order
+	std::vector<uint32_t> m_bucketSigs;                   // Sig indexes grouped by the size and first byte, in pattern order per group
+	uint32_t m_bucketStart[BUCKET_COUNT + 1];             // Each group's start in 'm_bucketSigs'
+	std::vector<uint32_t> m_wildSigs[MAX_STUB_BYTES + 1]; // Sig indexes with a wildcard first byte, by size
+	std::vector<DBSEGMENT> m_imports;                     // Import segments, in address order
+	uint32_t m_compiledBits;
+};
@@ -0,0 +1,279 @@
+// Generated in memory database for the benchmarks
+#include "SyntheticDatabase.h"
+#include "StubClassifier.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+
+// Stub bodies the built-in patterns match, for either bitness and then per bitness
+static const char *const s_commonStubs[] = { "C3", "B0 01 C3", "32 C0 C3", "C2 08 00" };
+static const char *const s_stubs32[] = { "D9 EE C3", "33 C0 C3", "B8 01 00 00 00 C3", "66 B8 00 00 C3" };
+static const char *const s_stubs64[] = { "48 33 C0 C3", "48 C7 C0 01 00 00 00 C3", "66 0F 73 D8 00 C3" };
+
+static void parseHex(const char *text, std::vector<uint8_t> &bytes)
+{
+	bytes.clear();
+	for (const char *p = text; *p;)
+	{
+		if (*p == ' ')
+		{
+			p++;
+			continue;
+		}
+		bytes.push_back((uint8_t) strtoul(std::string(p, 2).c_str(), NULL, 16));
+		p += 2;
+	}
+}
+
+SYNTHCONFIG DefaultSynthConfig()
+{
+	SYNTHCONFIG config;
+	config.is64 = true;
+	config.functions = 1000000;
+	config.stubRatio = 0.25;
+	config.zeroBytes = (16 * 1024 * 1024);
+	config.dataBytes = (8 * 1024 * 1024);
+	config.labelSpacing = 4096;
+	config.rdataBytes = (8 * 1024 * 1024);
+	config.xrefSpacing = 16;
+	config.bssBytes = (4 * 1024 * 1024);
+	config.seed = 1;
+	return config;
+}
+
+SyntheticDatabase::SEGDATA &SyntheticDatabase::addSegment(const char *name, uint32_t type, uint64_t size)
+{
+	// Page aligned, with a gap page between segments
+	EA startEa = (m_config.is64 ? 0x140001000ull : 0x401000ull);
+	if (!m_segments.empty())
+		startEa = (((m_segments.back().seg.endEa + 0xFFF) & ~0xFFFull) + 0x1000);
+
+	m_segments.push_back(SEGDATA());
+	SEGDATA &sd = m_segments.back();
+	sd.seg.startEa = startEa;
+	sd.seg.endEa = (startEa + size);
+	sd.seg.type = type;
+	snprintf(sd.seg.name, sizeof(sd.seg.name), "%s", name);
+	sd.flags.assign((size_t) size, 0);
+	sd.bytes.assign((size_t) size, 0);
+	sd.inited = (type != DBSEG_BSS);
+	return sd;
+}
+
+SyntheticDatabase::SyntheticDatabase(const SYNTHCONFIG &config) : m_config(config), m_stubCount(0)
+{
+	m_segments.reserve(5);
+	std::mt19937 rng(config.seed);
+	auto random = [&rng](uint32_t n) { return (uint32_t) (rng() % n); };
+
+	// Function stubs and non-stubs, sized up front to get the segment size
+	std::vector<std::vector<uint8_t>> stubs;
+	std::vector<uint8_t> bytes;
+	for (const char *s : s_commonStubs)
+	{
+		parseHex(s, bytes);
+		stubs.push_back(bytes);
+	}
+	const char *const *bitnessStubs = (config.is64 ? s_stubs64 : s_stubs32);
+	size_t bitnessCount = (config.is64 ? (sizeof(s_stubs64) / sizeof(s_stubs64[0])) : (sizeof(s_stubs32) / sizeof(s_stubs32[0])));
+	for (size_t i = 0; i < bitnessCount; i++)
+	{
+		parseHex(bitnessStubs[i], bytes);
+		stubs.push_back(bytes);
+	}
+
+	std::vector<uint8_t> sizes(config.functions);
+	std::vector<int> stubIndexes(config.functions, -1);
+	uint64_t textSize = 0;
+	for (uint32_t i = 0; i < config.functions; i++)
+	{
+		if (((double) rng() / (double) rng.max()) < config.stubRatio)
+		{
+			stubIndexes[i] = (int) random((uint32_t) stubs.size());
+			sizes[i] = (uint8_t) stubs[stubIndexes[i]].size();
+			m_stubCount++;
+		}
+		else
+			sizes[i] = (uint8_t) (2 + random(MAX_STUB_BYTES - 1));
+		textSize += sizes[i];
+	}
+
+	SEGDATA &text = addSegment(".text", DBSEG_CODE, std::max(textSize, (uint64_t) 1));
+	m_functions.reserve(config.functions);
+	uint64_t offset = 0;
+	for (uint32_t i = 0; i < config.functions; i++)
+	{
+		uint8_t *p = &text.bytes[(size_t) offset];
+		if (stubIndexes[i] >= 0)
+			memcpy(p, stubs[stubIndexes[i]].data(), sizes[i]);
+		else
+		{
+			// A frame push first keeps the random bodies from matching a stub
+			p[0] = 0x55;
+			for (uint32_t j = 1; j < sizes[i]; j++)
+				p[j] = (uint8_t) rng();
+		}
+
+		for (uint32_t j = 0; j < sizes[i]; j++)
+			text.flags[(size_t) (offset + j)] = (DBF_IVL | DBF_CODE | p[j]);
+		text.flags[(size_t) offset] |= DBF_REF;
+
+		DBFUNCTION f = { (text.seg.startEa + offset), (text.seg.startEa + offset + sizes[i]), 0 };
+		m_functions.push_back(f);
+		offset += sizes[i];
+	}
+
+	// Zero table, with the only non-zero bytes at the very end
+	SEGDATA &zero = addSegment(".zero", DBSEG_DATA, std::max(config.zeroBytes, (uint64_t) 16));
+	for (size_t i = 0; i < zero.flags.size(); i++)
+		zero.flags[i] = DBF_IVL;
+	for (size_t i = (zero.flags.size() - 8); i < zero.flags.size(); i++)
+	{
+		zero.bytes[i] = 0xCC;
+		zero.flags[i] |= 0xCC;
+	}
+
+	// Half zero random data with sparse labels, and dense xrefs
+	uint32_t ptrSize = (config.is64 ? 8 : 4);
+	SEGDATA &data = addSegment(".data", DBSEG_DATA, std::max(config.dataBytes, (uint64_t) ptrSize));
+	uint32_t labelSpacing = std::max(((config.labelSpacing + (ptrSize - 1)) & ~(ptrSize - 1)), ptrSize);
+	for (size_t i = 0; i < data.flags.size(); i++)
+	{
+		data.bytes[i] = (uint8_t) (random(2) ? rng() : 0);
+		data.flags[i] = (DBF_IVL | data.bytes[i]);
+		if ((i % labelSpacing) == 0)
+			data.flags[i] |= (DBF_LABL | DBF_REF);
+	}
+
+	SEGDATA &rdata = addSegment(".rdata", DBSEG_DATA, std::max(config.rdataBytes, (uint64_t) 1));
+	uint32_t xrefSpacing = std::max(config.xrefSpacing, 1u);
+	size_t nextRef = 0;
+	for (size_t i = 0; i < rdata.flags.size(); i++)
+	{
+		rdata.bytes[i] = (uint8_t) rng();
+		rdata.flags[i] = (DBF_IVL | rdata.bytes[i]);
+		if (i == nextRef)
+		{
+			rdata.flags[i] |= (DBF_REF | DBF_DATA);
+			nextRef += (1 + random(xrefSpacing * 2));
+		}
+	}
+
+	addSegment(".bss", DBSEG_BSS, std::max(config.bssBytes, (uint64_t) 1));
+}
+
+// ======================================================================================
+
+ptrdiff_t SyntheticDatabase::FindSegment(const char *name) const
+{
+	for (size_t i = 0; i < m_segments.size(); i++)
+	{
+		if (strcmp(m_segments[i].seg.name, name) == 0)
+			return (ptrdiff_t) i;
+	}
+	return -1;
+}
+
+const SyntheticDatabase::SEGDATA *SyntheticDatabase::findData(EA ea) const
+{
+	auto it = std::upper_bound(m_segments.begin(), m_segments.end(), ea, [](EA v, const SEGDATA &s) { return(v < s.seg.endEa); });
+	if ((it == m_segments.end()) || (ea < it->seg.startEa))
+		return NULL;
+	return &*it;
+}
+
+uint32_t SyntheticDatabase::Flags(EA ea) const
+{
+	const SEGDATA *sd = findData(ea);
+	return(sd ? sd->flags[(size_t) (ea - sd->seg.startEa)] : 0);
+}
+
+EA SyntheticDatabase::NextThat(EA ea, EA endEa, FLAGTEST test) const
+{
+	for (const SEGDATA &sd : m_segments)
+	{
+		if ((sd.seg.endEa <= (ea + 1)) || (ea == BAD_EA))
+			continue;
+		if (sd.seg.startEa >= endEa)
+			break;
+
+		EA start = std::max((ea + 1), sd.seg.startEa), stop = std::min(endEa, sd.seg.endEa);
+		for (EA a = start; a < stop; a++)
+		{
+			if (test(sd.flags[(size_t) (a - sd.seg.startEa)]))
+				return a;
+		}
+	}
+	return BAD_EA;
+}
+
+EA SyntheticDatabase::PrevThat(EA ea, EA startEa, FLAGTEST test) const
+{
+	for (auto it = m_segments.rbegin(); it != m_segments.rend(); ++it)
+	{
+		const SEGDATA &sd = *it;
+		if (sd.seg.startEa >= ea)
+			continue;
+		if (sd.seg.endEa <= startEa)
+			break;
+
+		EA start = std::max(startEa, sd.seg.startEa), stop = std::min(ea, sd.seg.endEa);
+		for (EA a = stop; a > start; a--)
+		{
+			if (test(sd.flags[(size_t) ((a - 1) - sd.seg.startEa)]))
+				return(a - 1);
+		}
+	}
+	return BAD_EA;
+}
+
+EA SyntheticDatabase::NextInited(EA ea, EA endEa) const
+{
+	for (const SEGDATA &sd : m_segments)
+	{
+		if ((sd.seg.endEa <= (ea + 1)) || (ea == BAD_EA) || !sd.inited)
+			continue;
+		if (sd.seg.startEa >= endEa)
+			break;
+		return std::max((ea + 1), sd.seg.startEa);
+	}
+	return BAD_EA;
+}
+
+EA SyntheticDatabase::PrevInited(EA ea, EA startEa) const
+{
+	for (auto it = m_segments.rbegin(); it != m_segments.rend(); ++it)
+	{
+		const SEGDATA &sd = *it;
+		if ((sd.seg.startEa >= ea) || !sd.inited)
+			continue;
+		if (sd.seg.endEa <= startEa)
+			break;
+		return(std::min(ea, sd.seg.endEa) - 1);
+	}
+	return BAD_EA;
+}
+
+const uint8_t *SyntheticDatabase::ReadBytes(EA ea, size_t size, bool forward, size_t &inited) const
+{
+	// Segments are either all initialized or not at all
+	inited = 0;
+	const SEGDATA *sd = findData(ea);
+	if (!sd || (size > SCAN_CHUNK_SIZE) || ((sd->seg.endEa - ea) < size))
+		return NULL;
+	if (sd->inited)
+		inited = size;
+	return &sd->bytes[(size_t) (ea - sd->seg.startEa)];
+}
+
+bool SyntheticDatabase::GetName(EA ea, std::string &name) const
+{
+	uint32_t flags = Flags(ea);
+	if (!(flags & (DBF_NAME | DBF_LABL)))
+		return false;
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "loc_%llX", (unsigned long long) ea);
+	name = buffer;
+	return true;
+}
@@ -0,0 +1,71 @@
+// Generated in memory database for the benchmarks.
+// Segments of configurable size for the worst and typical cases of each command:
+//   ".text"  Tiny functions back to back, a share of them stubs the built-in patterns match
+//   ".zero"  A huge zero table with a single non-zero QWORD at the end, the NotZ worst case
+//   ".data"  Random data with a label every 'labelSpacing' bytes, sparse anchors and long fill runs
+//   ".rdata" Random data with an xref every 'xrefSpacing' bytes or so, dense anchors
+//   ".bss"   Uninitialized
+#pragma once
+#include "Database.h"
+#include <vector>
+
+struct SYNTHCONFIG
+{
+	bool is64;
+	uint32_t functions;    // Function count
+	double stubRatio;      // Share of the functions that are stubs, 0.0 to 1.0
+	uint64_t zeroBytes;    // ".zero" size
+	uint64_t dataBytes;    // ".data" size
+	uint32_t labelSpacing; // Bytes between ".data" labels, pointer aligned
+	uint64_t rdataBytes;   // ".rdata" size
+	uint32_t xrefSpacing;  // Average bytes between ".rdata" xrefs
+	uint64_t bssBytes;     // ".bss" size
+	uint32_t seed;
+};
+
+// Defaults, about 200MB of flags
+SYNTHCONFIG DefaultSynthConfig();
+
+class SyntheticDatabase : public IDatabase
+{
+public:
+	explicit SyntheticDatabase(const SYNTHCONFIG &config);
+
+	const SYNTHCONFIG &Config() const { return m_config; }
+	// Count of the generated functions that are stubs
+	uint32_t StubCount() const { return m_stubCount; }
+	// Find a segment by name, returns its index or -1
+	ptrdiff_t FindSegment(const char *name) const;
+
+	virtual bool Is64() const { return m_config.is64; }
+	virtual EA MinEa() const { return m_segments.front().seg.startEa; }
+	virtual EA MaxEa() const { return m_segments.back().seg.endEa; }
+	virtual size_t SegmentCount() const { return m_segments.size(); }
+	virtual DBSEGMENT Segment(size_t index) const { return m_segments[index].seg; }
+	virtual uint32_t Flags(EA ea) const;
+	virtual EA NextThat(EA ea, EA endEa, FLAGTEST test) const;
+	virtual EA PrevThat(EA ea, EA startEa, FLAGTEST test) const;
+	virtual EA NextInited(EA ea, EA endEa) const;
+	virtual EA PrevInited(EA ea, EA startEa) const;
+	virtual const uint8_t *ReadBytes(EA ea, size_t size, bool forward, size_t &inited) const;
+	virtual size_t FunctionCount() const { return m_functions.size(); }
+	virtual DBFUNCTION Function(size_t index) const { return m_functions[index]; }
+	virtual bool GetName(EA ea, std::string &name) const;
+
+private:
+	struct SEGDATA
+	{
+		DBSEGMENT seg;
+		std::vector<uint32_t> flags;
+		std::vector<uint8_t> bytes;
+		bool inited;
+	};
+
+	SEGDATA &addSegment(const char *name, uint32_t type, uint64_t size);
+	const SEGDATA *findData(EA ea) const;
+
+	SYNTHCONFIG m_config;
+	std::vector<SEGDATA> m_segments;
+	std::vector<DBFUNCTION> m_functions;
+	uint32_t m_stubCount;
+};
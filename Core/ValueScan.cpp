@@ -0,0 +1,386 @@
+// Typed value search.
+// The SIMD loops test 64 bytes (AVX2 128) per step and only locate the value in a block with a hit.
+// Unsigned compares are signed ones with the sign bits flipped; SSE2 has no 64bit compare, so QWORDs need AVX2.
+#include "ValueScan.h"
+#include "ZeroScan.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef CORE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+static bool isInitedFlags(uint32_t flags) { return((flags & DBF_IVL) != 0); }
+
+static inline uint64_t widthMask(uint32_t width) { return((width == sizeof(uint32_t)) ? 0xFFFFFFFFull : ~0ull); }
+
+VALUEQUERY ValueEqualQuery(uint32_t width, uint64_t value)
+{
+	return ValueMaskQuery(width, value, ~0ull);
+}
+
+VALUEQUERY ValueRangeQuery(uint32_t width, uint64_t low, uint64_t high)
+{
+	uint64_t all = widthMask(width);
+	low &= all;
+	high &= all;
+	if (low > high)
+		std::swap(low, high);
+	VALUEQUERY query = { width, all, low, (high - low) };
+	return query;
+}
+
+VALUEQUERY ValueMaskQuery(uint32_t width, uint64_t value, uint64_t mask)
+{
+	mask &= widthMask(width);
+	VALUEQUERY query = { width, mask, (value & mask), 0 };
+	return query;
+}
+
+// Parse a hex value, with or without "0x", the rest of the string has to be empty
+static bool parseHex(const std::string &text, uint64_t &value)
+{
+	size_t start = text.find_first_not_of(" \t");
+	size_t end = text.find_last_not_of(" \t");
+	if (start == std::string::npos)
+		return false;
+	std::string digits = text.substr(start, (end - start + 1));
+	if ((digits.size() > 2) && (digits[0] == '0') && ((digits[1] == 'x') || (digits[1] == 'X')))
+		digits.erase(0, 2);
+	if (digits.empty() || (digits.size() > 16) || (digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos))
+		return false;
+	value = strtoull(digits.c_str(), NULL, 16);
+	return true;
+}
+
+bool ParseValueQuery(const IDatabase &db, const char *text, VALUEQUERY &query, std::string &error)
+{
+	std::string s(text);
+	s.erase(0, s.find_first_not_of(" \t"));
+
+	// Width prefix
+	uint32_t width = (db.Is64() ? sizeof(uint64_t) : sizeof(uint32_t));
+	if ((s.size() > 1) && ((s[1] == ' ') || (s[1] == '\t')) && ((s[0] == 'd') || (s[0] == 'D') || (s[0] == 'q') || (s[0] == 'Q')))
+	{
+		width = (((s[0] == 'd') || (s[0] == 'D')) ? sizeof(uint32_t) : sizeof(uint64_t));
+		s.erase(0, 2);
+		s.erase(0, s.find_first_not_of(" \t"));
+	}
+	s.erase(s.find_last_not_of(" \t") + 1);
+	if (s.empty())
+	{
+		error = "No value";
+		return false;
+	}
+
+	// A segment name, any pointer into it
+	for (size_t i = 0; i < db.SegmentCount(); i++)
+	{
+		DBSEGMENT seg = db.Segment(i);
+		if ((s == seg.name) && (seg.endEa > seg.startEa))
+		{
+			query = ValueRangeQuery(width, seg.startEa, (seg.endEa - 1));
+			return true;
+		}
+	}
+
+	uint64_t a, b;
+	size_t split;
+	if ((split = s.find("..")) != std::string::npos)
+	{
+		if (parseHex(s.substr(0, split), a) && parseHex(s.substr(split + 2), b))
+		{
+			query = ValueRangeQuery(width, a, b);
+			return true;
+		}
+	}
+	else
+	if ((split = s.find('&')) != std::string::npos)
+	{
+		if (parseHex(s.substr(0, split), a) && parseHex(s.substr(split + 1), b))
+		{
+			query = ValueMaskQuery(width, a, b);
+			return true;
+		}
+	}
+	else
+	if (parseHex(s, a))
+	{
+		query = ValueEqualQuery(width, a);
+		return true;
+	}
+
+	error = "\"" + s + "\" isn't a hex value, \"<low>..<high>\" range, \"<value>&<mask>\" or a segment name";
+	return false;
+}
+
+// ======================================================================================
+
+template <typename T> static size_t findFirstScalar(const uint8_t *buffer, size_t size, const VALUEQUERY &query)
+{
+	size_t end = (size - (size % sizeof(T)));
+	for (size_t i = 0; i < end; i += sizeof(T))
+	{
+		T v;
+		memcpy(&v, (buffer + i), sizeof(v));
+		if (ValueMatches(query, v))
+			return i;
+	}
+	return size;
+}
+
+template <typename T> static size_t findLastScalar(const uint8_t *buffer, size_t size, const VALUEQUERY &query)
+{
+	for (size_t i = (size - (size % sizeof(T))); i >= sizeof(T); i -= sizeof(T))
+	{
+		T v;
+		memcpy(&v, (buffer + i - sizeof(T)), sizeof(v));
+		if (ValueMatches(query, v))
+			return(i - sizeof(T));
+	}
+	return size;
+}
+
+#ifdef CORE_X86
+// Bitmap of the matching DWORDs in a 64 byte block, a bit per DWORD
+struct DWORDTEST_SSE2
+{
+	__m128i mask, low, span, bias;
+
+	explicit DWORDTEST_SSE2(const VALUEQUERY &query)
+	{
+		mask = _mm_set1_epi32((int) (uint32_t) query.mask);
+		low = _mm_set1_epi32((int) (uint32_t) query.low);
+		bias = _mm_set1_epi32((int) 0x80000000);
+		span = _mm_xor_si128(_mm_set1_epi32((int) (uint32_t) query.span), bias);
+	}
+
+	// Not greater than the span, as signed with the bias
+	inline uint32_t test16(const uint8_t *p) const
+	{
+		__m128i v = _mm_xor_si128(_mm_sub_epi32(_mm_and_si128(_mm_loadu_si128((const __m128i*) p), mask), low), bias);
+		return(~(uint32_t) _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, span))) & 0xF);
+	}
+
+	inline uint32_t test64(const uint8_t *p) const
+	{
+		return(test16(p) | (test16(p + 16) << 4) | (test16(p + 32) << 8) | (test16(p + 48) << 12));
+	}
+};
+
+static size_t findFirstDwordSSE2(const uint8_t *buffer, size_t size, const VALUEQUERY &query)
+{
+	DWORDTEST_SSE2 test(query);
+	size_t i = 0;
+	for (; (i + 64) <= size; i += 64)
+	{
+		if (uint32_t hits = test.test64(buffer + i))
+			return(i + (LowestBit32(hits) * sizeof(uint32_t)));
+	}
+	size_t tail = findFirstScalar<uint32_t>((buffer + i), (size - i), query);
+	return((tail < (size - i)) ? (i + tail) : size);
+}
+
+static size_t findLastDwordSSE2(const uint8_t *buffer, size_t size, const VALUEQUERY &query)
+{
+	DWORDTEST_SSE2 test(query);
+	size_t i = (size - (size % sizeof(uint32_t)));
+	for (; i >= 64; i -= 64)
+	{
+		if (uint32_t hits = test.test64(buffer + i - 64))
+			return((i - 64) + (HighestBit32(hits) * sizeof(uint32_t)));
+	}
+	size_t last = findLastScalar<uint32_t>(buffer, i, query);
+	return((last < i) ? last : size);
+}
+
+// AVX2 tests of 128 byte blocks
+struct VALUETEST_AVX2
+{
+	__m256i mask, low, span, bias;
+};
+
+AVX2_TARGET static inline VALUETEST_AVX2 avx2Test(const VALUEQUERY &query)
+{
+	VALUETEST_AVX2 test;
+	if (query.width == sizeof(uint32_t))
+	{
+		test.mask = _mm256_set1_epi32((int) (uint32_t) query.mask);
+		test.low = _mm256_set1_epi32((int) (uint32_t) query.low);
+		test.bias = _mm256_set1_epi32((int) 0x80000000);
+		test.span = _mm256_xor_si256(_mm256_set1_epi32((int) (uint32_t) query.span), test.bias);
+	}
+	else
+	{
+		test.mask = _mm256_set1_epi64x((long long) query.mask);
+		test.low = _mm256_set1_epi64x((long long) query.low);
+		test.bias = _mm256_set1_epi64x((long long) 0x8000000000000000ull);
+		test.span = _mm256_xor_si256(_mm256_set1_epi64x((long long) query.span), test.bias);
+	}
+	return test;
+}
+
+// Bitmap of the matching DWORDs of 32 bytes, 8 bits
+AVX2_TARGET static inline uint32_t testDwords32(const VALUETEST_AVX2 &t, const uint8_t *p)
+{
+	__m256i v = _mm256_xor_si256(_mm256_sub_epi32(_mm256_and_si256(_mm256_loadu_si256((const __m256i*) p), t.mask), t.low), t.bias);
+	return(~(uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, t.span))) & 0xFF);
+}
+
+// Bitmap of the matching QWORDs of 32 bytes, 4 bits
+AVX2_TARGET static inline uint32_t testQwords32(const VALUETEST_AVX2 &t, const uint8_t *p)
+{
+	__m256i v = _mm256_xor_si256(_mm256_sub_epi64(_mm256_and_si256(_mm256_loadu_si256((const __m256i*) p), t.mask), t.low), t.bias);
+	return(~(uint32_t) _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(v, t.span))) & 0xF);
+}
+
+// Bitmap of the matching values of a 128 byte block, a bit per value
+AVX2_TARGET static inline uint32_t testBlock128(const VALUETEST_AVX2 &t, const uint8_t *p, bool qwords)
+{
+	if (qwords)
+		return(testQwords32(t, p) | (testQwords32(t, p + 32) << 4) | (testQwords32(t, p + 64) << 8) | (testQwords32(t, p + 96) << 12));
+	return(testDwords32(t, p) | (testDwords32(t, p + 32) << 8) | (testDwords32(t, p + 64) << 16) | (testDwords32(t, p + 96) << 24));
+}
+
+AVX2_TARGET static size_t findFirstAVX2(const uint8_t *buffer, size_t size, const VALUEQUERY &query)
+{
+	VALUETEST_AVX2 test = avx2Test(query);
+	bool qwords = (query.width == sizeof(uint64_t));
+	size_t i = 0;
+	for (; (i + 128) <= size; i += 128)
+	{
+		if (uint32_t hits = testBlock128(test, (buffer + i), qwords))
+			return(i + (LowestBit32(hits) * query.width));
+	}
+	size_t tail = (qwords ? findFirstScalar<uint64_t>((buffer + i), (size - i), query) : findFirstScalar<uint32_t>((buffer + i), (size - i), query));
+	return((tail < (size - i)) ? (i + tail) : size);
+}
+
+AVX2_TARGET static size_t findLastAVX2(const uint8_t *buffer, size_t size, const VALUEQUERY &query)
+{
+	VALUETEST_AVX2 test = avx2Test(query);
+	bool qwords = (query.width == sizeof(uint64_t));
+	size_t i = (size - (size % query.width));
+	for (; i >= 128; i -= 128)
+	{
+		if (uint32_t hits = testBlock128(test, (buffer + i - 128), qwords))
+			return((i - 128) + (HighestBit32(hits) * query.width));
+	}
+	size_t last = (qwords ? findLastScalar<uint64_t>(buffer, i, query) : findLastScalar<uint32_t>(buffer, i, query));
+	return((last < i) ? last : size);
+}
+#endif // CORE_X86
+
+// ======================================================================================
+
+typedef size_t (*VALUEFUNC)(const uint8_t *buffer, size_t size, const VALUEQUERY &query);
+struct VALUEFUNCS
+{
+	VALUEFUNC findFirst[2]; // DWORD, QWORD
+	VALUEFUNC findLast[2];
+	const char *isa[2];
+};
+
+static VALUEFUNCS selectValueFuncs()
+{
+#ifdef CORE_X86
+	if (HasAVX2())
+		return { { findFirstAVX2, findFirstAVX2 }, { findLastAVX2, findLastAVX2 }, { "AVX2", "AVX2" } };
+	return { { findFirstDwordSSE2, findFirstScalar<uint64_t> }, { findLastDwordSSE2, findLastScalar<uint64_t> }, { "SSE2", "scalar" } };
+#else
+	return { { findFirstScalar<uint32_t>, findFirstScalar<uint64_t> }, { findLastScalar<uint32_t>, findLastScalar<uint64_t> }, { "scalar", "scalar" } };
+#endif
+}
+
+static const VALUEFUNCS &valueFuncs()
+{
+	static const VALUEFUNCS funcs = selectValueFuncs();
+	return funcs;
+}
+
+size_t FindFirstValue(const uint8_t *buffer, size_t size, const VALUEQUERY &query) { return valueFuncs().findFirst[query.width == sizeof(uint64_t)](buffer, size, query); }
+size_t FindLastValue(const uint8_t *buffer, size_t size, const VALUEQUERY &query) { return valueFuncs().findLast[query.width == sizeof(uint64_t)](buffer, size, query); }
+const char *ValueScanISA(uint32_t width) { return valueFuncs().isa[width == sizeof(uint64_t)]; }
+
+// ======================================================================================
+
+EA ScanNextValue(const IDatabase &db, EA startEa, EA endEa, const VALUEQUERY &query)
+{
+	EA align = (EA) query.width;
+	for (EA ea = startEa; ea < endEa;)
+	{
+		ea = ((ea + (align - 1)) & ~(align - 1));
+		if ((ea + align) > endEa)
+			break;
+		if (!isInitedFlags(db.Flags(ea)))
+		{
+			ea = db.NextInited(ea, endEa);
+			if (ea == BAD_EA)
+				break;
+			continue;
+		}
+
+		size_t size = (size_t) std::min((EA) SCAN_CHUNK_SIZE, (endEa - ea));
+		size_t inited;
+		const uint8_t *bytes = db.ReadBytes(ea, size, true, inited);
+		if (inited == 0)
+		{
+			ea = db.NextInited(ea, endEa);
+			if (ea == BAD_EA)
+				break;
+			continue;
+		}
+
+		// A value cut by the end of the initialized bytes isn't one
+		size_t offset = FindFirstValue(bytes, inited, query);
+		if (offset < inited)
+			return(ea + offset);
+		ea += inited;
+	}
+	return BAD_EA;
+}
+
+EA ScanPrevValue(const IDatabase &db, EA startEa, EA endEa, const VALUEQUERY &query)
+{
+	EA align = (EA) query.width;
+	startEa = ((startEa + (align - 1)) & ~(align - 1));
+	for (EA ea = endEa; ea > startEa;)
+	{
+		ea &= ~(align - 1);
+		if (ea < (startEa + align))
+			break;
+		if (!isInitedFlags(db.Flags(ea - 1)))
+		{
+			EA prev = db.PrevInited((ea - 1), startEa);
+			if (prev == BAD_EA)
+				break;
+			ea = (prev + 1);
+			continue;
+		}
+
+		size_t size = (size_t) std::min((EA) SCAN_CHUNK_SIZE, (ea - startEa));
+		EA chunkEa = (ea - size);
+		size_t inited;
+		const uint8_t *bytes = db.ReadBytes(chunkEa, size, false, inited);
+		size_t values = (inited / align);
+		if (values == 0)
+		{
+			// Past the uninitialized byte below the value
+			ea -= std::max((EA) inited, align);
+			continue;
+		}
+
+		size_t skip = (size - (values * align));
+		size_t offset = FindLastValue(bytes + skip, (values * align), query);
+		if (offset < (values * align))
+			return(chunkEa + skip + offset);
+		ea -= (values * align);
+	}
+	return BAD_EA;
+}
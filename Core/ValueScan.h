@@ -0,0 +1,38 @@
+// Typed value search, the aligned DWORDs or QWORDs that equal a value, fall in a range or match a mask.
+// All three are one test, ((v & mask) - low) <= span unsigned, so one SIMD compare loop does them all.
+#pragma once
+#include "Database.h"
+#include <string>
+
+struct VALUEQUERY
+{
+	uint32_t width; // 4 or 8 bytes
+	uint64_t mask;
+	uint64_t low;
+	uint64_t span;  // High bound - low
+};
+
+// Queries for a width: equal to 'value', in [low, high], or (v & mask) == value
+VALUEQUERY ValueEqualQuery(uint32_t width, uint64_t value);
+VALUEQUERY ValueRangeQuery(uint32_t width, uint64_t low, uint64_t high);
+VALUEQUERY ValueMaskQuery(uint32_t width, uint64_t value, uint64_t mask);
+
+// Parse the query text, "[d|q] <value> | <low>..<high> | <value>&<mask> | <segment name>", hex values.
+// The width defaults to the pointer size, a segment name is any pointer into it. Returns false with a reason on failure.
+bool ParseValueQuery(const IDatabase &db, const char *text, VALUEQUERY &query, std::string &error);
+
+// Return true if the value matches
+static inline bool ValueMatches(const VALUEQUERY &query, uint64_t value) { return(((value & query.mask) - query.low) <= query.span); }
+
+// Return the offset of the first/last matching value in the buffer, or 'size' if none.
+// The buffer starts at a width aligned address, the bytes past the last whole value are ignored.
+size_t FindFirstValue(const uint8_t *buffer, size_t size, const VALUEQUERY &query);
+size_t FindLastValue(const uint8_t *buffer, size_t size, const VALUEQUERY &query);
+
+// Return the address of the first/last matching aligned value inside [startEa, endEa), or BAD_EA if none.
+// The range has to be inside a segment. Uninitialized spans are skipped whole.
+EA ScanNextValue(const IDatabase &db, EA startEa, EA endEa, const VALUEQUERY &query);
+EA ScanPrevValue(const IDatabase &db, EA startEa, EA endEa, const VALUEQUERY &query);
+
+// Name of the instruction set in use for a width, for benchmark output
+const char *ValueScanISA(uint32_t width);
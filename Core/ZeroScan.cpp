@@ -0,0 +1,215 @@
+// SIMD zero/non-zero byte search.
+// Bulk scans OR 64 or 128 bytes together per test, and only locate the exact byte in a block with a hit.
+#include "ZeroScan.h"
+#include <string.h>
+
+#ifdef CORE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define AVX2_TARGET
+#else
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+static size_t findFirstScalar(const uint8_t *buffer, size_t size)
+{
+	size_t i = 0;
+	for (; (i + sizeof(uint64_t)) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t v;
+		memcpy(&v, (buffer + i), sizeof(v));
+		if (v)
+			return(i + (LowestBit64(v) >> 3));
+	}
+	for (; i < size; i++)
+	{
+		if (buffer[i])
+			return i;
+	}
+	return size;
+}
+
+static size_t findLastScalar(const uint8_t *buffer, size_t size)
+{
+	size_t i = size;
+	for (; i >= sizeof(uint64_t); i -= sizeof(uint64_t))
+	{
+		uint64_t v;
+		memcpy(&v, (buffer + i - sizeof(uint64_t)), sizeof(v));
+		if (v)
+			return((i - sizeof(uint64_t)) + (HighestBit64(v) >> 3));
+	}
+	while (i--)
+	{
+		if (buffer[i])
+			return i;
+	}
+	return size;
+}
+
+#ifdef CORE_X86
+// Bitmap of the non-zero bytes in a 16 byte block
+static inline uint32_t nonZeroMask16(const uint8_t *p)
+{
+	return(~(uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) p), _mm_setzero_si128())) & 0xFFFF);
+}
+
+static size_t findFirstSSE2(const uint8_t *buffer, size_t size)
+{
+	size_t i = 0;
+	for (; (i + 64) <= size; i += 64)
+	{
+		const __m128i *p = (const __m128i*) (buffer + i);
+		__m128i v = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)), _mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF)
+		{
+			for (size_t j = 0; j < 64; j += 16)
+			{
+				if (uint32_t mask = nonZeroMask16(buffer + i + j))
+					return(i + j + LowestBit32(mask));
+			}
+		}
+	}
+	size_t tail = findFirstScalar(buffer + i, size - i);
+	return(i + tail);
+}
+
+static size_t findLastSSE2(const uint8_t *buffer, size_t size)
+{
+	size_t i = size;
+	for (; i >= 64; i -= 64)
+	{
+		const __m128i *p = (const __m128i*) (buffer + i - 64);
+		__m128i v = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(p), _mm_loadu_si128(p + 1)), _mm_or_si128(_mm_loadu_si128(p + 2), _mm_loadu_si128(p + 3)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())) != 0xFFFF)
+		{
+			for (size_t j = 16; j <= 64; j += 16)
+			{
+				if (uint32_t mask = nonZeroMask16(buffer + i - j))
+					return((i - j) + HighestBit32(mask));
+			}
+		}
+	}
+	size_t last = findLastScalar(buffer, i);
+	return((last != i) ? last : size);
+}
+
+// Bitmap of the non-zero bytes in a 32 byte block
+AVX2_TARGET static inline uint32_t nonZeroMask32(const uint8_t *p)
+{
+	return ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) p), _mm256_setzero_si256()));
+}
+
+AVX2_TARGET static size_t findFirstAVX2(const uint8_t *buffer, size_t size)
+{
+	size_t i = 0;
+	for (; (i + 128) <= size; i += 128)
+	{
+		const __m256i *p = (const __m256i*) (buffer + i);
+		__m256i v = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1)), _mm256_or_si256(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3)));
+		if (!_mm256_testz_si256(v, v))
+		{
+			for (size_t j = 0; j < 128; j += 32)
+			{
+				if (uint32_t mask = nonZeroMask32(buffer + i + j))
+					return(i + j + LowestBit32(mask));
+			}
+		}
+	}
+	return(i + findFirstSSE2(buffer + i, size - i));
+}
+
+AVX2_TARGET static size_t findLastAVX2(const uint8_t *buffer, size_t size)
+{
+	size_t i = size;
+	for (; i >= 128; i -= 128)
+	{
+		const __m256i *p = (const __m256i*) (buffer + i - 128);
+		__m256i v = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256(p), _mm256_loadu_si256(p + 1)), _mm256_or_si256(_mm256_loadu_si256(p + 2), _mm256_loadu_si256(p + 3)));
+		if (!_mm256_testz_si256(v, v))
+		{
+			for (size_t j = 32; j <= 128; j += 32)
+			{
+				if (uint32_t mask = nonZeroMask32(buffer + i - j))
+					return((i - j) + HighestBit32(mask));
+			}
+		}
+	}
+	size_t last = findLastSSE2(buffer, i);
+	return((last != i) ? last : size);
+}
+
+bool HasAVX2()
+{
+#ifdef _MSC_VER
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return false;
+
+	// OSXSAVE and AVX, then the OS has to be saving the YMM state
+	__cpuid(regs, 1);
+	if ((regs[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return false;
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(regs, 7, 0);
+	return((regs[1] & (1 << 5)) != 0);
+#else
+	__builtin_cpu_init();
+	return(__builtin_cpu_supports("avx2") != 0);
+#endif
+}
+#endif // CORE_X86
+
+// ======================================================================================
+
+typedef size_t (*SCANFUNC)(const uint8_t *buffer, size_t size);
+struct SCANFUNCS
+{
+	SCANFUNC findFirst;
+	SCANFUNC findLast;
+	const char *isa;
+};
+
+static SCANFUNCS selectScanFuncs()
+{
+#ifdef CORE_X86
+	// x64 always has SSE2
+	if (HasAVX2())
+		return { findFirstAVX2, findLastAVX2, "AVX2" };
+	return { findFirstSSE2, findLastSSE2, "SSE2" };
+#else
+	return { findFirstScalar, findLastScalar, "scalar" };
+#endif
+}
+
+static const SCANFUNCS &scanFuncs()
+{
+	static const SCANFUNCS funcs = selectScanFuncs();
+	return funcs;
+}
+
+size_t FindFirstNonZero(const uint8_t *buffer, size_t size) { return scanFuncs().findFirst(buffer, size); }
+size_t FindLastNonZero(const uint8_t *buffer, size_t size) { return scanFuncs().findLast(buffer, size); }
+const char *ZeroScanISA() { return scanFuncs().isa; }
+
+size_t FindFirstZero(const uint8_t *buffer, size_t size)
+{
+	size_t i = 0;
+#ifdef CORE_X86
+	for (; (i + 16) <= size; i += 16)
+	{
+		if (uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (buffer + i)), _mm_setzero_si128())))
+			return(i + LowestBit32(mask));
+	}
+#endif
+	for (; i < size; i++)
+	{
+		if (!buffer[i])
+			return i;
+	}
+	return size;
+}
@@ -0,0 +1,17 @@
+// SIMD zero/non-zero byte search, SSE2 or AVX2 picked at runtime with a scalar fallback
+#pragma once
+#include "CoreTypes.h"
+
+// Return the offset of the first/last non-zero byte in the buffer, or 'size' if it's all zeros
+size_t FindFirstNonZero(const uint8_t *buffer, size_t size);
+size_t FindLastNonZero(const uint8_t *buffer, size_t size);
+// Return the offset of the first zero byte in the buffer, or 'size' if there are none
+size_t FindFirstZero(const uint8_t *buffer, size_t size);
+
+// Name of the instruction set in use, for benchmark output
+const char *ZeroScanISA();
+
+#ifdef CORE_X86
+// Return true if both the CPU and the OS support AVX2, for the other SIMD scans' dispatch
+bool HasAVX2();
+#endif
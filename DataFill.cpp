@@ -0,0 +1,407 @@
+// Data fill commands
+// Fills a run of unformatted data with DWORDs or QWORDs as a single batch with one undo point,
+// or with an array of structs using the record stride detected from the data.
+// The auto-format pass does the same for every run in a segment, each formatted by its content.
+#include "StdAfx.h"
+#include "DataFill.h"
+#include "IdaDatabase.h"
+#include "Telemetry.h"
+#include "Core/Navigation.h"
+#include "Core/StructStride.h"
+#include "Core/AutoFormat.h"
+#include "RangeSnapshot.h"
+#include "ThreadPool.h"
+#include <WaitBoxEx.h>
+#include <undo.hpp>
+#include <algorithm>
+#include <vector>
+
+BOOL FindFillExtent(ea_t eaScreen, UINT32 align, ea_t &eaStart, ea_t &eaEnd)
+{
+    EA startEa, endEa;
+    FILLSTATUS status = FindFillBounds(LiveDatabase(), eaScreen, align, startEa, endEa);
+    eaStart = startEa;
+    eaEnd = endEa;
+    switch(status)
+    {
+        case FILL_CODE:
+        msg("Utility: ** Code here!, aborted. **\n");
+        break;
+
+        case FILL_UNALIGNED:
+        msg("Utility: ** Start address %014llX <click me> is not align %u, aborted. **\n", eaStart, align);
+        break;
+    };
+    return(status == FILL_OK);
+}
+
+// ======================================================================================
+
+BOOL FillDataRun(UINT32 elementSize)
+{
+    ea_t eaScreen = get_screen_ea();
+    if(eaScreen == BADADDR)
+        return FALSE;
+
+    ea_t eaStart, eaEnd;
+    if(!FindFillExtent(eaScreen, elementSize, eaStart, eaEnd))
+        return FALSE;
+
+    UINT32 count = (UINT32) ((eaEnd - eaStart) / elementSize);
+    LPCSTR typeName = ((elementSize == sizeof(UINT64)) ? "QWORD" : "DWORD");
+    msg("Utility: %s fill: %014llX to %014llX, count: %u\n", typeName, eaStart, eaEnd, count);
+
+    // One undo point for the whole run, and no auto-analysis churn in between elements
+    create_undo_point("Utility:Fill", "Fill data run");
+    bool autoEnabled = enable_auto(false);
+    TIMESTAMP startTime = GetTimeStamp();
+
+    // Skip elements that are already what we want, clear and create each stretch between them in one call each
+    flags64_t elementFlags = ((elementSize == sizeof(UINT64)) ? qword_flag() : dword_flag());
+    UINT32 created = 0, stretches = 0;
+    ea_t ea = eaStart, stretchStart = BADADDR;
+    for(UINT32 i = 0; i <= count; i++, ea += elementSize)
+    {
+        if(i < count)
+        {
+            flags64_t flags = get_flags(ea);
+            TELEMETRY_COUNT(TC_GET_FLAGS);
+            TELEMETRY_ADD(TC_ADDRESSES, elementSize);
+            if(!is_head(flags) || ((flags & DT_TYPE) != elementFlags) || (get_item_size(ea) != elementSize))
+            {
+                if(stretchStart == BADADDR)
+                    stretchStart = ea;
+                continue;
+            }
+        }
+
+        if(stretchStart != BADADDR)
+        {
+            asize_t length = (asize_t) (ea - stretchStart);
+            del_items(stretchStart, DELIT_SIMPLE, length);
+            create_data(stretchStart, elementFlags, length, BADNODE);
+            created += (UINT32) (length / elementSize);
+            stretches++;
+            stretchStart = BADADDR;
+        }
+    }
+
+    TIMESTAMP fillTime = (GetTimeStamp() - startTime);
+    enable_auto(autoEnabled);
+
+    char buffer[32];
+    msg(" Created %s", NumberCommaString(created, buffer));
+    if(fillTime > 0.0)
+        msg(" in %u stretches in %s, %.0f elements per second.\n", stretches, TimeString(fillTime), ((double) created / fillTime));
+    else
+        msg(" in %u stretches.\n", stretches);
+    return TRUE;
+}
+
+// ======================================================================================
+
+// Struct array fill, the stride detection is the core one ("Core/StructStride.h")
+
+static const size_t MAX_SAMPLE_SLOTS = 0x10000; // Enough to detect the stride, no need to read a whole huge table
+
+static LPCSTR slotName(BYTE slotClass)
+{
+    switch(slotClass)
+    {
+        case SLOT_ZERO:  return "zero";
+        case SLOT_PTR:   return "ptr";
+        case SLOT_SMALL: return "small";
+    };
+    return "dword";
+}
+
+BOOL FillStructArray()
+{
+    ea_t eaScreen = get_screen_ea();
+    if(eaScreen == BADADDR)
+        return FALSE;
+
+    UINT32 ptrSize = (plat.is64 ? sizeof(UINT64) : sizeof(UINT32));
+    ea_t eaStart, eaEnd;
+    if(!FindFillExtent(eaScreen, ptrSize, eaStart, eaEnd))
+        return FALSE;
+
+    TIMESTAMP startTime = GetTimeStamp();
+    size_t slotCount = std::min((size_t) ((eaEnd - eaStart) / sizeof(UINT32)), MAX_SAMPLE_SLOTS);
+    std::vector<BYTE> bytes(slotCount * sizeof(UINT32));
+    TELEMETRY_COUNT(TC_GET_BYTES);
+    TELEMETRY_ADD(TC_ADDRESSES, bytes.size());
+    if(get_bytes(bytes.data(), bytes.size(), eaStart, GMB_READALL) != (ssize_t) bytes.size())
+    {
+        msg("Utility: ** Failed to read %014llX, aborted. **\n", eaStart);
+        return FALSE;
+    }
+
+    std::vector<BYTE> classes;
+    ClassifySlots(bytes.data(), slotCount, inf_get_min_ea(), inf_get_max_ea(), (plat.is64 != FALSE), classes);
+    double score = 0.0;
+    UINT32 stride = DetectStride(classes, (plat.is64 != FALSE), score);
+    if(stride == 0)
+    {
+        msg("Utility: ** No record stride found from %014llX to %014llX, aborted. **\n", eaStart, eaEnd);
+        return FALSE;
+    }
+
+    UINT32 recordSize = (stride * sizeof(UINT32));
+    UINT32 count = (UINT32) ((eaEnd - eaStart) / recordSize);
+    if(count < 2)
+    {
+        msg("Utility: ** Run from %014llX to %014llX is too short for a %u byte record array, aborted. **\n", eaStart, eaEnd, recordSize);
+        return FALSE;
+    }
+
+    // Majority class per slot of the record
+    std::vector<BYTE> layout;
+    RecordLayout(classes, stride, (plat.is64 != FALSE), layout);
+
+    qstring layoutStr;
+    for(UINT32 j = 0; j < stride; j++)
+    {
+        if(layout[j] != SLOT_PTR_HIGH)
+            layoutStr.cat_sprnt("%s%s", (layoutStr.empty() ? "" : ", "), slotName(layout[j]));
+    }
+    msg("Utility: Struct fill: %014llX to %014llX, %u byte records {%s}, count: %u, score: %.2f, detected in %s.\n", eaStart, eaEnd, recordSize, layoutStr.c_str(), count, score, TimeString(GetTimeStamp() - startTime));
+
+    if(ask_yn(ASKBTN_YES, "HIDECANCEL\nCreate an array of %u, %u byte records {%s} at %llX?", count, recordSize, layoutStr.c_str(), eaStart) != ASKBTN_YES)
+        return FALSE;
+
+    // Build the struct type
+    udt_type_data_t udt;
+    for(UINT32 j = 0; j < stride; j++)
+    {
+        if(layout[j] == SLOT_PTR_HIGH)
+            continue;
+
+        udm_t udm;
+        UINT32 offset = (j * sizeof(UINT32));
+        BOOL isPtr = (layout[j] == SLOT_PTR);
+        UINT32 size = (isPtr ? ptrSize : sizeof(UINT32));
+        udm.name.sprnt("%s_%X", (isPtr ? "ptr" : "field"), offset);
+        udm.offset = (offset * 8);
+        udm.size = (size * 8);
+        if(isPtr)
+            udm.type.create_ptr(tinfo_t(BT_VOID));
+        else
+            udm.type = tinfo_t(BT_INT32 | BTMT_USIGNED);
+        udt.push_back(udm);
+    }
+    udt.total_size = recordSize;
+
+    // The undo point first so undo takes the type too. Replace any left from an earlier run at this address.
+    create_undo_point("Utility:StructFill", "Fill struct array");
+    qstring typeName;
+    typeName.sprnt("rec_%llX", eaStart);
+    tinfo_t tif;
+    if(!tif.create_udt(udt) || (tif.set_named_type(NULL, typeName.c_str(), (NTF_TYPE | NTF_REPLACE)) != TERR_OK))
+    {
+        msg("Utility: ** Failed to create struct type \"%s\", aborted. **\n", typeName.c_str());
+        return FALSE;
+    }
+
+    // Apply it as one struct array
+    asize_t length = ((asize_t) count * recordSize);
+    del_items(eaStart, DELIT_SIMPLE, length);
+    tinfo_t arrayTif;
+    arrayTif.create_array(tif, count);
+    if(!create_struct(eaStart, length, tif.force_tid()) || !apply_tinfo(eaStart, arrayTif, TINFO_DEFINITE))
+    {
+        msg("Utility: ** Failed to create struct array at %014llX. **\n", eaStart);
+        return FALSE;
+    }
+    msg(" Created \"%s[%u]\".\n", typeName.c_str(), count);
+    return TRUE;
+}
+
+// ======================================================================================
+
+static const size_t SURVEY_SAMPLE_SLOTS = 1024; // Smaller stride sample, the survey looks at every run
+
+void SurveyFillRuns(FILLSURVEY &survey)
+{
+    memset(&survey, 0, sizeof(survey));
+    TIMESTAMP startTime = GetTimeStamp();
+    FILLRUNCOUNTS counts;
+    CountFillRuns(LiveDatabase(), SURVEY_SAMPLE_SLOTS, counts);
+    survey.runs = (UINT32) counts.runs;
+    survey.bytes = counts.bytes;
+    survey.structRuns = (UINT32) counts.structRuns;
+    survey.time = (GetTimeStamp() - startTime);
+}
+
+// ======================================================================================
+
+// Auto-format pass, the run classification is the core one ("Core/AutoFormat.h").
+// The run bytes are read into a snapshot a batch at the time on the main thread, then its pieces are classified in parallel.
+
+// Format a classified run, one create call per run (per string for strings)
+static BOOL formatRun(const FILLRUN &run, RUNCLASS runClass)
+{
+    asize_t size = (asize_t) (run.endEa - run.startEa);
+    switch(runClass)
+    {
+        case RUN_ZEROS:
+        case RUN_DWORDS:
+        return create_data(run.startEa, dword_flag(), size, BADNODE);
+
+        case RUN_POINTERS:
+        return(create_data(run.startEa, (plat.is64 ? qword_flag() : dword_flag()), size, BADNODE) && op_plain_offset(run.startEa, 0, 0));
+
+        case RUN_STRINGS:
+        {
+            // Each string up to its terminator, the zero padding between and after them stays as is
+            ea_t ea = run.startEa;
+            for(;;)
+            {
+                while((ea < run.endEa) && !get_byte(ea))
+                    ea++;
+                if(ea >= run.endEa)
+                    break;
+                if(!create_strlit(ea, 0, STRTYPE_C))
+                    return FALSE;
+                ea = get_item_end(ea);
+            }
+            return TRUE;
+        }
+    };
+    return FALSE;
+}
+
+BOOL AutoFormatRuns(BOOL allSegments, BOOL dryRun)
+{
+    size_t segIndex = ALL_SEGMENTS;
+    if(!allSegments)
+    {
+        ea_t eaScreen = get_screen_ea();
+        int n = ((eaScreen != BADADDR) ? get_segm_num(eaScreen) : -1);
+        if(n < 0)
+        {
+            msg("Utility: ** Not in a segment, aborted. **\n");
+            return FALSE;
+        }
+        segIndex = (size_t) n;
+    }
+
+    // The runs, DWORD aligned and at least two long
+    TIMESTAMP startTime = GetTimeStamp();
+    std::vector<FILLRUN> runs;
+    CollectFillRuns(LiveDatabase(), segIndex, sizeof(UINT32), (sizeof(UINT32) * 2), runs);
+    TIMESTAMP collectTime = (GetTimeStamp() - startTime);
+    if(runs.empty())
+    {
+        msg("Utility: Auto-format, no unformatted runs found in %s.\n", (allSegments ? "the data segments" : "this segment"));
+        return FALSE;
+    }
+
+    // Per run merged piece counts
+    std::vector<RUNSTATS> runStats(runs.size());
+    std::vector<UINT32> runPieces(runs.size(), 0);
+    std::vector<BYTE> runInited(runs.size(), TRUE);
+
+    RangeSnapshot snapshot;
+    for(const FILLRUN &run : runs)
+        snapshot.Add(run.startEa, run.endEa);
+
+    WaitBox::show("Utility", "Classifying..");
+    std::vector<RUNSTATS> pieceStats;
+    EA minEa = inf_get_min_ea(), maxEa = inf_get_max_ea();
+    bool is64 = (plat.is64 != FALSE);
+    TIMESTAMP classifyTime = 0.0;
+    BOOL cancelled = FALSE;
+    while(!cancelled && snapshot.ReadBatch())
+    {
+        // Classify the pieces in parallel, no SDK calls in there
+        TIMESTAMP batchTime = GetTimeStamp();
+        const std::vector<SNAPSHOTPIECE> &pieces = snapshot.Pieces();
+        pieceStats.resize(pieces.size());
+        ParallelFor(pieces.size(), 1, [&](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; i++)
+            {
+                if(pieces[i].inited)
+                    GetRunStats(snapshot.Bytes(pieces[i]), pieces[i].size, minEa, maxEa, is64, pieceStats[i]);
+            }
+        });
+
+        // Merge each run's pieces, in order
+        for(size_t i = 0; i < pieces.size(); i++)
+        {
+            size_t run = pieces[i].range;
+            if(!pieces[i].inited)
+                runInited[run] = FALSE;
+            else
+            if(runPieces[run] == 0)
+                runStats[run] = pieceStats[i];
+            else
+                MergeRunStats(runStats[run], pieceStats[i]);
+            runPieces[run]++;
+        }
+        classifyTime += (GetTimeStamp() - batchTime);
+
+        if(WaitBox::isUpdateTime() && WaitBox::updateAndCancelCheck(snapshot.Percent()))
+            cancelled = TRUE;
+    }
+    WaitBox::hide();
+    if(cancelled)
+    {
+        msg("Utility: * Auto-format cancelled. *\n");
+        return FALSE;
+    }
+
+    std::vector<BYTE> runClasses(runs.size());
+    for(size_t i = 0; i < runs.size(); i++)
+        runClasses[i] = (BYTE) (runInited[i] ? ClassifyRun(runStats[i], runs[i].startEa, runPieces[i], is64) : RUN_OTHER);
+
+    // Report
+    UINT64 classRuns[RUN_CLASS_COUNT] = {}, classBytes[RUN_CLASS_COUNT] = {};
+    for(size_t i = 0; i < runs.size(); i++)
+    {
+        classRuns[runClasses[i]]++;
+        classBytes[runClasses[i]] += (runs[i].endEa - runs[i].startEa);
+    }
+    char buffer[32];
+    msg("Utility: Auto-format%s, %s runs in %s:\n", (dryRun ? " (dry run)" : ""), NumberCommaString(runs.size(), buffer), (allSegments ? "the data segments" : "this segment"));
+    for(UINT32 i = 0; i < RUN_CLASS_COUNT; i++)
+    {
+        msg(" %-9s %s runs", RunClassName((RUNCLASS) i), NumberCommaString(classRuns[i], buffer));
+        msg(", %s bytes.\n", NumberCommaString(classBytes[i], buffer));
+    }
+    msg(" Found in %s, read in %s, classified in %s.\n", TimeString(collectTime), TimeString(snapshot.ReadTime()), TimeString(classifyTime));
+    if(dryRun)
+        return TRUE;
+    if(allSegments && (ask_yn(ASKBTN_YES, "HIDECANCEL\nFormat the %u classified runs in all the data segments?", (UINT32) (runs.size() - classRuns[RUN_OTHER])) != ASKBTN_YES))
+        return FALSE;
+
+    // Apply, one undo point and no auto-analysis churn in between runs
+    create_undo_point("Utility:AutoFormat", "Auto-format data runs");
+    bool autoEnabled = enable_auto(false);
+    startTime = GetTimeStamp();
+    WaitBox::show("Utility", "Formatting..");
+    UINT32 formatted = 0, failed = 0;
+    for(size_t i = 0; i < runs.size(); i++)
+    {
+        if(runClasses[i] == RUN_OTHER)
+            continue;
+        if(formatRun(runs[i], (RUNCLASS) runClasses[i]))
+            formatted++;
+        else
+            failed++;
+
+        if(WaitBox::isUpdateTime() && WaitBox::updateAndCancelCheck((int) (((double) i / (double) runs.size()) * 100.0)))
+        {
+            msg("Utility: * Auto-format cancelled at %014llX, undo to revert. *\n", runs[i].startEa);
+            cancelled = TRUE;
+            break;
+        }
+    }
+    WaitBox::hide();
+    enable_auto(autoEnabled);
+
+    msg(" Formatted %s runs", NumberCommaString(formatted, buffer));
+    msg(" (%s failed) in %s.\n", NumberCommaString(failed, buffer), TimeString(GetTimeStamp() - startTime));
+    return((formatted > 0) && !cancelled);
+}
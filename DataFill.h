@@ -0,0 +1,28 @@
+// Data fill commands
+#pragma once
+
+// Find the unformatted run around 'eaScreen', from the nearest ref/name/code before it up to the next one after it.
+// The start has to be 'align' aligned. Returns FALSE, with an explanation in the output window, on failure.
+BOOL FindFillExtent(ea_t eaScreen, UINT32 align, ea_t &eaStart, ea_t &eaEnd);
+
+// Fill the run at the current address with DWORDs or QWORDs ('elementSize' 4 or 8)
+BOOL FillDataRun(UINT32 elementSize);
+
+// Detect the record stride of the run at the current address and fill it with an array of a generated struct
+BOOL FillStructArray();
+
+// Counts of the unformatted runs the fill commands could format, for the batch report
+struct FILLSURVEY
+{
+    UINT32 runs;       // Pointer aligned unformatted runs between anchors, at least two pointers long
+    UINT64 bytes;      // Their total size
+    UINT32 structRuns; // Of those, runs with a detected record stride longer than a pointer
+    double time;       // Seconds
+};
+
+// Survey the data segments without changing anything
+void SurveyFillRuns(FILLSURVEY &survey);
+
+// Classify every unformatted run in the current segment, or in all the data segments, as pointers, DWORDs, zeros or strings.
+// Reports the counts and timing, then unless 'dryRun' formats them with one undo point. Returns FALSE if cancelled or nothing done.
+BOOL AutoFormatRuns(BOOL allSegments, BOOL dryRun);
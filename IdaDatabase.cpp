@@ -0,0 +1,260 @@
+// The core "IDatabase" over the live IDA database.
+// Flags pass through as is, and byte reads go through a single reused aligned buffer.
+#include "StdAfx.h"
+#include "IdaDatabase.h"
+#include "Telemetry.h"
+#include "Core/Snapshot.h"
+#include <fixup.hpp>
+#include <algorithm>
+
+// The core flags are the low IDA ones
+static_assert((BAD_EA == BADADDR), "Core addresses have to be 64bit");
+static_assert((DBF_VAL_MASK == MS_VAL) && (DBF_IVL == FF_IVL) && (DBF_CLS_MASK == MS_CLS) && (DBF_CODE == FF_CODE) && (DBF_DATA == FF_DATA) &&
+	(DBF_TAIL == FF_TAIL) && (DBF_REF == FF_REF) && (DBF_NAME == FF_NAME) && (DBF_LABL == FF_LABL), "Core flags don't match the SDK ones");
+
+// next_that()/prev_that() callback for a core flag test
+static bool idaapi testFlags(flags64_t flags, void *ud)
+{
+	return ((FLAGTEST) ud)((uint32_t) flags);
+}
+
+IdaDatabase::IdaDatabase() : m_chunk(NULL), m_mask(NULL)
+{
+}
+
+IdaDatabase::~IdaDatabase()
+{
+	FreeBuffers();
+}
+
+void IdaDatabase::FreeBuffers()
+{
+	if (m_chunk)
+	{
+		_aligned_free(m_chunk);
+		m_chunk = NULL;
+	}
+	if (m_mask)
+	{
+		_aligned_free(m_mask);
+		m_mask = NULL;
+	}
+}
+
+bool IdaDatabase::Is64() const { return(plat.is64 != FALSE); }
+EA IdaDatabase::MinEa() const { return inf_get_min_ea(); }
+EA IdaDatabase::MaxEa() const { return inf_get_max_ea(); }
+size_t IdaDatabase::SegmentCount() const { return (size_t) get_segm_qty(); }
+size_t IdaDatabase::FunctionCount() const { return get_func_qty(); }
+DBFUNCTION IdaDatabase::Function(size_t index) const { return ToFunction(getn_func(index)); }
+EA IdaDatabase::NextInited(EA ea, EA endEa) const { return next_inited(ea, endEa); }
+EA IdaDatabase::PrevInited(EA ea, EA startEa) const { return prev_inited(ea, startEa); }
+
+uint32_t IdaDatabase::Flags(EA ea) const
+{
+	TELEMETRY_COUNT(TC_GET_FLAGS);
+	TELEMETRY_COUNT(TC_ADDRESSES);
+	return (uint32_t) get_flags(ea);
+}
+
+EA IdaDatabase::NextThat(EA ea, EA endEa, FLAGTEST test) const
+{
+	EA hit = next_that(ea, endEa, testFlags, (void *) test);
+	TELEMETRY_COUNT(TC_NEXT_THAT);
+	TELEMETRY_ADD(TC_ADDRESSES, (((hit != BAD_EA) ? hit : endEa) - ea));
+	return hit;
+}
+
+EA IdaDatabase::PrevThat(EA ea, EA startEa, FLAGTEST test) const
+{
+	EA hit = prev_that(ea, startEa, testFlags, (void *) test);
+	TELEMETRY_COUNT(TC_NEXT_THAT);
+	TELEMETRY_ADD(TC_ADDRESSES, (ea - ((hit != BAD_EA) ? hit : startEa)));
+	return hit;
+}
+
+DBSEGMENT IdaDatabase::Segment(size_t index) const
+{
+	DBSEGMENT seg = {};
+	if (segment_t *s = getnseg((int) index))
+	{
+		seg.startEa = s->start_ea;
+		seg.endEa = s->end_ea;
+		switch (s->type)
+		{
+			case SEG_CODE: seg.type = DBSEG_CODE; break;
+			case SEG_DATA: seg.type = DBSEG_DATA; break;
+			case SEG_BSS:  seg.type = DBSEG_BSS;  break;
+			case SEG_XTRN: seg.type = DBSEG_XTRN; break;
+			default:       seg.type = DBSEG_OTHER; break;
+		};
+		qstring name;
+		get_segm_name(&name, s);
+		qstrncpy(seg.name, name.c_str(), sizeof(seg.name));
+	}
+	return seg;
+}
+
+DBFUNCTION IdaDatabase::ToFunction(const func_t *f)
+{
+	DBFUNCTION func = {};
+	if (f)
+	{
+		func.startEa = f->start_ea;
+		func.endEa = f->end_ea;
+		if (!f->does_return())
+			func.flags |= DBFUNC_NORET;
+		if (is_func_tail(f))
+			func.flags |= DBFUNC_TAIL;
+	}
+	return func;
+}
+
+bool IdaDatabase::GetName(EA ea, std::string &name) const
+{
+	qstring qname;
+	if (get_name(&qname, ea) <= 0)
+		return false;
+	name.assign(qname.c_str(), qname.length());
+	return true;
+}
+
+// Read a chunk of bytes into the shared buffer
+const uint8_t *IdaDatabase::ReadBytes(EA ea, size_t size, bool forward, size_t &inited) const
+{
+	inited = 0;
+	if (!m_chunk)
+	{
+		m_chunk = (PBYTE) _aligned_malloc(SCAN_CHUNK_SIZE, 64);
+		m_mask = (PBYTE) _aligned_malloc((SCAN_CHUNK_SIZE / 8), 64);
+		if (!m_chunk || !m_mask)
+		{
+			const_cast<IdaDatabase*>(this)->FreeBuffers();
+			msg("Utility: ** Failed to allocate scan buffer! **\n");
+			return NULL;
+		}
+	}
+
+	inited = ReadInto(ea, size, forward, m_chunk, m_mask);
+	return m_chunk;
+}
+
+// Counts the leading (forward) or trailing (backward) initialized bytes read, the scans only
+// look at those and then skip the uninitialized span in one step.
+size_t IdaDatabase::ReadInto(EA ea, size_t size, bool forward, uint8_t *buffer, uint8_t *maskBuffer)
+{
+	if ((size == 0) || (size > SCAN_CHUNK_SIZE))
+		return 0;
+	ssize_t read = get_bytes(buffer, size, ea, GMB_READALL, maskBuffer);
+	TELEMETRY_COUNT(TC_GET_BYTES);
+	TELEMETRY_ADD(TC_ADDRESSES, size);
+	if (read < (ssize_t) size)
+		return 0;
+
+	// Find the first/last uninitialized byte from the mask, 64 bytes at the time
+	size_t inited = 0;
+	const UINT64 *mask = (const UINT64*) maskBuffer;
+	if (forward)
+	{
+		inited = size;
+		for (size_t i = 0; i < size; i += 64)
+		{
+			UINT64 w = ~mask[i / 64];
+			if (w)
+			{
+				inited = std::min((i + LowestBit64(w)), size);
+				break;
+			}
+		}
+	}
+	else
+	{
+		size_t last = (size - 1);
+		size_t wi = (last / 64);
+		UINT32 topBit = (UINT32) (last & 63);
+		UINT64 w = ~(mask[wi] | ((topBit == 63) ? 0 : (~0ull << (topBit + 1))));
+		for (;;)
+		{
+			if (w)
+			{
+				inited = (last - ((wi * 64) + HighestBit64(w)));
+				break;
+			}
+			if (wi-- == 0)
+			{
+				inited = size;
+				break;
+			}
+			w = ~mask[wi];
+		}
+	}
+	return inited;
+}
+
+// ======================================================================================
+
+static IdaDatabase *s_live = NULL;
+
+IdaDatabase &LiveDatabase()
+{
+	if (!s_live)
+		s_live = new IdaDatabase();
+	return *s_live;
+}
+
+void IdaDatabaseTerm()
+{
+	delete s_live;
+	s_live = NULL;
+}
+
+// ======================================================================================
+
+void ExportSnapshot()
+{
+	// From a batch run the path comes from the environment, like the batch report
+	qstring path;
+	if (!qgetenv("UTILITY_SNAPSHOT", &path) || path.empty())
+	{
+		qstring defaultPath(get_path(PATH_TYPE_IDB));
+		defaultPath.append(".usnap");
+		LPCSTR selected = ask_file(true, defaultPath.c_str(), "FILTER Utility snapshot|*.usnap\nExport a database snapshot to");
+		if (!selected)
+			return;
+		path = selected;
+	}
+
+	msg("Utility: Exporting snapshot to \"%s\":\n", path.c_str());
+	show_wait_box("Exporting snapshot..");
+	TIMESTAMP startTime = GetTimeStamp();
+	std::string error;
+	BOOL result = WriteSnapshot(LiveDatabase(), path.c_str(), error);
+	hide_wait_box();
+	if (!result)
+	{
+		msg("Utility: ** %s. **\n", error.c_str());
+		return;
+	}
+
+	char buffer[32];
+	msg(" %d segments, %s functions, in %s.\n", get_segm_qty(), NumberCommaString(get_func_qty(), buffer), TimeString(GetTimeStamp() - startTime));
+}
+
+// ======================================================================================
+
+UINT32 MaskFixups(ea_t ea, BYTE *bytes, size_t size)
+{
+	UINT32 count = 0;
+	ea_t endEa = (ea + size);
+	for (ea_t fixupEa = (exists_fixup(ea) ? ea : get_next_fixup_ea(ea)); (fixupEa != BADADDR) && (fixupEa < endEa); fixupEa = get_next_fixup_ea(fixupEa))
+	{
+		fixup_data_t fd;
+		if (get_fixup(&fd, fixupEa))
+		{
+			size_t offset = (size_t) (fixupEa - ea);
+			memset(&bytes[offset], 0, std::min((size_t) std::max(fd.calc_size(), 0), (size - offset)));
+			count++;
+		}
+	}
+	return count;
+}
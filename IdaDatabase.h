@@ -0,0 +1,47 @@
+// The core "IDatabase" over the live IDA database
+#pragma once
+#include "Core/Database.h"
+
+class IdaDatabase : public IDatabase
+{
+public:
+	IdaDatabase();
+	virtual ~IdaDatabase();
+
+	// Free the shared read buffers
+	void FreeBuffers();
+
+	virtual bool Is64() const;
+	virtual EA MinEa() const;
+	virtual EA MaxEa() const;
+	virtual size_t SegmentCount() const;
+	virtual DBSEGMENT Segment(size_t index) const;
+	virtual uint32_t Flags(EA ea) const;
+	virtual EA NextThat(EA ea, EA endEa, FLAGTEST test) const;
+	virtual EA PrevThat(EA ea, EA startEa, FLAGTEST test) const;
+	virtual EA NextInited(EA ea, EA endEa) const;
+	virtual EA PrevInited(EA ea, EA startEa) const;
+	virtual const uint8_t *ReadBytes(EA ea, size_t size, bool forward, size_t &inited) const;
+	virtual size_t FunctionCount() const;
+	virtual DBFUNCTION Function(size_t index) const;
+	virtual bool GetName(EA ea, std::string &name) const;
+
+	static DBFUNCTION ToFunction(const func_t *f);
+	// ReadBytes() into a caller buffer, with a (SCAN_CHUNK_SIZE / 8) byte 'mask' buffer. Returns the initialized span.
+	static size_t ReadInto(EA ea, size_t size, bool forward, uint8_t *buffer, uint8_t *mask);
+
+private:
+	mutable PBYTE m_chunk; // Reused read buffer
+	mutable PBYTE m_mask;  // Initialized byte bitmap for 'm_chunk'
+};
+
+// The shared instance, main thread only
+IdaDatabase &LiveDatabase();
+void IdaDatabaseTerm();
+
+// Write a snapshot of the database for the core tools, see "Core/Snapshot.h"
+void ExportSnapshot();
+
+// Zero the fixup (relocated) bytes in a copy of the 'size' bytes at 'ea', so copies of code at different addresses
+// compare equal. Returns the count of fixups.
+UINT32 MaskFixups(ea_t ea, BYTE *bytes, size_t size);
@@ -0,0 +1,68 @@
+// Handling of navigation scans that run long, like a NotZ press into a huge empty region.
+// Short scans stay synchronous, the state is just a timer check per chunk. Past LONGSCAN_THRESHOLD the scan
+// either goes on behind a cancellable wait box, or gives up (idle time prefetching mustn't block the UI).
+#pragma once
+#include <WaitBoxEx.h>
+
+enum LONGSCAN
+{
+	LONGSCAN_BLOCK,      // Just keep going, the original behavior (benchmarks)
+	LONGSCAN_BACKGROUND, // Show progress with cancel, the NotZ scan continues on its worker pipeline
+	LONGSCAN_GIVEUP,     // Stop the scan
+};
+
+const TIMESTAMP LONGSCAN_THRESHOLD = 0.25;     // Seconds
+const TIMESTAMP LONGSCAN_IDLE_THRESHOLD = 0.02; // For LONGSCAN_GIVEUP, idle time work has to stay short
+
+// A scan's time and wait box, main thread only
+class LongScanState
+{
+public:
+	LongScanState(LONGSCAN mode, ea_t startEa, ea_t endEa) : m_mode(mode), m_startEa(startEa), m_endEa(endEa), m_startTime(GetTimeStamp()), m_waitBox(FALSE), m_stopped(FALSE) {}
+	~LongScanState()
+	{
+		if (m_waitBox)
+			WaitBox::hide();
+	}
+
+	// Call with the scan position between chunks, returns FALSE if the scan should stop (cancelled or given up)
+	BOOL Check(ea_t ea)
+	{
+		if (m_waitBox)
+		{
+			if (WaitBox::isUpdateTime())
+			{
+				ea_t done = ((ea > m_startEa) ? (ea - m_startEa) : (m_startEa - ea));
+				ea_t total = ((m_endEa > m_startEa) ? (m_endEa - m_startEa) : (m_startEa - m_endEa));
+				if (WaitBox::updateAndCancelCheck((int) ((total ? ((double) done / (double) total) : 1.0) * 100.0)))
+				{
+					msg("Utility: * Scan cancelled at %llX *\n", ea);
+					m_stopped = TRUE;
+				}
+			}
+		}
+		else
+		if ((m_mode != LONGSCAN_BLOCK) && ((GetTimeStamp() - m_startTime) > ((m_mode == LONGSCAN_GIVEUP) ? LONGSCAN_IDLE_THRESHOLD : LONGSCAN_THRESHOLD)))
+		{
+			if (m_mode == LONGSCAN_GIVEUP)
+				m_stopped = TRUE;
+			else
+			{
+				WaitBox::show("Utility", "Scanning..");
+				m_waitBox = TRUE;
+			}
+		}
+		return !m_stopped;
+	}
+
+	// TRUE once the scan went long in background mode
+	BOOL InBackground() const { return m_waitBox; }
+	// TRUE if the scan stopped before its end, the result isn't a "not found"
+	BOOL Stopped() const { return m_stopped; }
+
+private:
+	LONGSCAN m_mode;
+	ea_t m_startEa, m_endEa;
+	TIMESTAMP m_startTime;
+	BOOL m_waitBox, m_stopped;
+};
@@ -0,0 +1,373 @@
+// Cache of precomputed next/previous navigation targets.
+// Per kind a run of consecutive targets, the invariant being that every target in [lo, hi] is in the run.
+// A lookup inside the run is a binary search; outside it the run is restarted at the lookup position.
+#include "StdAfx.h"
+#include "NavCache.h"
+#include "AnchorIndex.h"
+#include "NotZeroScan.h"
+#include "ValueSearch.h"
+#include "TypeRunIndex.h"
+#include "ByteRunScan.h"
+#include <algorithm>
+#include <deque>
+
+static const size_t NAV_LOOKAHEAD = 16;         // Targets to precompute past the current one
+static const size_t NAV_MAX_TARGETS = 1024;     // Run cap, trimmed from the end behind the current position
+static const TIMESTAMP PREFETCH_BUDGET = 0.005; // Idle time spent per timer tick, in seconds
+
+struct NAVRUN
+{
+	std::deque<ea_t> targets;
+	ea_t lo, hi;     // Covered range, 'endPrev'/'endNext' extend it to the start/end of the database
+	BOOL endPrev, endNext;
+	BOOL valid;
+};
+static NAVRUN s_runs[NAV_KIND_COUNT];
+
+// Collapsing or expanding a hidden range has no event, so the lookups check a hash of the hidden ranges instead
+static UINT64 s_hiddenState = 0;
+
+static qtimer_t s_prefetchTimer = NULL;
+static NAVKIND s_prefetchKind = NAV_XREF;
+static ea_t s_prefetchEa = BADADDR;
+static BOOL s_prefetchForward = TRUE;
+
+// ======================================================================================
+
+// The uncached next/previous target, exclusive of 'ea'. 'stopped' is set if a long scan was cancelled or gave up.
+static ea_t findNext(NAVKIND kind, ea_t ea, LONGSCAN longScan, BOOL &stopped)
+{
+	switch (kind)
+	{
+		case NAV_NOTZERO: return FindNextNotZero(ea, longScan, &stopped);
+		case NAV_VALUE: return FindNextValue(ea, longScan, &stopped);
+		case NAV_TYPECHANGE: return TypeRunIndexNext(ea, longScan, &stopped);
+		case NAV_PADDING: return FindNextPadding(ea, longScan, &stopped);
+		case NAV_STRINGRUN: return FindNextStringRun(ea, longScan, &stopped);
+		default: return AnchorIndexNext(ea, (ANCHOR_MODE) kind, longScan, &stopped);
+	};
+}
+static ea_t findPrev(NAVKIND kind, ea_t ea, LONGSCAN longScan, BOOL &stopped)
+{
+	switch (kind)
+	{
+		case NAV_NOTZERO: return FindPrevNotZero(ea, longScan, &stopped);
+		case NAV_VALUE: return FindPrevValue(ea, longScan, &stopped);
+		case NAV_TYPECHANGE: return TypeRunIndexPrev(ea, longScan, &stopped);
+		case NAV_PADDING: return FindPrevPadding(ea, longScan, &stopped);
+		case NAV_STRINGRUN: return FindPrevStringRun(ea, longScan, &stopped);
+		default: return AnchorIndexPrev(ea, (ANCHOR_MODE) kind, longScan, &stopped);
+	};
+}
+
+// The next targets from 'ea' are the ones above nextKey(), the previous ones those below prevKey().
+// Anchors, values and run starts are single addresses, the not zero targets are item heads and the search starts outside the current item.
+static ea_t nextKey(NAVKIND kind, ea_t ea) { return((kind == NAV_NOTZERO) ? (get_item_end(ea) - 1) : ea); }
+static ea_t prevKey(NAVKIND kind, ea_t ea) { return((kind == NAV_NOTZERO) ? get_item_head(ea) : ea); }
+
+static void invalidateAll()
+{
+	for (NAVRUN &r : s_runs)
+	{
+		r.targets.clear();
+		r.valid = FALSE;
+	}
+}
+
+// The kinds whose searches skip over collapsed hidden ranges
+static BOOL skipsCollapsed(NAVKIND kind)
+{
+	return((kind == NAV_NOTZERO) || (kind == NAV_VALUE) || (kind == NAV_PADDING) || (kind == NAV_STRINGRUN));
+}
+
+// FNV-1a over the hidden ranges' bounds and visibility
+static UINT64 hiddenRangesState()
+{
+	UINT64 hash = 0xCBF29CE484222325ull;
+	auto add = [&hash](UINT64 value)
+	{
+		hash ^= value;
+		hash *= 0x100000001B3ull;
+	};
+	int count = get_hidden_range_qty();
+	for (int i = 0; i < count; i++)
+	{
+		if (hidden_range_t *hr = getn_hidden_range(i))
+		{
+			add(hr->start_ea);
+			add(hr->end_ea);
+			add(hr->visible);
+		}
+	}
+	return hash;
+}
+
+// Drop the runs of the kinds that skip collapsed ranges if a range was collapsed or expanded since the last check
+static void checkHiddenRanges(NAVKIND kind)
+{
+	if (!skipsCollapsed(kind))
+		return;
+	UINT64 state = hiddenRangesState();
+	if (state != s_hiddenState)
+	{
+		s_hiddenState = state;
+		for (int i = 0; i < NAV_KIND_COUNT; i++)
+		{
+			if (skipsCollapsed((NAVKIND) i))
+				NavCacheInvalidate((NAVKIND) i);
+		}
+	}
+}
+
+// Start an empty run covering nothing at 'lo'
+static void restartRun(NAVRUN &r, ea_t lo)
+{
+	r.targets.clear();
+	r.lo = lo;
+	r.hi = (lo - 1);
+	r.endPrev = r.endNext = FALSE;
+	r.valid = TRUE;
+}
+
+// Add the target past either end of the run, FALSE if there are no more or the scan was stopped
+static BOOL extendNext(NAVKIND kind, NAVRUN &r, LONGSCAN longScan)
+{
+	if (r.endNext)
+		return FALSE;
+	BOOL stopped;
+	ea_t ea = findNext(kind, r.hi, longScan, stopped);
+	if (stopped)
+		return FALSE;
+	if (ea == BADADDR)
+	{
+		r.endNext = TRUE;
+		r.hi = BADADDR;
+		return FALSE;
+	}
+	r.targets.push_back(ea);
+	r.hi = ea;
+	return TRUE;
+}
+
+static BOOL extendPrev(NAVKIND kind, NAVRUN &r, LONGSCAN longScan)
+{
+	if (r.endPrev)
+		return FALSE;
+	BOOL stopped;
+	ea_t ea = findPrev(kind, r.lo, longScan, stopped);
+	if (stopped)
+		return FALSE;
+	if (ea == BADADDR)
+	{
+		r.endPrev = TRUE;
+		r.lo = 0;
+		return FALSE;
+	}
+	r.targets.push_front(ea);
+	r.lo = ea;
+	return TRUE;
+}
+
+// Trim the run from the end behind 'ea' in the travel direction
+static void trimBehind(NAVRUN &r, ea_t ea, BOOL forward)
+{
+	if (forward)
+	{
+		while ((r.targets.size() > NAV_MAX_TARGETS) && (r.targets.front() < ea))
+		{
+			r.targets.pop_front();
+			r.lo = r.targets.front();
+			r.endPrev = FALSE;
+		}
+	}
+	else
+	{
+		while ((r.targets.size() > NAV_MAX_TARGETS) && (r.targets.back() > ea))
+		{
+			r.targets.pop_back();
+			r.hi = r.targets.back();
+			r.endNext = FALSE;
+		}
+	}
+}
+
+// Count of the run's targets from 'key' in the direction, if the run covers it
+static BOOL targetsAhead(const NAVRUN &r, ea_t key, BOOL forward, size_t &index)
+{
+	if (!r.valid)
+		return FALSE;
+	if (forward)
+	{
+		if ((r.lo > (key + 1)) || (key > r.hi))
+			return FALSE;
+		index = (std::upper_bound(r.targets.begin(), r.targets.end(), key) - r.targets.begin());
+	}
+	else
+	{
+		if ((r.lo > key) || ((key - 1) > r.hi))
+			return FALSE;
+		index = (std::lower_bound(r.targets.begin(), r.targets.end(), key) - r.targets.begin());
+	}
+	return TRUE;
+}
+
+// ======================================================================================
+
+ea_t NavCacheNext(NAVKIND kind, ea_t ea, UINT32 count, UINT32 &moved)
+{
+	checkHiddenRanges(kind);
+	NAVRUN &r = s_runs[kind];
+	ea_t key = nextKey(kind, ea);
+	size_t index;
+	if (!targetsAhead(r, key, TRUE, index))
+	{
+		restartRun(r, (key + 1));
+		index = 0;
+	}
+
+	while (((r.targets.size() - index) < count) && extendNext(kind, r, LONGSCAN_BACKGROUND))
+		;
+	moved = (UINT32) std::min((size_t) count, (r.targets.size() - index));
+	if (moved == 0)
+		return BADADDR;
+	ea_t result = r.targets[index + (moved - 1)];
+	trimBehind(r, result, TRUE);
+	return result;
+}
+
+ea_t NavCachePrev(NAVKIND kind, ea_t ea, UINT32 count, UINT32 &moved)
+{
+	checkHiddenRanges(kind);
+	NAVRUN &r = s_runs[kind];
+	ea_t key = prevKey(kind, ea);
+	moved = 0;
+	if (key == 0)
+		return BADADDR;
+	size_t index;
+	if (!targetsAhead(r, key, FALSE, index))
+	{
+		restartRun(r, key);
+		index = 0;
+	}
+
+	// Each target added to the front is one more below the key
+	while ((index < count) && extendPrev(kind, r, LONGSCAN_BACKGROUND))
+		index++;
+	moved = (UINT32) std::min((size_t) count, index);
+	if (moved == 0)
+		return BADADDR;
+	ea_t result = r.targets[index - moved];
+	trimBehind(r, result, FALSE);
+	return result;
+}
+
+// ======================================================================================
+
+// Extend the run past the last jump a slice at the time, until there are NAV_LOOKAHEAD targets ahead
+static int idaapi prefetchTimer(void *ud)
+{
+	NAVRUN &r = s_runs[s_prefetchKind];
+	TIMESTAMP startTime = GetTimeStamp();
+	for (;;)
+	{
+		size_t index;
+		ea_t key = (s_prefetchForward ? nextKey(s_prefetchKind, s_prefetchEa) : prevKey(s_prefetchKind, s_prefetchEa));
+		if (!targetsAhead(r, key, s_prefetchForward, index))
+			break;
+		size_t ahead = (s_prefetchForward ? (r.targets.size() - index) : index);
+		if (ahead >= NAV_LOOKAHEAD)
+			break;
+		// Long scans give up here, the next press does them with progress instead
+		if (!(s_prefetchForward ? extendNext(s_prefetchKind, r, LONGSCAN_GIVEUP) : extendPrev(s_prefetchKind, r, LONGSCAN_GIVEUP)))
+			break;
+		trimBehind(r, s_prefetchEa, s_prefetchForward);
+
+		// Give the UI a turn, continue on the next tick
+		if ((GetTimeStamp() - startTime) > PREFETCH_BUDGET)
+			return 1;
+	}
+
+	s_prefetchTimer = NULL;
+	return -1;
+}
+
+void NavCachePrefetch(NAVKIND kind, ea_t ea, BOOL forward)
+{
+	s_prefetchKind = kind;
+	s_prefetchEa = ea;
+	s_prefetchForward = forward;
+	if (!s_prefetchTimer)
+		s_prefetchTimer = register_timer(1, prefetchTimer, NULL);
+}
+
+void NavCacheInvalidate(NAVKIND kind)
+{
+	s_runs[kind].targets.clear();
+	s_runs[kind].valid = FALSE;
+}
+
+// ======================================================================================
+
+// Any change that can move a target drops all the runs, they're cheap to rebuild
+struct navcache_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
+		{
+			case idb_event::byte_patched:
+			case idb_event::renamed:
+			case idb_event::make_code:
+			case idb_event::make_data:
+			case idb_event::destroyed_items:
+			case idb_event::segm_added:
+			case idb_event::segm_deleted:
+			case idb_event::segm_start_changed:
+			case idb_event::segm_end_changed:
+			case idb_event::segm_moved:
+			case idb_event::allsegs_moved:
+			case idb_event::closebase:
+			invalidateAll();
+			break;
+		};
+		return 0;
+	}
+};
+
+struct navcache_idp_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
+		{
+			case processor_t::ev_add_cref:
+			case processor_t::ev_add_dref:
+			case processor_t::ev_del_cref:
+			case processor_t::ev_del_dref:
+			invalidateAll();
+			break;
+		};
+		return 0;
+	}
+};
+
+static navcache_listener_t s_idbListener;
+static navcache_idp_listener_t s_idpListener;
+
+void NavCacheInit()
+{
+	hook_event_listener(HT_IDB, &s_idbListener);
+	hook_event_listener(HT_IDP, &s_idpListener);
+}
+
+void NavCacheTerm()
+{
+	if (s_prefetchTimer)
+	{
+		unregister_timer(s_prefetchTimer);
+		s_prefetchTimer = NULL;
+	}
+	unhook_event_listener(HT_IDP, &s_idpListener);
+	unhook_event_listener(HT_IDB, &s_idbListener);
+	invalidateAll();
+}
@@ -0,0 +1,35 @@
+// Cache of precomputed next/previous navigation targets for the FindNext/Prev commands.
+// Per target kind a run of consecutive targets around the last position, extended during idle time after each jump,
+// so repeated presses through a table are a lookup. Dropped on any byte, flag, name, xref or segment change, and for the
+// searches that skip collapsed ranges when a hidden range is collapsed or expanded.
+#pragma once
+
+// Target kinds, the anchor ones in "ANCHOR_MODE" order
+enum NAVKIND
+{
+	NAV_XREF,       // Any xref, name or label
+	NAV_CODEREF,
+	NAV_DATAREF,
+	NAV_USERNAME,
+	NAV_NOTZERO,    // Items that are not all zeros
+	NAV_VALUE,      // Aligned values matching the value search query
+	NAV_TYPECHANGE, // Starts of runs of items of another kind
+	NAV_PADDING,    // Unformatted alignment padding runs
+	NAV_STRINGRUN,  // Unformatted ASCII and UTF-16 string runs
+
+	NAV_KIND_COUNT
+};
+
+void NavCacheInit();
+void NavCacheTerm();
+
+// Return the 'count'th next/previous target from 'ea' (exclusive).
+// If there are fewer than 'count' returns the last one there is, and 'moved' is how many were skipped. BADADDR if none.
+ea_t NavCacheNext(NAVKIND kind, ea_t ea, UINT32 count, UINT32 &moved);
+ea_t NavCachePrev(NAVKIND kind, ea_t ea, UINT32 count, UINT32 &moved);
+
+// Precompute targets past 'ea' in the given direction during idle time
+void NavCachePrefetch(NAVKIND kind, ea_t ea, BOOL forward);
+
+// Drop a kind's targets, for when what it searches for changes
+void NavCacheInvalidate(NAVKIND kind);
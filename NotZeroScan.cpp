@@ -0,0 +1,354 @@
+// Bulk non-zero byte scanner for the FindNext/PrevNotZ commands.
+// The per-segment scan is the core one ("Core/Navigation.h") over the live database, this adds the
+// segment walk, the zero run index, collapsed ranges, and maps the hit back to its item head.
+// Unloaded and uninitialized spans (.bss, gaps, etc.) are skipped whole using the loaded range map.
+// Scans that run long switch to a read/scan pipeline with a worker thread behind a cancellable wait box.
+#include "StdAfx.h"
+#include "NotZeroScan.h"
+#include "ZeroRunIndex.h"
+#include "IdaDatabase.h"
+#include "Core/Navigation.h"
+#include "Core/ZeroScan.h"
+#include <future>
+#include <vector>
+
+// If the address is inside a collapsed hidden range return it, else NULL
+static hidden_range_t *getCollapsedRange(ea_t ea)
+{
+	hidden_range_t *hr = get_hidden_range(ea);
+	return((hr && !hr->visible) ? hr : NULL);
+}
+
+// Synchronous scan slice between long scan checks
+static const size_t SYNC_SLICE_SIZE = (16 * SCAN_CHUNK_SIZE);
+
+// Background pipeline buffers, the main thread reads a chunk into one while the worker scans the other
+struct PIPEBUFFER
+{
+	std::vector<BYTE> bytes, mask;
+	PIPEBUFFER() : bytes(SCAN_CHUNK_SIZE), mask(SCAN_CHUNK_SIZE / 8) {}
+};
+
+// The rest of a long segment range scan, past the long scan threshold.
+// The SDK is main thread only so this thread does the reads (and wait box), the worker only runs the SIMD scan.
+static ea_t pipelineNext(LongScanState &state, ea_t ea, ea_t endEa)
+{
+	PIPEBUFFER buffers[2];
+	std::future<size_t> pending;
+	ea_t pendingEa = BADADDR;
+	size_t pendingSize = 0;
+	UINT32 current = 0;
+
+	for (;;)
+	{
+		// Read the next chunk while the worker scans the previous one
+		size_t inited = 0;
+		ea_t chunkEa = ea;
+		if (ea < endEa)
+		{
+			if (!is_loaded(ea))
+			{
+				ea = next_inited(ea, endEa);
+				if (ea == BADADDR)
+					ea = endEa;
+				continue;
+			}
+			size_t size = (size_t) std::min((ea_t) SCAN_CHUNK_SIZE, (endEa - ea));
+			inited = IdaDatabase::ReadInto(ea, size, true, buffers[current].bytes.data(), buffers[current].mask.data());
+			if (inited == 0)
+			{
+				// Shouldn't be, the first byte was loaded
+				ea++;
+				continue;
+			}
+			ea += inited;
+		}
+
+		// Collect the previous chunk, it's the earlier one
+		if (pending.valid())
+		{
+			size_t offset = pending.get();
+			if (offset < pendingSize)
+				return(pendingEa + offset);
+		}
+		if (inited == 0)
+			return BADADDR;
+		if (!state.Check(ea))
+			return BADADDR;
+
+		const BYTE *bytes = buffers[current].bytes.data();
+		pending = std::async(std::launch::async, [bytes, inited]() { return FindFirstNonZero(bytes, inited); });
+		pendingEa = chunkEa;
+		pendingSize = inited;
+		current ^= 1;
+	}
+}
+
+static ea_t pipelinePrev(LongScanState &state, ea_t startEa, ea_t ea)
+{
+	PIPEBUFFER buffers[2];
+	std::future<size_t> pending;
+	ea_t pendingEa = BADADDR;
+	size_t pendingSize = 0;
+	UINT32 current = 0;
+
+	for (;;)
+	{
+		// Chunk [chunkEa, ea), the initialized bytes are its trailing 'inited' ones
+		size_t inited = 0, skip = 0;
+		ea_t chunkEa = ea;
+		if (ea > startEa)
+		{
+			if (!is_loaded(ea - 1))
+			{
+				ea_t prev = prev_inited((ea - 1), startEa);
+				ea = ((prev != BADADDR) ? (prev + 1) : startEa);
+				continue;
+			}
+			size_t size = (size_t) std::min((ea_t) SCAN_CHUNK_SIZE, (ea - startEa));
+			chunkEa = (ea - size);
+			inited = IdaDatabase::ReadInto(chunkEa, size, false, buffers[current].bytes.data(), buffers[current].mask.data());
+			if (inited == 0)
+			{
+				ea--;
+				continue;
+			}
+			skip = (size - inited);
+			chunkEa += skip;
+			ea = chunkEa;
+		}
+
+		if (pending.valid())
+		{
+			size_t offset = pending.get();
+			if (offset < pendingSize)
+				return(pendingEa + offset);
+		}
+		if (inited == 0)
+			return BADADDR;
+		if (!state.Check(ea))
+			return BADADDR;
+
+		const BYTE *bytes = (buffers[current].bytes.data() + skip);
+		pending = std::async(std::launch::async, [bytes, inited]() { return FindLastNonZero(bytes, inited); });
+		pendingEa = chunkEa;
+		pendingSize = inited;
+		current ^= 1;
+	}
+}
+
+// Scan a segment range synchronously in slices, handing the rest over to the pipeline once it goes long
+static ea_t scanSegmentNext(LongScanState &state, ea_t ea, ea_t endEa)
+{
+	while (ea < endEa)
+	{
+		if (state.InBackground())
+			return pipelineNext(state, ea, endEa);
+
+		ea_t sliceEnd = (ea + std::min((ea_t) SYNC_SLICE_SIZE, (endEa - ea)));
+		ea_t hit = ScanNextNotZero(LiveDatabase(), ea, sliceEnd);
+		if (hit != BADADDR)
+			return hit;
+		ea = sliceEnd;
+		if (!state.Check(ea))
+			break;
+	}
+	return BADADDR;
+}
+
+static ea_t scanSegmentPrev(LongScanState &state, ea_t startEa, ea_t ea)
+{
+	while (ea > startEa)
+	{
+		if (state.InBackground())
+			return pipelinePrev(state, startEa, ea);
+
+		ea_t sliceStart = (ea - std::min((ea_t) SYNC_SLICE_SIZE, (ea - startEa)));
+		ea_t hit = ScanPrevNotZero(LiveDatabase(), sliceStart, ea);
+		if (hit != BADADDR)
+			return hit;
+		ea = sliceStart;
+		if (!state.Check(ea))
+			break;
+	}
+	return BADADDR;
+}
+
+// ======================================================================================
+
+ea_t FindNextNotZero(ea_t ea, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+
+	// Start after the current item
+	ea = get_item_end(ea);
+	ea_t maxEa = inf_get_max_ea();
+	LongScanState state(longScan, ea, maxEa);
+
+	while ((ea < maxEa) && !state.Stopped())
+	{
+		// Jump over unloaded ranges, and with them any run of segments without initialized bytes, in one step
+		if (!is_loaded(ea))
+		{
+			ea = next_inited(ea, maxEa);
+			if (ea == BADADDR)
+				break;
+		}
+
+		segment_t *seg = getseg(ea);
+		if (!seg)
+		{
+			seg = get_next_seg(ea);
+			if (!seg)
+				break;
+			ea = seg->start_ea;
+			continue;
+		}
+
+		ea_t hit;
+		if (!ZeroRunIndexFindNext(seg, ea, seg->end_ea, hit))
+			hit = scanSegmentNext(state, ea, seg->end_ea);
+		if (hit == BADADDR)
+		{
+			ea = seg->end_ea;
+			continue;
+		}
+
+		// Skip over collapsed ranges like next_visea() does
+		if (hidden_range_t *hr = getCollapsedRange(hit))
+		{
+			ea = hr->end_ea;
+			continue;
+		}
+		return get_item_head(hit);
+	}
+
+	if (stopped)
+		*stopped = state.Stopped();
+	return BADADDR;
+}
+
+ea_t FindPrevNotZero(ea_t ea, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+
+	// Start before the current item
+	ea = get_item_head(ea);
+	ea_t minEa = inf_get_min_ea();
+	LongScanState state(longScan, ea, minEa);
+
+	while ((ea > minEa) && !state.Stopped())
+	{
+		if (!is_loaded(ea - 1))
+		{
+			ea_t prev = prev_inited((ea - 1), minEa);
+			if (prev == BADADDR)
+				break;
+			ea = (prev + 1);
+		}
+
+		segment_t *seg = getseg(ea - 1);
+		if (!seg)
+		{
+			seg = get_prev_seg(ea - 1);
+			if (!seg)
+				break;
+			ea = seg->end_ea;
+			continue;
+		}
+
+		ea_t hit;
+		if (!ZeroRunIndexFindPrev(seg, seg->start_ea, ea, hit))
+			hit = scanSegmentPrev(state, seg->start_ea, ea);
+		if (hit == BADADDR)
+		{
+			ea = seg->start_ea;
+			continue;
+		}
+
+		if (hidden_range_t *hr = getCollapsedRange(hit))
+		{
+			ea = hr->start_ea;
+			continue;
+		}
+		return get_item_head(hit);
+	}
+
+	if (stopped)
+		*stopped = state.Stopped();
+	return BADADDR;
+}
+
+// ======================================================================================
+
+// The original per-item FindNextNotZ loop, kept for comparison
+static ea_t legacyNextNotZero(ea_t eaAddr)
+{
+	while ((eaAddr = next_visea(eaAddr)) != BADADDR)
+	{
+		asize_t size = get_item_size(eaAddr);
+		if (size <= sizeof(UINT32))
+		{
+			uval_t v = 0;
+			if (get_data_value(&v, eaAddr, size))
+			{
+				if (v != 0)
+					return eaAddr;
+			}
+		}
+		else
+		if (PVOID pBuffer = _aligned_malloc(size, 32))
+		{
+			BOOL bSuccess = FALSE;
+			if (get_bytes(pBuffer, size, eaAddr, GMB_READALL))
+			{
+				PBYTE p = (PBYTE) pBuffer;
+				while (size--)
+				{
+					if (*p++)
+					{
+						bSuccess = TRUE;
+						break;
+					}
+				};
+			}
+			_aligned_free(pBuffer);
+
+			if (bSuccess)
+				return eaAddr;
+		}
+	};
+	return BADADDR;
+}
+
+void BenchmarkNotZero()
+{
+	ea_t eaScreen = get_screen_ea();
+	if (eaScreen == BADADDR)
+		return;
+
+	// Enough runs to get past timer resolution on short distances
+	const UINT32 RUNS = 8;
+	msg("Utility: NotZ benchmark from %llX, %u runs each (%s):\n", eaScreen, RUNS, ZeroScanISA());
+
+	ea_t legacyHit = BADADDR;
+	TIMESTAMP startTime = GetTimeStamp();
+	for (UINT32 i = 0; i < RUNS; i++)
+		legacyHit = legacyNextNotZero(eaScreen);
+	TIMESTAMP legacyTime = ((GetTimeStamp() - startTime) / RUNS);
+
+	ea_t bulkHit = BADADDR;
+	startTime = GetTimeStamp();
+	for (UINT32 i = 0; i < RUNS; i++)
+		bulkHit = FindNextNotZero(eaScreen);
+	TIMESTAMP bulkTime = ((GetTimeStamp() - startTime) / RUNS);
+
+	msg(" Per-item: %llX in %s\n", legacyHit, TimeString(legacyTime));
+	msg("     Bulk: %llX in %s\n", bulkHit, TimeString(bulkTime));
+	if (bulkTime > 0.0)
+		msg(" Speedup: %.1fx\n", (legacyTime / bulkTime));
+	if (legacyHit != bulkHit)
+		msg(" ** Results differ! **\n");
+}
@@ -0,0 +1,11 @@
+// Bulk non-zero byte scanner for the FindNext/PrevNotZ commands
+#pragma once
+#include "LongScan.h"
+
+// Return the head of the next/previous item from 'ea' that is not all zeros, or BADADDR if none.
+// 'longScan' is what to do if it runs long, 'stopped' is set if it was cancelled or gave up before the end.
+ea_t FindNextNotZero(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+ea_t FindPrevNotZero(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+
+// Compare the bulk scanner against the original per-item loop from the current address
+void BenchmarkNotZero();
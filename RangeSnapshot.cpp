@@ -0,0 +1,50 @@
+// Reads address ranges into memory a batch at the time
+#include "StdAfx.h"
+#include "RangeSnapshot.h"
+#include "IdaDatabase.h"
+#include <algorithm>
+
+void RangeSnapshot::Add(ea_t startEa, ea_t endEa)
+{
+	if (endEa <= startEa)
+		return;
+	RANGE range = { startEa, endEa };
+	if (m_ranges.empty())
+		m_ea = startEa;
+	m_ranges.push_back(range);
+	m_totalBytes += (endEa - startEa);
+}
+
+BOOL RangeSnapshot::ReadBatch()
+{
+	m_pieces.clear();
+	if (m_range >= m_ranges.size())
+		return FALSE;
+	if (m_mask.empty())
+		m_mask.resize(SCAN_CHUNK_SIZE / 8);
+
+	TIMESTAMP startTime = GetTimeStamp();
+	size_t used = 0;
+	while ((m_range < m_ranges.size()) && (used < BATCH_SIZE))
+	{
+		const RANGE &range = m_ranges[m_range];
+		SNAPSHOTPIECE piece;
+		piece.range = m_range;
+		piece.ea = m_ea;
+		piece.offset = used;
+		piece.size = (size_t) std::min((ea_t) SCAN_CHUNK_SIZE, (range.endEa - m_ea));
+		if (m_buffer.size() < (used + piece.size))
+			m_buffer.resize(used + piece.size);
+		piece.initedSize = IdaDatabase::ReadInto(m_ea, piece.size, true, &m_buffer[used], m_mask.data());
+		piece.inited = (piece.initedSize == piece.size);
+		m_pieces.push_back(piece);
+		used += piece.size;
+		m_doneBytes += piece.size;
+
+		m_ea += piece.size;
+		if ((m_ea >= range.endEa) && (++m_range < m_ranges.size()))
+			m_ea = m_ranges[m_range].startEa;
+	}
+	m_readTime += (GetTimeStamp() - startTime);
+	return TRUE;
+}
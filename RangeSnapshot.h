@@ -0,0 +1,49 @@
+// Reads address ranges into memory a batch at the time on the main thread, so their bytes can be worked on
+// in parallel off it (the SDK isn't thread safe). Each range is split into pieces of up to SCAN_CHUNK_SIZE bytes.
+#pragma once
+#include <vector>
+
+struct SNAPSHOTPIECE
+{
+	size_t range;  // Index of its range, in the order added
+	ea_t ea;
+	size_t offset; // Into the snapshot
+	size_t size;
+	size_t initedSize; // Leading bytes that have values, like a segment's data before its bss tail
+	BOOL inited;   // All its bytes have values
+};
+
+class RangeSnapshot
+{
+public:
+	static const size_t BATCH_SIZE = (64 * 1024 * 1024);
+
+	RangeSnapshot() : m_range(0), m_ea(BADADDR), m_totalBytes(0), m_doneBytes(0), m_readTime(0.0) {}
+
+	// Add a range, pieces start at 'startEa' so it should be aligned for what's done with them
+	void Add(ea_t startEa, ea_t endEa);
+
+	// Read the next batch of pieces, FALSE when all the ranges are done.
+	// A range cut at the batch size continues in the next batch, its pieces stay in order.
+	BOOL ReadBatch();
+
+	const std::vector<SNAPSHOTPIECE> &Pieces() const { return m_pieces; }
+	const BYTE *Bytes(const SNAPSHOTPIECE &piece) const { return &m_buffer[piece.offset]; }
+
+	// Share of the range bytes read so far, 0 to 100
+	int Percent() const { return(m_totalBytes ? (int) ((m_doneBytes * 100) / m_totalBytes) : 100); }
+	TIMESTAMP ReadTime() const { return m_readTime; }
+
+private:
+	struct RANGE
+	{
+		ea_t startEa, endEa;
+	};
+	std::vector<RANGE> m_ranges;
+	size_t m_range; // Current range and address in it
+	ea_t m_ea;
+	std::vector<BYTE> m_buffer, m_mask;
+	std::vector<SNAPSHOTPIECE> m_pieces;
+	UINT64 m_totalBytes, m_doneBytes;
+	TIMESTAMP m_readTime;
+};
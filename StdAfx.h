@@ -31,4 +31,12 @@
 
 #include "Utility.h"
 
+// Compile in the per command telemetry (see "Telemetry.h")
+//#define UTILITY_TELEMETRY
+
+// From SDK "bytes.hpp"
+const UINT32 FF_REF  = 0x00001000; // has references
+const UINT32 FF_NAME = 0x00004000; // Has name ?
+const UINT32 FF_LABL = 0x00008000; // Has dummy name?
+
 #define MY_VERSION MAKE_SEMANTIC_VERSION(VERSION_RELEASE, 4, 0, 0)
\ No newline at end of file
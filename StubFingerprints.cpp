@@ -0,0 +1,134 @@
+// Cross database function fingerprints for the stub namer.
+// Exports the user named small functions' fingerprints, and keeps the file mapped for the stub namer's lookups.
+#include "StdAfx.h"
+#include "StubFingerprints.h"
+#include "StubPatterns.h"
+#include "IdaDatabase.h"
+#include "Telemetry.h"
+#include "Core/FuncClusters.h"
+#include <WaitBoxEx.h>
+#include <vector>
+
+static const char FINGERPRINT_FILE[] = "UtilityFeature_fingerprints.ufp";
+
+static FingerprintFile s_file;
+static BOOL s_triedOpen = FALSE; // Don't keep looking for a missing file, until the next export
+
+static qstring fingerprintPath()
+{
+	qstring path;
+	if (!qgetenv("UTILITY_FINGERPRINTS", &path) || path.empty())
+	{
+		path = get_user_idadir();
+		path.append("/");
+		path.append(FINGERPRINT_FILE);
+	}
+	return path;
+}
+
+void FingerprintsTerm()
+{
+	s_file.Close();
+	s_triedOpen = FALSE;
+}
+
+const FingerprintFile *FingerprintsOpen()
+{
+	if (!s_file.IsOpen() && !s_triedOpen)
+	{
+		s_triedOpen = TRUE;
+		qstring path = fingerprintPath();
+		if (qfileexist(path.c_str()))
+		{
+			TIMESTAMP startTime = GetTimeStamp();
+			std::string error;
+			if (s_file.Open(path.c_str(), error))
+			{
+				char buffer[32];
+				msg(" Fingerprints: %s from \"%s\", mapped in %s.\n", NumberCommaString(s_file.Count(), buffer), path.c_str(), TimeString(GetTimeStamp() - startTime));
+			}
+			else
+				msg("Utility: ** %s. **\n", error.c_str());
+		}
+	}
+	return(s_file.IsOpen() ? &s_file : NULL);
+}
+
+// ======================================================================================
+
+void ExportFingerprints()
+{
+	qstring path = fingerprintPath();
+	msg("Utility: Exporting function fingerprints to \"%s\":\n", path.c_str());
+	TIMESTAMP startTime = GetTimeStamp();
+	StubPatternsCompile(plat.is64);
+
+	// The user named small functions, but not the stubs, the patterns name those anyway
+	WaitBox::show("Utility", "Exporting fingerprints..");
+	IdaDatabase &db = LiveDatabase();
+	size_t funcCount = db.FunctionCount();
+	std::vector<FINGERPRINT> prints;
+	BYTE bytes[MAX_CLUSTER_BYTES];
+	qstring name;
+	for (size_t n = 0; n < funcCount; n++)
+	{
+		DBFUNCTION f = db.Function(n);
+		if (!IsCloneCandidate(f) || !has_user_name(get_flags(f.startEa)))
+			continue;
+		size_t size = (size_t) (f.endEa - f.startEa);
+		TELEMETRY_COUNT(TC_GET_BYTES);
+		if ((get_bytes(bytes, (ssize_t) size, f.startEa, GMB_READALL) != (ssize_t) size) ||
+			((size <= MAX_STUB_BYTES) && (StubPatternsMatch(bytes, size, f.startEa) != STUB_NO_MATCH)) ||
+			(get_name(&name, f.startEa, GN_NOT_DUMMY) <= 0))
+			continue;
+
+		UINT32 masked = MaskFixups(f.startEa, bytes, size);
+		FINGERPRINT print;
+		print.fingerprint = HashFunctionBytes(bytes, size);
+		print.size = (UINT32) size;
+		print.flags = (masked ? FPF_RELOCATED : 0);
+		print.name = name.c_str();
+		NormalizeFingerprintName(print);
+		prints.push_back(print);
+
+		if (WaitBox::isUpdateTime() && WaitBox::updateAndCancelCheck((int) ((n * 100) / funcCount)))
+		{
+			WaitBox::hide();
+			msg("* Export cancelled *\n");
+			return;
+		}
+	}
+	WaitBox::hide();
+	size_t exported = prints.size();
+
+	// This database's names win over the ones from before. The mapping has to be closed to replace the file.
+	s_file.Close();
+	s_triedOpen = FALSE;
+	size_t merged = 0;
+	if (qfileexist(path.c_str()))
+	{
+		FingerprintFile previous;
+		std::string error;
+		if (previous.Open(path.c_str(), error))
+		{
+			MergeFingerprints(previous, prints);
+			merged = (prints.size() - exported);
+		}
+		else
+			msg(" %s, replacing it.\n", error.c_str());
+	}
+
+	UINT32 written, ambiguous;
+	std::string error;
+	if (!WriteFingerprints(path.c_str(), prints, written, ambiguous, error))
+	{
+		msg("Utility: ** %s. **\n", error.c_str());
+		return;
+	}
+
+	char buffer[32];
+	msg(" %s named functions", NumberCommaString(exported, buffer));
+	msg(" plus %s from the file,", NumberCommaString(merged, buffer));
+	msg(" %s written", NumberCommaString(written, buffer));
+	msg(" (%s ambiguous dropped) in %s.\n", NumberCommaString(ambiguous, buffer), TimeString(GetTimeStamp() - startTime));
+}
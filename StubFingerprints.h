@@ -0,0 +1,13 @@
+// Cross database function fingerprints for the stub namer, see "Core/Fingerprints.h".
+// The file is "UtilityFeature_fingerprints.ufp" in the IDA user directory, shared by all the databases, or the
+// "UTILITY_FINGERPRINTS" environment variable path.
+#pragma once
+#include "Core/Fingerprints.h"
+
+void FingerprintsTerm();
+
+// The fingerprint file, memory mapped on first use and kept open. NULL if there's none.
+const FingerprintFile *FingerprintsOpen();
+
+// Add the user names of the small functions to the fingerprint file, merged with the ones already in it
+void ExportFingerprints();
@@ -0,0 +1,86 @@
+// Stub namer byte patterns.
+// The matcher is the core "StubClassifier", this loads its pattern text and logs the results.
+// Lines from the user's "UtilityFeature_stubs.cfg" (IDA "cfg" directory, or the user one) are added after the built-in ones.
+// See "Core/StubClassifier.cpp" for the pattern format.
+#include "StdAfx.h"
+#include "StubPatterns.h"
+#include "IdaDatabase.h"
+#include <string>
+#include <vector>
+
+static const char PATTERN_FILE[] = "UtilityFeature_stubs.cfg";
+
+static StubClassifier *s_classifier = NULL;
+
+// Parse pattern text, returns the count of patterns added. Bad lines are reported and skipped.
+static UINT parsePatterns(LPCSTR text, LPCSTR source)
+{
+	std::vector<std::string> errors;
+	UINT count = s_classifier->Parse(text, source, errors);
+	for (const std::string &error : errors)
+		msg("\n** Stub pattern %s **", error.c_str());
+	return count;
+}
+
+static BOOL readTextFile(LPCSTR path, std::string &text)
+{
+	FILE *fp = fopen(path, "rb");
+	if (!fp)
+		return FALSE;
+	fseek(fp, 0, SEEK_END);
+	long size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	text.resize((size > 0) ? size : 0);
+	BOOL result = (text.empty() || (fread(&text[0], text.size(), 1, fp) == 1));
+	fclose(fp);
+	return result;
+}
+
+void StubPatternsInit()
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	s_classifier = new StubClassifier();
+	UINT builtInCount = parsePatterns(STUB_BUILTIN_PATTERNS, "built-in");
+
+	char path[QMAXPATH];
+	std::string text;
+	if (getsysfile(path, sizeof(path), PATTERN_FILE, CFG_SUBDIR) && readTextFile(path, text))
+	{
+		UINT userCount = parsePatterns(text.c_str(), path);
+		msg("\n Stub patterns: %u built-in, %u from \"%s\", loaded in %s.", builtInCount, userCount, path, TimeString(GetTimeStamp() - startTime));
+	}
+	else
+		msg("\n Stub patterns: %u built-in, loaded in %s.", builtInCount, TimeString(GetTimeStamp() - startTime));
+}
+
+void StubPatternsTerm()
+{
+	delete s_classifier;
+	s_classifier = NULL;
+}
+
+void StubPatternsCompile(BOOL is64)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	s_classifier->SetImports(LiveDatabase());
+	if (!s_classifier->Compile(is64 != FALSE))
+		return;
+
+	char buffer[32];
+	msg(" Compiled %s %ubit stub signatures into %u buckets in %s.\n", NumberCommaString(s_classifier->SigCount(), buffer), (is64 ? 64 : 32), (UINT) s_classifier->BucketCount(), TimeString(GetTimeStamp() - startTime));
+}
+
+int StubPatternsMatch(const BYTE *bytes, size_t size, ea_t ea)
+{
+	return s_classifier->Match(bytes, size, ea);
+}
+
+UINT StubPatternsPrefixCount()
+{
+	return s_classifier->PrefixCount();
+}
+
+LPCSTR StubPatternsPrefix(UINT index)
+{
+	return s_classifier->Prefix(index);
+}
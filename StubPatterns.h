@@ -0,0 +1,19 @@
+// Stub namer byte patterns.
+// The built-in set plus the user's "UtilityFeature_stubs.cfg", compiled into a hashed matcher per database bitness.
+#pragma once
+#include "Core/StubClassifier.h"
+
+void StubPatternsInit();
+void StubPatternsTerm();
+
+// Compile the patterns for the database bitness, only does work if it changed since the last call.
+// The import segments for the thunk patterns are refreshed every call.
+void StubPatternsCompile(BOOL is64);
+
+// Return the name prefix index of the first pattern that matches the bytes of the function at 'ea' exactly, or STUB_NO_MATCH.
+// Thread safe between compiles.
+int StubPatternsMatch(const BYTE *bytes, size_t size, ea_t ea);
+
+// Stub name prefixes, like "zeroSub_", in the order they first appear in the patterns
+UINT StubPatternsPrefixCount();
+LPCSTR StubPatternsPrefix(UINT index);
@@ -3,257 +3,796 @@
 // Formerly the "IDA_StubNamer_PlugIn" 
 // By: Sirmabus 2009, updated 1/2025
 #include "StdAfx.h"
+#include "StubRenamer.h"
+#include "StubPatterns.h"
+#include "StubFingerprints.h"
+#include "IdaDatabase.h"
+#include "Core/FuncClusters.h"
 #include <WaitBoxEx.h>
+#include "ThreadPool.h"
+#include "Telemetry.h"
 #include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
 
-#define MAX_PATTERN_LINES 2
+// Stubs named this run, per pattern name prefix
+static std::vector<UINT> s_namedCounts;
+static UINT s_fingerprintNamed; // And functions named from the fingerprint file
 
-// Text pattern container
-struct PATERN
+// ======================================================================================
+
+// Used serial numbers of a stub name prefix
+struct NAMESLOTS
 {
-	LPCSTR* patern; // ASM text line(s) of the pattern
-	int     count;  // Count of lines text lines
-	PUINT   pcount; // Ref to track stats
-	LPCSTR  format; // Stub name format text
+	std::vector<UINT64> used; // Bitmap of taken numbers
+	UINT next;                // All below are taken
+
+	NAMESLOTS() : next(0) {}
+
+	void mark(UINT number)
+	{
+		size_t word = (number >> 6);
+		if (word >= used.size())
+			used.resize(word + 1);
+		used[word] |= (1ull << (number & 63));
+	}
+
+	// Take the lowest free number, amortized O(1) since 'next' only moves up
+	UINT allocate()
+	{
+		UINT number = (UINT) (used.size() << 6);
+		for (size_t word = (next >> 6); word < used.size(); word++)
+		{
+			UINT64 freeBits = ~used[word];
+			if (word == (next >> 6))
+				freeBits &= (~0ull << (next & 63));
+			if (freeBits)
+			{
+				DWORD bit;
+				_BitScanForward64(&bit, freeBits);
+				number = (UINT) ((word << 6) + bit);
+				break;
+			}
+		}
+		mark(number);
+		next = (number + 1);
+		return number;
+	}
 };
-typedef std::vector<PATERN> PATTERNS;
+static std::map<std::string, NAMESLOTS> s_nameSlots;
+static BOOL s_nameIndexBuilt = FALSE; // Built on the first run, then kept current from rename events
 
-static UINT s_zeroIndex = 0, s_falseIndex = 0, s_TRUEIndex = 0, s_trueIndex = 0, s_fzeroIndex = 0, s_nullIndex = 0;
-#define TOTAL_NAMES_STATS (s_zeroIndex + s_falseIndex + s_TRUEIndex + s_trueIndex + s_nullIndex)
+static bool idaapi isNamedFlags(flags64_t flags, void *ud) { return has_name(flags); }
 
-/*
-	Patterns:
+// Split a "prefix_N" name, returns FALSE if it's not of that form
+static BOOL parseStubName(LPCSTR name, std::string &prefix, UINT &number)
+{
+	LPCSTR digits = strrchr(name, '_');
+	if (!digits || !isdigit((BYTE) digits[1]) || ((digits[1] == '0') && digits[2]))
+		return FALSE;
+	digits++;
+
+	char *end;
+	unsigned long value = strtoul(digits, &end, 10);
+	if (*end || (value > UINT_MAX))
+		return FALSE;
+
+	prefix.assign(name, (digits - name));
+	number = (UINT) value;
+	return TRUE;
+}
 
-	return(NULL)/return(0)/return(FALSE)
-	return(false)
-	return(TRUE)
-	return(true)
+// Mark the number of a "prefix_N" name as used if it's one of ours
+static void markStubName(LPCSTR name)
+{
+	std::string prefix;
+	UINT number;
+	if (parseStubName(name, prefix, number))
+	{
+		auto it = s_nameSlots.find(prefix);
+		if (it != s_nameSlots.end())
+			it->second.mark(number);
+	}
+}
+
+// Collect the stub names already in the database, and those of any other serial prefix in use (from the fingerprints).
+// They're set SN_NOLIST so they're not in the name list, it takes a sweep over all the named addresses.
+static void BuildNameIndex()
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	for (auto &it : s_nameSlots)
+		it.second = NAMESLOTS();
+	for (UINT i = 0; i < StubPatternsPrefixCount(); i++)
+		s_nameSlots[StubPatternsPrefix(i)];
+
+	UINT nameCount = 0;
+	ea_t maxEa = inf_get_max_ea();
+	ea_t ea = inf_get_min_ea();
+	if (!has_name(get_flags(ea)))
+		ea = next_that(ea, maxEa, isNamedFlags);
+	qstring name;
+	while (ea != BADADDR)
+	{
+		if (get_name(&name, ea, GN_NOT_DUMMY) > 0)
+			markStubName(name.c_str());
+		nameCount++;
+		ea = next_that(ea, maxEa, isNamedFlags);
+	}
+	TELEMETRY_COUNT(TC_GET_FLAGS);
+	TELEMETRY_ADD(TC_NEXT_THAT, (nameCount + 1));
+	TELEMETRY_ADD(TC_ADDRESSES, (maxEa - inf_get_min_ea()));
 
-	return((float) 0)
-*/
+	s_nameIndexBuilt = TRUE;
+	char buffer[32];
+	msg(" Name index: %s names swept in %s.\n", NumberCommaString(nameCount, buffer), TimeString(GetTimeStamp() - startTime));
+}
 
-// TODO: (Big) Make a batch Python script and run it over a corpus of IDBs both 32 and 64 bit
 
+// Snapshot of the candidate functions, structure of arrays so the classification pass streams through it
+struct FUNCTABLE
+{
+	std::vector<ea_t> starts;
+	std::vector<BYTE> sizes;
+	std::vector<BYTE> bytes;          // MAX_STUB_BYTES per function
+	std::vector<int> matches;         // Name prefix index or STUB_NO_MATCH
 
-static void processFunction(func_t *f, PATTERNS &patterns);
+	size_t size() const { return starts.size(); }
+};
 
-// Build text disasm search patterns
-static void BuildPatterns(PATTERNS &patterns)
+static BOOL setStubName(ea_t ea, UINT prefix);
+static BOOL setSerialName(ea_t ea, LPCSTR prefix);
+
+// Progress is split over the snapshot and the rename passes
+static BOOL progressCancelCheck(UINT n, UINT count, int base)
 {
-	// Return 0/NULL/FALSE
-	static const LPCSTR retZero_32[] =
-	{
-		"xor     eax, eax",
-		"sub     eax, eax",
-		"mov     eax, 0",
-		"mov     ax, 0",				
-	};
-	static const LPCSTR retZero_64[] =
-	{				
-		"xor     rax, rax",
-		"sub     rax, rax",
-		"mov     rax, 0",				
-	};
-
-	// Return bool false
-	static const LPCSTR retFalse[] =
+	if ((n % 1000) == 0)
 	{
-		"xor     al, al",
-		"sub     al, al",
-		"mov     al, 0",
-	};
+		if (WaitBox::isUpdateTime())
+		{
+			if (WaitBox::updateAndCancelCheck(base + (int) (((float) n / (float) count) * 50.0f)))
+			{
+				msg("* Aborted *\n");
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
 
-	// Return BOOL TRUE
-	static const LPCSTR retTRUE_32[] =
-	{
-		"mov     eax, 1",			
-	};
-	static const LPCSTR retTRUE_64[] =
-	{			
-		"mov     rax, 1",				
-	};
-
-	// Return bool true
-	static const LPCSTR retTrue[] =
+// Add the function to the table if it could be a stub
+static void addCandidate(FUNCTABLE &table, func_t *f, BOOL skipNamed)
+{
+	// Quick rejection test
+	if (IsStubCandidate(IdaDatabase::ToFunction(f))
+		/* Skip if already has a name */
+		&& !(skipNamed && has_name(get_flags(f->start_ea)))
+		)
 	{
-		"mov     al, 1",
-	};
+		size_t index = table.bytes.size();
+		table.bytes.resize(index + MAX_STUB_BYTES);
+		BYTE size = (BYTE) f->size();
+		TELEMETRY_COUNT(TC_GET_BYTES);
+		TELEMETRY_ADD(TC_ADDRESSES, size);
+		if (get_bytes(&table.bytes[index], size, f->start_ea) == (ssize_t) size)
+		{
+			table.starts.push_back(f->start_ea);
+			table.sizes.push_back(size);
+		}
+		else
+			table.bytes.resize(index);
+	}
+}
 
-	// Return floating point zero
-	static const LPCSTR retFZero_32[] =
+// Classify the table in parallel, no SDK calls
+static void classifyTable(FUNCTABLE &table)
+{
+	table.matches.resize(table.size());
+	ParallelFor(table.size(), 4096, [&table](size_t begin, size_t end)
 	{
-		"fldz",				
-	};
-	static const LPCSTR retFZero_64[] =
-	{			
-		"psrldq  xmm0, 0",
-	};
-	
-	patterns.push_back({ (LPCSTR*) retTrue,  _countof(retTrue),  &s_trueIndex,  "trueSub_%u" });
-	patterns.push_back({ (LPCSTR*) retFalse, _countof(retFalse), &s_falseIndex, "falseSub_%u" });
-
-	if (!plat.is64)
+		for (size_t i = begin; i < end; i++)
+			table.matches[i] = StubPatternsMatch(&table.bytes[i * MAX_STUB_BYTES], table.sizes[i], table.starts[i]);
+	});
+}
+
+// In debug builds cross check the byte matcher against the original disassembly text patterns, for the built-in stubs
+#ifdef _DEBUG
+#define STUB_TEXT_CHECK
+#endif
+
+#ifdef STUB_TEXT_CHECK
+struct TEXTPATTERN
+{
+	LPCSTR prefix;
+	UINT bits;       // 32, 64, or 0 for either
+	LPCSTR text[4];  // First instruction lines, the second has to be a return
+};
+static const TEXTPATTERN s_textPatterns[] =
+{
+	{ "trueSub_",  0,  { "mov     al, 1" } },
+	{ "falseSub_", 0,  { "xor     al, al", "sub     al, al", "mov     al, 0" } },
+	{ "zeroSub_",  32, { "xor     eax, eax", "sub     eax, eax", "mov     eax, 0", "mov     ax, 0" } },
+	{ "zeroSub_",  64, { "xor     rax, rax", "sub     rax, rax", "mov     rax, 0" } },
+	{ "trueSub_",  32, { "mov     eax, 1" } },
+	{ "trueSub_",  64, { "mov     rax, 1" } },
+	{ "fZeroSub_", 32, { "fldz" } },
+	{ "fZeroSub_", 64, { "psrldq  xmm0, 0" } },
+};
+static const char NULL_STUB_PREFIX[] = "nullSub_";
+
+// Return TRUE if the prefix is one the text patterns know
+static BOOL isTextChecked(LPCSTR prefix)
+{
+	if (!prefix)
+		return FALSE;
+	if (strcmp(prefix, NULL_STUB_PREFIX) == 0)
+		return TRUE;
+	for (const TEXTPATTERN &tp : s_textPatterns)
 	{
-		// 32bit
-		patterns.push_back({ (LPCSTR*) retZero_32,  _countof(retZero_32),  &s_zeroIndex,  "zeroSub_%u" });
-		patterns.push_back({ (LPCSTR*) retTRUE_32,  _countof(retTRUE_32),  &s_TRUEIndex,  "trueSub_%u" });
-		patterns.push_back({ (LPCSTR*) retFZero_32, _countof(retFZero_32), &s_fzeroIndex, "fZeroSub_%u" });
+		if (strcmp(prefix, tp.prefix) == 0)
+			return TRUE;
 	}
-	else
+	return FALSE;
+}
+
+// Return TRUE if address is a return opcode
+static BOOL isReturn(ea_t ea)
+{
+	insn_t cmd;
+	TELEMETRY_COUNT(TC_DECODE_INSN);
+	if ((decode_insn(&cmd, ea) > 0) && (cmd.size != 0))
+		return((cmd.itype == NN_retn) || (cmd.itype == NN_retf));
+	return FALSE;
+}
+
+// The original text matcher over the rendered instructions, returns the name prefix or NULL for none
+static LPCSTR matchText(ea_t startEa, ea_t endEa, UINT bits)
+{
+	ea_t second = next_head(startEa, endEa);
+	if (second == BADADDR)
+		return(isReturn(startEa) ? NULL_STUB_PREFIX : NULL);
+	if ((next_head(second, endEa) != BADADDR) || !isReturn(second))
+		return NULL;
+
+	qstring str;
+	getDisasmText(startEa, str);
+	for (const TEXTPATTERN &tp : s_textPatterns)
 	{
-		// 64bit
-		patterns.push_back({ (LPCSTR*) retZero_64,  _countof(retZero_64),  &s_zeroIndex,  "zeroSub_%u" });
-		patterns.push_back({ (LPCSTR*) retTRUE_64,  _countof(retTRUE_64),  &s_TRUEIndex,  "trueSub_%u" });
-		patterns.push_back({ (LPCSTR*) retFZero_64, _countof(retFZero_64), &s_fzeroIndex, "fZeroSub_%u" });
+		if (tp.bits && (tp.bits != bits))
+			continue;
+		for (LPCSTR text : tp.text)
+		{
+			if (text && (strcmp(str.c_str(), text) == 0))
+				return tp.prefix;
+		}
 	}
+	return NULL;
 }
 
+// Report the candidates where the byte match and the text match of a built-in stub disagree
+static void textCheckTable(const FUNCTABLE &table)
+{
+	UINT bits = (plat.is64 ? 64 : 32);
+	for (size_t i = 0; i < table.size(); i++)
+	{
+		LPCSTR bytePrefix = ((table.matches[i] != STUB_NO_MATCH) ? StubPatternsPrefix(table.matches[i]) : NULL);
+		LPCSTR textPrefix = matchText(table.starts[i], (table.starts[i] + table.sizes[i]), bits);
+		if (!textPrefix && !isTextChecked(bytePrefix))
+			continue;
+		if (!textPrefix || !bytePrefix || (strcmp(textPrefix, bytePrefix) != 0))
+			msg("%llX ** Stub byte match (%s) and text pattern (%s) mismatch ** <Click Me>\n", table.starts[i], (bytePrefix ? bytePrefix : "none"), (textPrefix ? textPrefix : "none"));
+	}
+}
+#endif
 
-void RunStubNamer()
+// Commit the names on the main thread, returns FALSE if canceled
+static BOOL renameTable(FUNCTABLE &table, BOOL showProgress)
 {
-	WaitBox::show();
-	try
+	UINT candidateCount = (UINT) table.size();
+	for (UINT i = 0; i < candidateCount; i++)
 	{
-		// First build up patterns
-		PATTERNS patterns;
-		BuildPatterns(patterns);
+		if (table.matches[i] != STUB_NO_MATCH)
+			setStubName(table.starts[i], table.matches[i]);
 
-		// Iterate through all functions..
-		TIMESTAMP startTime = GetTimeStamp();
-		UINT funcCount = (UINT)get_func_qty();
-		char buffer[32];
-		msg(" Processing %s functions:\n", NumberCommaString(funcCount, buffer));
+		if (showProgress && progressCancelCheck(i, candidateCount, 50))
+			return FALSE;
+	}
+	return TRUE;
+}
 
-		for (UINT n = 0; n < funcCount; n++)
+// An entry's serial name prefix, returns FALSE if it's a plain name.
+// A relocated entry's plain name becomes a "name_" prefix, its copies can call or refer to different things.
+static BOOL fingerprintPrefix(const FingerprintFile &prints, const FPENTRY &entry, std::string &prefix)
+{
+	prefix = prints.Name(entry);
+	if (entry.flags & FPF_SERIAL)
+		return TRUE;
+	if (entry.flags & FPF_RELOCATED)
+	{
+		prefix += '_';
+		return TRUE;
+	}
+	return FALSE;
+}
+
+// Name the small functions still unnamed after the patterns from the fingerprint file.
+// Snapshot them with their fixups zeroed, hash and look up in parallel (the mapping is read only), then name.
+// The named candidates are hashed too, a plain name is only given if its fingerprint matches a single function.
+static void nameFromFingerprints(std::vector<func_t*> &funcs, const FingerprintFile &prints)
+{
+	CLONETABLE table;
+	std::vector<ea_t> starts;
+	std::vector<BYTE> named; // Per snapshot function, it already has a name
+	BYTE bytes[MAX_CLUSTER_BYTES];
+	for (func_t *f : funcs)
+	{
+		DBFUNCTION func = IdaDatabase::ToFunction(f);
+		if (!IsCloneCandidate(func))
+			continue;
+		size_t size = (size_t) (func.endEa - func.startEa);
+		TELEMETRY_COUNT(TC_GET_FLAGS);
+		TELEMETRY_COUNT(TC_GET_BYTES);
+		TELEMETRY_ADD(TC_ADDRESSES, size);
+		if (get_bytes(bytes, (ssize_t) size, func.startEa) == (ssize_t) size)
 		{
-			processFunction(getn_func(n), patterns);
+			MaskFixups(func.startEa, table.Add(bytes, size), size);
+			starts.push_back(func.startEa);
+			named.push_back(has_name(get_flags(func.startEa)));
+		}
+	}
 
-			if (n % 1000)
-			{
-				if (WaitBox::isUpdateTime())
-				{
-					if (WaitBox::updateAndCancelCheck((int)(((float)n / (float)funcCount) * 100.0f)))
-					{
-						msg("* Aborted *\n");
-						break;
-					}
-				}
-			}
+	std::vector<const FPENTRY*> found(table.Count());
+	table.hashes.resize(table.Count());
+	ParallelFor(table.Count(), 4096, [&](size_t begin, size_t end)
+	{
+		table.Hash(begin, end);
+		for (size_t i = begin; i < end; i++)
+			found[i] = prints.Find(table.hashes[i], (UINT32) table.Size(i));
+	});
+
+	// Count the matches of each entry. A serial prefix has to be in the name index before its first use.
+	std::map<const FPENTRY*, UINT32> matches;
+	std::string prefix;
+	BOOL newPrefix = FALSE;
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		const FPENTRY *entry = found[i];
+		if (!entry)
+			continue;
+		matches[entry]++;
+		if (!named[i] && fingerprintPrefix(prints, *entry, prefix) && (s_nameSlots.find(prefix) == s_nameSlots.end()))
+		{
+			s_nameSlots[prefix];
+			newPrefix = TRUE;
 		}
+	}
+	if (newPrefix)
+		BuildNameIndex();
 
-		msg("Done. Named %s stub functions in %s.\n", NumberCommaString(TOTAL_NAMES_STATS, buffer), TimeString(GetTimeStamp() - startTime));
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		const FPENTRY *entry = found[i];
+		if (!entry || named[i] || !prints.Name(*entry)[0])
+			continue;
+		if (fingerprintPrefix(prints, *entry, prefix))
+			s_fingerprintNamed += setSerialName(starts[i], prefix.c_str());
+		else
+		if (matches[entry] == 1)
+		{
+			TELEMETRY_COUNT(TC_SET_NAME);
+			if (set_name(starts[i], prints.Name(*entry), (SN_NON_AUTO | SN_NOWARN)))
+				s_fingerprintNamed++;
+		}
 	}
-	CATCH();
-	WaitBox::hide();
 }
 
+static void resetStats()
+{
+	s_namedCounts.assign(StubPatternsPrefixCount(), 0);
+	s_fingerprintNamed = 0;
+}
+
+static UINT totalNamed()
+{
+	UINT total = 0;
+	for (UINT count : s_namedCounts)
+		total += count;
+	return total;
+}
 
 // ======================================================================================
 
-// Return TRUE if address matches pattern
-BOOL isOfPatern(LPCSTR lineStr, LPCSTR* pattern, int patternCount)
+// Incremental mode.
+// After the first full run on a database the function starts touched by add/resize/rename events are tracked
+// in a persisted dirty set, and only those get processed on demand or when auto-analysis goes idle.
+
+static const char NETNODE_NAME[] = "$ utilityfeature.stubnamer";
+static const uchar BLOB_TAG = 'D';
+
+static std::vector<ea_t> s_dirtyFuncs; // Unsorted with duplicates until compacted
+static size_t s_compactSize = 0;       // Dirty set size after the last compact
+static BOOL s_tracking = FALSE;        // The full namer has run on this database
+static BOOL s_loaded = FALSE;          // Persisted state loaded for the current database
+static BOOL s_changed = FALSE;         // Persisted state changed since the last save
+static BOOL s_naming = FALSE;          // Our own renames in progress
+
+static void compactDirty()
 {
-	for (int i = 0; i < patternCount; i++)
+	std::sort(s_dirtyFuncs.begin(), s_dirtyFuncs.end());
+	s_dirtyFuncs.erase(std::unique(s_dirtyFuncs.begin(), s_dirtyFuncs.end()), s_dirtyFuncs.end());
+	s_compactSize = s_dirtyFuncs.size();
+}
+
+static void saveState()
+{
+	netnode node(NETNODE_NAME, 0, true);
+	node.altset(0, s_tracking);
+	node.delblob(0, BLOB_TAG);
+	s_changed = FALSE;
+	if (s_tracking && !s_dirtyFuncs.empty())
 	{
-		if (strcmp(lineStr, pattern[i]) == 0)
-			return(TRUE);
+		compactDirty();
+		std::vector<UINT64> blob(s_dirtyFuncs.begin(), s_dirtyFuncs.end());
+		node.setblob(blob.data(), (blob.size() * sizeof(UINT64)), 0, BLOB_TAG);
 	}
-	return(FALSE);
 }
 
-// Return TRUE if address is a return opcode
-BOOL isReturn(ea_t ea)
+static void loadState()
 {
-	insn_t cmd;
-	if ((decode_insn(&cmd, ea) > 0) && (cmd.size != 0))
+	s_loaded = TRUE;
+	netnode node(NETNODE_NAME);
+	if (node == BADNODE)
+		return;
+	s_tracking = (node.altval(0) != 0);
+
+	bytevec_t blob;
+	if (s_tracking && (node.getblob(&blob, 0, BLOB_TAG) > 0))
 	{
-		if ((cmd.itype == NN_retn) || (cmd.itype == NN_retf))
-			return TRUE;
+		const UINT64 *p = (const UINT64 *) blob.begin();
+		size_t count = (blob.size() / sizeof(UINT64));
+		for (size_t i = 0; i < count; i++)
+			s_dirtyFuncs.push_back((ea_t) p[i]);
+		s_compactSize = s_dirtyFuncs.size();
 	}
-	return FALSE;
 }
 
+static void resetState()
+{
+	s_dirtyFuncs.clear();
+	s_compactSize = 0;
+	s_tracking = s_loaded = s_changed = s_naming = FALSE;
+	s_nameSlots.clear();
+	s_nameIndexBuilt = FALSE;
+}
 
-// Process function
-static void processFunction(func_t* f, PATTERNS &patterns)
+static void markDirty(ea_t ea)
 {
-	// Quick rejection test
-	if (f->does_return() && !is_func_tail(f) && (f->size() <= 10)
-		/* Skip if already has a name */
-		&& !has_name(get_flags(f->start_ea))
-		)
+	if (!s_loaded)
+		loadState();
+	if (!s_tracking)
+		return;
+
+	s_dirtyFuncs.push_back(ea);
+	s_changed = TRUE;
+
+	// Rename events come in floods, keep the duplicates in check
+	if (s_dirtyFuncs.size() >= std::max((s_compactSize * 2), (size_t) 0x10000))
+		compactDirty();
+}
+
+// ======================================================================================
+
+// Snapshot, classify and name a table. Returns the count named, or -1 if canceled.
+static int runTable(std::vector<func_t*> &funcs, BOOL showProgress, STUBNAMERSTATS *stats = NULL)
+{
+	TIMESTAMP compileTime = GetTimeStamp();
+	StubPatternsCompile(plat.is64);
+	TIMESTAMP startTime = GetTimeStamp();
+	resetStats();
+
+	// 1) Snapshot the candidates and their bytes, the SDK is only safe to use from the main thread
+	FUNCTABLE table;
+	UINT funcCount = (UINT) funcs.size();
+	for (UINT n = 0; n < funcCount; n++)
+	{
+		addCandidate(table, funcs[n], TRUE);
+		if (showProgress && progressCancelCheck(n, funcCount, 0))
+			return -1;
+	}
+	TIMESTAMP snapshotTime = GetTimeStamp();
+
+	// 2) Classify in parallel
+	classifyTable(table);
+	TIMESTAMP classifyTime = GetTimeStamp();
+	#ifdef STUB_TEXT_CHECK
+	textCheckTable(table);
+	#endif
+
+	// 3) Name them
+	if (!s_nameIndexBuilt)
+		BuildNameIndex();
+	TIMESTAMP nameIndexTime = GetTimeStamp();
+	s_naming = TRUE;
+	BOOL completed = renameTable(table, showProgress);
+	TIMESTAMP endTime = GetTimeStamp();
+
+	// 4) Carry the names over from other databases
+	const FingerprintFile *prints = (completed ? FingerprintsOpen() : NULL);
+	if (prints)
+		nameFromFingerprints(funcs, *prints);
+	s_naming = FALSE;
+	TIMESTAMP fingerprintTime = GetTimeStamp();
+
+	if (showProgress)
+	{
+		char buffer[32];
+		msg(" Snapshot: %s candidates in %s, classify: %s, rename: %s.\n", NumberCommaString(table.size(), buffer), TimeString(snapshotTime - startTime), TimeString(classifyTime - snapshotTime), TimeString(endTime - nameIndexTime));
+		if (prints)
+			msg(" Fingerprints: %s named in %s.\n", NumberCommaString(s_fingerprintNamed, buffer), TimeString(fingerprintTime - endTime));
+	}
+
+	if (stats)
+	{
+		stats->functions = funcCount;
+		stats->candidates = (UINT) table.size();
+		stats->named = totalNamed();
+		stats->prefixes.clear();
+		for (UINT i = 0; i < (UINT) s_namedCounts.size(); i++)
+			stats->prefixes.push_back(std::make_pair(std::string(StubPatternsPrefix(i)), s_namedCounts[i]));
+		stats->compileTime = (startTime - compileTime);
+		stats->snapshotTime = (snapshotTime - startTime);
+		stats->classifyTime = (classifyTime - snapshotTime);
+		stats->nameIndexTime = (nameIndexTime - classifyTime);
+		stats->renameTime = (endTime - nameIndexTime);
+		stats->fingerprintNamed = s_fingerprintNamed;
+		stats->fingerprintTime = (fingerprintTime - endTime);
+	}
+	return(completed ? (int) (totalNamed() + s_fingerprintNamed) : -1);
+}
+
+void RunStubNamer(BOOL headless, STUBNAMERSTATS *stats)
+{
+	if (!headless)
+		WaitBox::show();
+	try
 	{
-		// 1st pass, check if less than MAX_PATTERN_LINES and the last instruction is a return
-		int instLines = 0;
+		if (!s_loaded)
+			loadState();
+
+		TIMESTAMP startTime = GetTimeStamp();
+		UINT funcCount = (UINT)get_func_qty();
+		char buffer[32];
+		msg(" Processing %s functions:\n", NumberCommaString(funcCount, buffer));
+
+		std::vector<func_t*> funcs;
+		funcs.reserve(funcCount);
+		for (UINT n = 0; n < funcCount; n++)
+			funcs.push_back(getn_func(n));
+
+		// A full run always rebuilds the name index
+		s_nameIndexBuilt = FALSE;
+		int named = runTable(funcs, !headless, stats);
+		if (named >= 0)
 		{
-			ea_t currentEA = f->start_ea;
-			ea_t endEA = f->end_ea;
-			ea_t lastEa = BADADDR;
+			// Everything is current now, track changes from here on
+			s_dirtyFuncs.clear();
+			s_compactSize = 0;
+			s_tracking = s_changed = TRUE;
+			msg("Done. Named %s functions in %s.\n", NumberCommaString(named, buffer), TimeString(GetTimeStamp() - startTime));
+		}
+		if (stats)
+			stats->totalTime = (GetTimeStamp() - startTime);
+	}
+	CATCH();
+	if (!headless)
+		WaitBox::hide();
+}
 
-			while ((instLines <= MAX_PATTERN_LINES) && (currentEA != BADADDR) && (currentEA < endEA))
-			{
-				instLines++;
-				lastEa = currentEA;
-				currentEA = next_head(currentEA, endEA);
-			};
+// Process the dirty functions only
+void RunStubNamerDirty(BOOL quiet)
+{
+	try
+	{
+		if (!s_loaded)
+			loadState();
+		if (!s_tracking)
+		{
+			if (!quiet)
+				msg(" Incremental mode starts after the first full stub namer run on this database.\n");
+			return;
+		}
+
+		TIMESTAMP startTime = GetTimeStamp();
+		compactDirty();
+		std::vector<func_t*> funcs;
+		for (ea_t ea : s_dirtyFuncs)
+		{
+			func_t *f = get_func(ea);
+			if (f && (f->start_ea == ea))
+				funcs.push_back(f);
+		}
+		UINT dirtyCount = (UINT) s_dirtyFuncs.size();
+
+		int named = runTable(funcs, FALSE);
+		s_dirtyFuncs.clear();
+		s_compactSize = 0;
+		s_changed = TRUE;
+
+		if (!quiet || (named > 0))
+		{
+			char buffer[32], buffer2[32];
+			msg("Utility: Stub namer, %s dirty functions, named %s in %s.\n", NumberCommaString(dirtyCount, buffer), NumberCommaString(named, buffer2), TimeString(GetTimeStamp() - startTime));
+		}
+	}
+	CATCH();
+}
 
-			if ((instLines <= MAX_PATTERN_LINES) && (instLines > 0))
+// Full classification without renaming, compared against the names in the database.
+// Any function a full run would still name was missed by the incremental mode.
+void VerifyStubNamer()
+{
+	WaitBox::show();
+	try
+	{
+		StubPatternsCompile(plat.is64);
+		TIMESTAMP startTime = GetTimeStamp();
+		FUNCTABLE table;
+		UINT funcCount = (UINT) get_func_qty();
+		for (UINT n = 0; n < funcCount; n++)
+		{
+			addCandidate(table, getn_func(n), FALSE);
+			if (progressCancelCheck(n, funcCount, 0))
 			{
-				if (!isReturn(lastEa))
-					return;
-			}
-			else
+				WaitBox::hide();
 				return;
+			}
 		}
+		classifyTable(table);
 
-		// Two line patterns
-		if (instLines == MAX_PATTERN_LINES)
+		UINT missed = 0, stale = 0;
+		qstring name;
+		std::string prefix;
+		for (size_t i = 0; i < table.size(); i++)
 		{
-			// Try each pattern against the line
-			qstring str;
-			getDisasmText(f->start_ea, str);
-			LPCSTR lineStr = str.c_str();
-			size_t patternCount = patterns.size();
-			for (size_t i = 0; i < patternCount; i++)
+			ea_t ea = table.starts[i];
+			int match = table.matches[i];
+			LPCSTR expected = ((match != STUB_NO_MATCH) ? StubPatternsPrefix(match) : NULL);
+
+			TELEMETRY_COUNT(TC_GET_FLAGS);
+			if (!has_name(get_flags(ea)))
 			{
-				ea_t currentEA = f->start_ea;
-				if (isOfPatern(lineStr, patterns[i].patern, patterns[i].count))
+				if (expected)
 				{
-					// Create name
-					// Normally starts at the last count, but serialize until we find one not used
-					// if we have to.					
-					LPCSTR format = patterns[i].format;
-					UINT   startSeq = *patterns[i].pcount;
-					char name[32]; name[SIZESTR(name)] = 0;
-					for (UINT j = startSeq; j < 0xFFFF; j++)
+					if (++missed <= 50)
+						msg("%llX missed \"%s\" stub <Click Me>\n", ea, expected);
+				}
+			}
+			else
+			{
+				// Ours, but no longer matching its pattern?
+				UINT number;
+				if ((get_name(&name, ea, GN_NOT_DUMMY) > 0) && parseStubName(name.c_str(), prefix, number))
+				{
+					BOOL isStubPrefix = FALSE;
+					for (UINT j = 0; j < StubPatternsPrefixCount(); j++)
+						isStubPrefix |= (prefix == StubPatternsPrefix(j));
+					if (isStubPrefix && (!expected || (prefix != expected)))
 					{
-						sprintf(name, format, j);
-						if (set_name(f->start_ea, name, (SN_NON_AUTO | SN_NOLIST | SN_NOWARN)))
-						{
-							*patterns[i].pcount += 1;
-							return;
-						}
+						if (++stale <= 50)
+							msg("%llX stub name \"%s\" no longer matches <Click Me>\n", ea, name.c_str());
 					}
-
-					msg("%llX ** Failed to set stub name: \"%s\" ** <Click Me>\n", f->start_ea, name);
-					return;
 				}
 			}
 		}
-		else
-		// Do nothing return stub?
-		if (instLines == 1)
+
+		char buffer[32], buffer2[32], buffer3[32];
+		msg("Verify: %s candidates, %s missed, %s stale, in %s.\n", NumberCommaString(table.size(), buffer), NumberCommaString(missed, buffer2), NumberCommaString(stale, buffer3), TimeString(GetTimeStamp() - startTime));
+		if (missed == 0)
+			msg(" Same result as a full run.\n");
+	}
+	CATCH();
+	WaitBox::hide();
+}
+
+// ======================================================================================
+
+// Track the functions that need another look
+struct stubnamer_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
 		{
-			char name[32]; name[SIZESTR(name)] = 0;
-			for (UINT i = 0; i < 0xFFFF; i++)
+			case idb_event::func_added:
+			case idb_event::func_updated:
+			markDirty(va_arg(va, func_t*)->start_ea);
+			break;
+
+			case idb_event::set_func_start:
+			{
+				va_arg(va, func_t*);
+				markDirty(va_arg(va, ea_t));
+			}
+			break;
+
+			case idb_event::set_func_end:
+			markDirty(va_arg(va, func_t*)->start_ea);
+			break;
+
+			case idb_event::renamed:
 			{
-				sprintf(name, "nullSub_%u", i);
-				if (set_name(f->start_ea, name, (SN_NON_AUTO | SN_NOLIST | SN_NOWARN)))
+				ea_t ea = va_arg(va, ea_t);
+				LPCSTR newName = va_arg(va, LPCSTR);
+				if (!s_naming)
 				{
-					s_nullIndex++;
-					return;
+					if (s_nameIndexBuilt && newName && newName[0])
+						markStubName(newName);
+					markDirty(ea);
 				}
 			}
-		}
+			break;
+
+			case idb_event::auto_empty_finally:
+			if (s_tracking && !s_dirtyFuncs.empty())
+			{
+				plat.Configure();
+				RunStubNamerDirty(TRUE);
+			}
+			break;
+
+			case idb_event::savebase:
+			if (s_changed)
+				saveState();
+			break;
+
+			case idb_event::closebase:
+			resetState();
+			break;
+		};
+		return 0;
 	}
+};
+static stubnamer_listener_t s_listener;
+
+void StubNamerInit()
+{
+	StubPatternsInit();
+	hook_event_listener(HT_IDB, &s_listener);
+}
+
+void StubNamerTerm()
+{
+	unhook_event_listener(HT_IDB, &s_listener);
+	resetState();
+	FingerprintsTerm();
+	StubPatternsTerm();
+}
+
+
+// Set the name with the next free serial number of the prefix
+static BOOL setSerialName(ea_t ea, LPCSTR prefix)
+{
+	// The index should make the first try good, but retry in case of a name it couldn't see
+	NAMESLOTS &slots = s_nameSlots[prefix];
+	char name[MAXNAMELEN];
+	if ((strlen(prefix) + 11) > sizeof(name))
+		return FALSE;
+	for (UINT retry = 0; retry < 16; retry++)
+	{
+		sprintf(name, "%s%u", prefix, slots.allocate());
+		TELEMETRY_COUNT(TC_SET_NAME);
+		if (set_name(ea, name, (SN_NON_AUTO | SN_NOLIST | SN_NOWARN)))
+			return TRUE;
+	}
+
+	msg("%llX ** Failed to set stub name: \"%s\" ** <Click Me>\n", ea, name);
+	return FALSE;
+}
+
+static BOOL setStubName(ea_t ea, UINT prefixIndex)
+{
+	if (!setSerialName(ea, StubPatternsPrefix(prefixIndex)))
+		return FALSE;
+	s_namedCounts[prefixIndex]++;
+	return TRUE;
 }
@@ -0,0 +1,28 @@
+// Function stub renamer
+#pragma once
+#include <string>
+#include <vector>
+
+// Full run stats for the batch report, times in seconds
+struct STUBNAMERSTATS
+{
+	UINT functions;
+	UINT candidates;
+	UINT named;
+	std::vector<std::pair<std::string, UINT>> prefixes; // Named per name prefix
+	UINT fingerprintNamed;                               // Named from the fingerprint file
+	double compileTime, snapshotTime, classifyTime, nameIndexTime, renameTime, fingerprintTime, totalTime;
+};
+
+void StubNamerInit();
+void StubNamerTerm();
+
+// Name the stubs of all the functions. 'headless' for batch runs, no wait box.
+void RunStubNamer(BOOL headless = FALSE, STUBNAMERSTATS *stats = NULL);
+
+// Name the stubs among the functions added, resized or renamed since the last run.
+// Also runs by itself, 'quiet', when auto-analysis finishes.
+void RunStubNamerDirty(BOOL quiet);
+
+// Classify all functions again without renaming and report any a full run would name differently
+void VerifyStubNamer();
@@ -0,0 +1,186 @@
+// Pointer table scan command.
+// The data segments are read into a snapshot a batch at the time and its pieces scanned in parallel for runs of pointers
+// to code ("Core/PointerTables.h"). The runs are split at refs and names on the main thread, then all formatted and
+// named in one batch with one undo point, instead of a fill command press per table.
+#include "StdAfx.h"
+#include "TableScan.h"
+#include "IdaDatabase.h"
+#include "RangeSnapshot.h"
+#include "ThreadPool.h"
+#include "Telemetry.h"
+#include "Core/PointerTables.h"
+#include <WaitBoxEx.h>
+#include <undo.hpp>
+#include <vector>
+
+enum TABLESTATE
+{
+	TABLE_NEW,     // Unknown bytes or pointer sized data, can be formatted
+	TABLE_DONE,    // Already a single array
+	TABLE_BLOCKED, // Other items in it, they're left alone
+};
+
+static TABLESTATE tableState(const PTRTABLE &table, UINT32 ptrSize)
+{
+	ea_t endEa = (table.startEa + ((ea_t) table.count * ptrSize));
+	flags64_t flags = get_flags(table.startEa);
+	if (is_data(flags) && (get_item_end(table.startEa) == endEa) && is_off0(flags))
+		return TABLE_DONE;
+	if (get_item_head(table.startEa) != table.startEa)
+		return TABLE_BLOCKED;
+
+	for (ea_t ea = table.startEa; ea != BADADDR; ea = next_head(ea, endEa))
+	{
+		flags = get_flags(ea);
+		TELEMETRY_COUNT(TC_GET_FLAGS);
+		if (is_data(flags) ? (get_item_size(ea) != ptrSize) : !is_unknown(flags))
+			return TABLE_BLOCKED;
+	}
+	return TABLE_NEW;
+}
+
+// A vtable if every entry is a function start and something references it, a constructor
+static BOOL isVTable(const PTRTABLE &table)
+{
+	return((table.functions == table.count) && has_xref(get_flags(table.startEa)));
+}
+
+BOOL RunTableScan(BOOL dryRun)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	IdaDatabase &db = LiveDatabase();
+	UINT32 ptrSize = (plat.is64 ? sizeof(UINT64) : sizeof(UINT32));
+	CodeTargets targets;
+	targets.Build(db);
+
+	// The data segments, from their first pointer aligned address
+	RangeSnapshot snapshot;
+	std::vector<size_t> rangeSegs; // Segment of each snapshot range
+	for (size_t i = 0; i < db.SegmentCount(); i++)
+	{
+		DBSEGMENT seg = db.Segment(i);
+		ea_t startEa = ((seg.startEa + (ptrSize - 1)) & ~((ea_t) ptrSize - 1));
+		if ((seg.type != DBSEG_CODE) && (seg.type != DBSEG_XTRN) && (seg.type != DBSEG_BSS) && (startEa < seg.endEa))
+		{
+			snapshot.Add(startEa, seg.endEa);
+			rangeSegs.push_back(i);
+		}
+	}
+	std::vector<std::vector<PTRTABLE>> segRuns(db.SegmentCount());
+	TIMESTAMP setupTime = (GetTimeStamp() - startTime);
+
+	// Scan the pieces in parallel, each into its own run list
+	WaitBox::show("Utility", "Scanning for tables..");
+	std::vector<std::vector<PTRTABLE>> pieceRuns;
+	bool is64 = (plat.is64 != FALSE);
+	TIMESTAMP scanTime = 0.0;
+	BOOL cancelled = FALSE;
+	while (!cancelled && snapshot.ReadBatch())
+	{
+		TIMESTAMP batchTime = GetTimeStamp();
+		const std::vector<SNAPSHOTPIECE> &pieces = snapshot.Pieces();
+		pieceRuns.resize(pieces.size());
+		ParallelFor(pieces.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				// Just the initialized lead of a piece, where they end is a run end as it won't join the next piece
+				pieceRuns[i].clear();
+				size_t size = (pieces[i].initedSize & ~((size_t) ptrSize - 1));
+				if (size)
+					FindPointerRuns(snapshot.Bytes(pieces[i]), size, pieces[i].ea, is64, targets, pieceRuns[i]);
+			}
+		});
+		for (size_t i = 0; i < pieces.size(); i++)
+		{
+			std::vector<PTRTABLE> &runs = segRuns[rangeSegs[pieces[i].range]];
+			runs.insert(runs.end(), pieceRuns[i].begin(), pieceRuns[i].end());
+		}
+		scanTime += (GetTimeStamp() - batchTime);
+
+		if (WaitBox::isUpdateTime() && WaitBox::updateAndCancelCheck(snapshot.Percent()))
+			cancelled = TRUE;
+	}
+	WaitBox::hide();
+	if (cancelled)
+	{
+		msg("Utility: * Table scan cancelled. *\n");
+		return FALSE;
+	}
+
+	// Join the runs cut at piece edges, per segment so a run can't cross into the next one, then split them at refs and names
+	TIMESTAMP splitStart = GetTimeStamp();
+	std::vector<PTRTABLE> tables;
+	for (std::vector<PTRTABLE> &runs : segRuns)
+	{
+		JoinPointerRuns(runs, is64);
+		for (const PTRTABLE &run : runs)
+			SplitPointerTable(db, run, targets, tables);
+	}
+
+	std::vector<BYTE> states(tables.size());
+	UINT32 counts[3] = {}, vtables = 0;
+	UINT64 entries = 0;
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		states[i] = (BYTE) tableState(tables[i], ptrSize);
+		counts[states[i]]++;
+		if (states[i] == TABLE_NEW)
+		{
+			entries += tables[i].count;
+			vtables += isVTable(tables[i]);
+		}
+	}
+	TIMESTAMP splitTime = (GetTimeStamp() - splitStart);
+
+	char buffer[32];
+	msg("Utility: Table scan%s, %s pointer tables to code:\n", (dryRun ? " (dry run)" : ""), NumberCommaString(tables.size(), buffer));
+	msg(" New: %s", NumberCommaString(counts[TABLE_NEW], buffer));
+	msg(" (%s vtables,", NumberCommaString(vtables, buffer));
+	msg(" %s entries), already formatted: %u, blocked by other items: %u.\n", NumberCommaString(entries, buffer), counts[TABLE_DONE], counts[TABLE_BLOCKED]);
+	msg(" Setup in %s, read in %s, scanned in %s,", TimeString(setupTime), TimeString(snapshot.ReadTime()), TimeString(scanTime));
+	msg(" split and checked in %s.\n", TimeString(splitTime));
+	if (dryRun || (counts[TABLE_NEW] == 0))
+		return dryRun;
+	if (ask_yn(ASKBTN_YES, "HIDECANCEL\nFormat and name the %u new pointer tables?", counts[TABLE_NEW]) != ASKBTN_YES)
+		return FALSE;
+
+	// Format them all, then name them all, one undo point and no auto-analysis in between
+	create_undo_point("Utility:TableScan", "Format pointer tables");
+	bool autoEnabled = enable_auto(false);
+	startTime = GetTimeStamp();
+	flags64_t ptrFlags = (plat.is64 ? qword_flag() : dword_flag());
+	UINT32 formatted = 0, named = 0;
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		if (states[i] != TABLE_NEW)
+			continue;
+		const PTRTABLE &table = tables[i];
+		asize_t size = ((asize_t) table.count * ptrSize);
+		del_items(table.startEa, DELIT_SIMPLE, size);
+		if (create_data(table.startEa, ptrFlags, size, BADNODE) && op_plain_offset(table.startEa, 0, 0))
+			formatted++;
+		else
+		{
+			msg("%llX ** Failed to format pointer table ** <Click Me>\n", table.startEa);
+			states[i] = TABLE_BLOCKED;
+		}
+	}
+
+	for (size_t i = 0; i < tables.size(); i++)
+	{
+		const PTRTABLE &table = tables[i];
+		if ((states[i] != TABLE_NEW) || has_user_name(get_flags(table.startEa)))
+			continue;
+		char name[64];
+		sprintf(name, "%s_%llX", (isVTable(table) ? "vtbl" : "ptrtbl"), table.startEa);
+		TELEMETRY_COUNT(TC_SET_NAME);
+		if (set_name(table.startEa, name, (SN_AUTO | SN_NOWARN)))
+			named++;
+	}
+	enable_auto(autoEnabled);
+
+	msg(" Formatted %s tables", NumberCommaString(formatted, buffer));
+	msg(", named %s in %s.\n", NumberCommaString(named, buffer), TimeString(GetTimeStamp() - startTime));
+	return(formatted > 0);
+}
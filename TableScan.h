@@ -0,0 +1,6 @@
+// Pointer table scan command
+#pragma once
+
+// Find the vtables and other tables of pointers to code in the data segments, report them, then unless 'dryRun'
+// format each as an offset array with a generated name. Returns FALSE if cancelled or nothing done.
+BOOL RunTableScan(BOOL dryRun);
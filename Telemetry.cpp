@@ -0,0 +1,242 @@
+// Per-command latency telemetry.
+// Each command keeps lifetime totals plus a rolling window of its last calls, with a log2 microsecond histogram kept over the window.
+#include "StdAfx.h"
+#include "Telemetry.h"
+
+#ifdef UTILITY_TELEMETRY
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+
+static const size_t TELEMETRY_WINDOW = 256;   // Calls per command in the rolling window
+static const UINT32 TELEMETRY_BUCKETS = 32;   // Bucket 0 is under 1us, then bucket n is under 2^n us
+
+static const char *const s_counterNames[TC_COUNT] = { "addresses", "get_flags", "get_bytes", "next_that", "decode_insn", "set_name" };
+
+BOOL g_telemetryOn = FALSE;
+UINT64 g_telemetryCounters[TC_COUNT] = {};
+
+// Plugin heap allocations, from any thread
+static std::atomic<UINT64> s_allocations(0);
+static std::atomic<UINT64> s_allocatedBytes(0);
+
+void *operator new(size_t size)
+{
+	if (g_telemetryOn)
+	{
+		s_allocations.fetch_add(1, std::memory_order_relaxed);
+		s_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+	if (void *p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct SAMPLE
+{
+	double time; // Seconds
+	UINT64 counters[TC_COUNT];
+	UINT64 allocations, allocatedBytes;
+};
+
+struct COMMANDSTATS
+{
+	std::string name;
+	UINT64 calls;
+	double totalTime, maxTime;
+	std::vector<SAMPLE> window; // Ring of the last TELEMETRY_WINDOW calls, 'next' is the oldest once full
+	size_t next;
+	UINT32 histogram[TELEMETRY_BUCKETS];
+};
+static std::map<size_t, COMMANDSTATS> s_commands;
+
+static UINT32 timeBucket(double time)
+{
+	UINT64 us = (UINT64) (time * 1000000.0);
+	if (us == 0)
+		return 0;
+	DWORD bit;
+	_BitScanReverse64(&bit, us);
+	return std::min((UINT32) (bit + 1), (TELEMETRY_BUCKETS - 1));
+}
+
+static void record(size_t cmd, LPCSTR name, const SAMPLE &sample)
+{
+	COMMANDSTATS &cs = s_commands[cmd];
+	if (cs.window.empty())
+	{
+		cs.name = name;
+		cs.window.reserve(TELEMETRY_WINDOW);
+	}
+	cs.calls++;
+	cs.totalTime += sample.time;
+	cs.maxTime = std::max(cs.maxTime, sample.time);
+
+	// Replace the oldest once full, moving its histogram count out
+	if (cs.window.size() < TELEMETRY_WINDOW)
+		cs.window.push_back(sample);
+	else
+	{
+		cs.histogram[timeBucket(cs.window[cs.next].time)]--;
+		cs.window[cs.next] = sample;
+		cs.next = ((cs.next + 1) % TELEMETRY_WINDOW);
+	}
+	cs.histogram[timeBucket(sample.time)]++;
+}
+
+TelemetryScope::TelemetryScope(size_t cmd, LPCSTR name) : m_cmd(cmd), m_name(name), m_on(g_telemetryOn)
+{
+	if (m_on)
+	{
+		memcpy(m_counters, g_telemetryCounters, sizeof(m_counters));
+		m_allocations = s_allocations;
+		m_allocatedBytes = s_allocatedBytes;
+		m_startTime = GetTimeStamp();
+	}
+}
+
+TelemetryScope::~TelemetryScope()
+{
+	// Not if it was toggled during the command
+	if (!m_on || !g_telemetryOn)
+		return;
+
+	SAMPLE sample;
+	sample.time = (GetTimeStamp() - m_startTime);
+	for (UINT32 i = 0; i < TC_COUNT; i++)
+		sample.counters[i] = (g_telemetryCounters[i] - m_counters[i]);
+	sample.allocations = (s_allocations - m_allocations);
+	sample.allocatedBytes = (s_allocatedBytes - m_allocatedBytes);
+	record(m_cmd, m_name, sample);
+}
+
+// ======================================================================================
+
+void TelemetryTerm()
+{
+	g_telemetryOn = FALSE;
+	s_commands.clear();
+}
+
+void TelemetryToggle()
+{
+	g_telemetryOn = !g_telemetryOn;
+	msg("Utility: Telemetry recording %s, %u commands recorded.\n", (g_telemetryOn ? "on" : "off"), (UINT32) s_commands.size());
+}
+
+void TelemetryReport()
+{
+	msg("Utility: Telemetry (recording %s), over the last %u calls of each command:\n", (g_telemetryOn ? "on" : "off"), (UINT32) TELEMETRY_WINDOW);
+	if (s_commands.empty())
+	{
+		msg(" Nothing recorded.\n");
+		return;
+	}
+
+	char buffer[32];
+	std::vector<double> times;
+	for (const auto &it : s_commands)
+	{
+		const COMMANDSTATS &cs = it.second;
+		size_t count = cs.window.size();
+		times.clear();
+		double windowTime = 0.0;
+		UINT64 counters[TC_COUNT] = {}, allocations = 0, allocatedBytes = 0;
+		for (const SAMPLE &s : cs.window)
+		{
+			times.push_back(s.time);
+			windowTime += s.time;
+			for (UINT32 i = 0; i < TC_COUNT; i++)
+				counters[i] += s.counters[i];
+			allocations += s.allocations;
+			allocatedBytes += s.allocatedBytes;
+		}
+		std::sort(times.begin(), times.end());
+
+		msg(" %s (%u): %s calls, %s total, max %.1f us.\n", cs.name.c_str(), (UINT32) it.first, NumberCommaString(cs.calls, buffer), TimeString(cs.totalTime), (cs.maxTime * 1000000.0));
+		msg("  Latency: mean %.1f us, p50 %.1f us, p99 %.1f us.\n", ((windowTime / count) * 1000000.0), (times[count / 2] * 1000000.0),
+			(times[std::min(((count * 99) / 100), (count - 1))] * 1000000.0));
+		msg("  Per call:");
+		for (UINT32 i = 0; i < TC_COUNT; i++)
+			msg(" %s %s,", NumberCommaString(counters[i] / count, buffer), s_counterNames[i]);
+		msg(" %s allocations", NumberCommaString(allocations / count, buffer));
+		msg(" (%s bytes).\n", NumberCommaString(allocatedBytes / count, buffer));
+
+		msg("  Histogram:");
+		for (UINT32 i = 0; i < TELEMETRY_BUCKETS; i++)
+		{
+			if (cs.histogram[i])
+				msg(" [<%llu us: %u]", (1ull << i), cs.histogram[i]);
+		}
+		msg("\n");
+	}
+}
+
+void TelemetryExportCSV()
+{
+	if (s_commands.empty())
+	{
+		msg("Utility: Telemetry, nothing recorded to export.\n");
+		return;
+	}
+
+	// From a batch run the path comes from the environment, like the batch report
+	qstring path;
+	if (!qgetenv("UTILITY_TELEMETRY_CSV", &path) || path.empty())
+	{
+		qstring defaultPath(get_path(PATH_TYPE_IDB));
+		defaultPath.append(".telemetry.csv");
+		LPCSTR selected = ask_file(true, defaultPath.c_str(), "FILTER CSV file|*.csv\nExport the command telemetry to");
+		if (!selected)
+			return;
+		path = selected;
+	}
+
+	FILE *fp = fopen(path.c_str(), "wb");
+	if (!fp)
+	{
+		msg("Utility: ** Failed to create \"%s\". **\n", path.c_str());
+		return;
+	}
+	fprintf(fp, "command,name,call,time_us");
+	for (UINT32 i = 0; i < TC_COUNT; i++)
+		fprintf(fp, ",%s", s_counterNames[i]);
+	fprintf(fp, ",allocations,allocated_bytes\n");
+
+	size_t rows = 0;
+	for (const auto &it : s_commands)
+	{
+		// Oldest first, the first call number is the first one still in the window
+		const COMMANDSTATS &cs = it.second;
+		size_t count = cs.window.size();
+		for (size_t n = 0; n < count; n++)
+		{
+			const SAMPLE &s = cs.window[(cs.next + n) % count];
+			fprintf(fp, "%u,%s,%llu,%.3f", (UINT32) it.first, cs.name.c_str(), ((cs.calls - count) + n + 1), (s.time * 1000000.0));
+			for (UINT32 i = 0; i < TC_COUNT; i++)
+				fprintf(fp, ",%llu", s.counters[i]);
+			fprintf(fp, ",%llu,%llu\n", s.allocations, s.allocatedBytes);
+			rows++;
+		}
+	}
+	fclose(fp);
+	msg("Utility: Telemetry, %u calls exported to \"%s\".\n", (UINT32) rows, path.c_str());
+}
+
+#else
+
+static void notBuiltIn()
+{
+	msg("Utility: Telemetry isn't built in, rebuild with \"UTILITY_TELEMETRY\" defined.\n");
+}
+
+void TelemetryTerm() {}
+void TelemetryToggle() { notBuiltIn(); }
+void TelemetryReport() { notBuiltIn(); }
+void TelemetryExportCSV() { notBuiltIn(); }
+#endif
@@ -0,0 +1,55 @@
+// Per-command latency telemetry for the run() commands.
+// Compiled in with "UTILITY_TELEMETRY" defined (see "StdAfx.h"), otherwise the macros are empty and the commands just report it's not built in.
+// Compiled in it's still off until the toggle command, and then the hot path cost is a flag test per counted SDK call.
+#pragma once
+
+// Per call counters
+enum TELEMETRY_COUNTER
+{
+	TC_ADDRESSES,   // Addresses visited, bytes read plus next_that()/prev_that() spans
+	TC_GET_FLAGS,
+	TC_GET_BYTES,
+	TC_NEXT_THAT,   // next_that() and prev_that()
+	TC_DECODE_INSN,
+	TC_SET_NAME,
+
+	TC_COUNT
+};
+
+#ifdef UTILITY_TELEMETRY
+extern BOOL g_telemetryOn;
+extern UINT64 g_telemetryCounters[TC_COUNT]; // Main thread only, like the SDK calls they count
+
+// Records a command's wall time, counters and allocations from construction to destruction
+class TelemetryScope
+{
+public:
+	TelemetryScope(size_t cmd, LPCSTR name);
+	~TelemetryScope();
+
+private:
+	size_t m_cmd;
+	LPCSTR m_name;
+	BOOL m_on;
+	TIMESTAMP m_startTime;
+	UINT64 m_counters[TC_COUNT];
+	UINT64 m_allocations, m_allocatedBytes;
+};
+
+#define TELEMETRY_COMMAND(_cmd, _name) TelemetryScope _telemetryScope(_cmd, _name)
+#define TELEMETRY_COUNT(_counter) do { if (g_telemetryOn) g_telemetryCounters[_counter]++; } while (0)
+#define TELEMETRY_ADD(_counter, _n) do { if (g_telemetryOn) g_telemetryCounters[_counter] += (UINT64) (_n); } while (0)
+#else
+#define TELEMETRY_COMMAND(_cmd, _name) ((void) 0)
+#define TELEMETRY_COUNT(_counter) ((void) 0)
+#define TELEMETRY_ADD(_counter, _n) ((void) 0)
+#endif
+
+void TelemetryTerm();
+
+// Turn recording on or off, the recorded commands are kept
+void TelemetryToggle();
+// Dump the per command stats and rolling latency histograms to the output window
+void TelemetryReport();
+// Write the recorded calls to a CSV file, one row per call
+void TelemetryExportCSV();
@@ -0,0 +1,42 @@
+// Minimal parallel for over an index range
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Run 'func(begin, end)' over [0, count) in 'grain' sized chunks on all cores, the calling thread included.
+// Threads pull the next chunk off a shared counter, so whoever is done first takes more and uneven chunks balance out.
+// Note 'func' must not call the IDA SDK, it's not thread safe.
+template <class FUNC> void ParallelFor(size_t count, size_t grain, FUNC func)
+{
+	size_t chunks = ((count + grain - 1) / grain);
+	size_t threadCount = std::min((size_t) std::max(1u, std::thread::hardware_concurrency()), chunks);
+	if (threadCount <= 1)
+	{
+		if (count)
+			func((size_t) 0, count);
+		return;
+	}
+
+	std::atomic<size_t> nextChunk(0);
+	auto worker = [&]()
+	{
+		for (;;)
+		{
+			size_t chunk = nextChunk.fetch_add(1);
+			if (chunk >= chunks)
+				break;
+			size_t begin = (chunk * grain);
+			func(begin, std::min((begin + grain), count));
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount - 1);
+	for (size_t i = 1; i < threadCount; i++)
+		threads.emplace_back(worker);
+	worker();
+	for (std::thread &t : threads)
+		t.join();
+}
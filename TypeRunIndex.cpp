@@ -0,0 +1,438 @@
+// Per-segment run-length map of item kinds for the FindNext/PrevTypeChange commands.
+// Each segment keeps a sorted array of its runs, the offset where each starts and the kind of its items, built on
+// first use with one flags sweep that only stops where the kind can change. Item events queue the changed ranges,
+// which are re-swept and spliced into the map before the next lookup. Segment changes drop the affected maps.
+#include "StdAfx.h"
+#include "TypeRunIndex.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+// Cap on queued event ranges before we give up and drop everything instead, like during auto-analysis
+static const size_t PENDING_MAX = 0x10000;
+
+// Item kind key, the class in the low bits, then the data type and a struct array's element size
+enum
+{
+	KIND_UNKNOWN = 0,
+	KIND_CODE    = 1,
+	KIND_DATA    = 2,
+};
+
+struct TYPERUN
+{
+	UINT32 offset; // From the segment start
+	UINT32 kind;
+};
+
+// Runs of a single segment, the first one starts at offset 0
+struct SEGRUNS
+{
+	ea_t startEa, endEa;
+	std::vector<TYPERUN> runs;
+};
+typedef std::map<ea_t, SEGRUNS> SEGMAP;
+
+struct EARANGE
+{
+	ea_t startEa, endEa;
+	bool operator<(const EARANGE &r) const { return(startEa < r.startEa); }
+};
+
+static SEGMAP s_segments;             // Keyed by segment start address
+static std::vector<EARANGE> s_pending; // Ranges with changed items
+static LONGSCAN s_longScan = LONGSCAN_BLOCK;
+static BOOL s_stopped = FALSE;
+
+static bool runOffsetLess(const TYPERUN &run, UINT32 offset) { return(run.offset < offset); }
+static bool offsetRunLess(UINT32 offset, const TYPERUN &run) { return(offset < run.offset); }
+
+// ======================================================================================
+
+static UINT32 getItemKind(ea_t ea, flags64_t flags)
+{
+	if (is_code(flags))
+		return KIND_CODE;
+	if (!is_data(flags))
+		return KIND_UNKNOWN;
+
+	UINT32 kind = (KIND_DATA | (UINT32) ((flags & DT_TYPE) >> 24));
+	if (is_struct(flags))
+		kind |= ((UINT32) std::min(get_data_elsize(ea, flags), (asize_t) 0xFFFFFF) << 8);
+	return kind;
+}
+
+// What the sweep skips over, the items of a run that can't change kind without a flags change
+struct SWEEPTEST
+{
+	flags64_t cls, type;
+	BOOL everyHead; // Structs, their size isn't in the flags
+};
+
+static bool idaapi isOtherKind(flags64_t flags, void *ud)
+{
+	const SWEEPTEST *test = (const SWEEPTEST*) ud;
+	if (is_tail(flags))
+		return false;
+	if (test->everyHead || ((flags & MS_CLS) != test->cls))
+		return true;
+	return(is_data(flags) && ((flags & DT_TYPE) != test->type));
+}
+
+// Sweep the runs from the item head 'ea' up to 'endEa', appending them to 'runs'.
+// Returns where it stopped, at or past 'endEa' where a new run could start, BADADDR if the long scan was stopped.
+static ea_t sweepRuns(segment_t *seg, ea_t ea, ea_t endEa, std::vector<TYPERUN> &runs)
+{
+	LongScanState state(s_longScan, ea, endEa);
+	UINT32 steps = 0;
+	while (ea < endEa)
+	{
+		flags64_t flags = get_flags(ea);
+		UINT32 kind = getItemKind(ea, flags);
+		if (runs.empty() || (runs.back().kind != kind))
+			runs.push_back({ (UINT32) (ea - seg->start_ea), kind });
+
+		SWEEPTEST test = { (flags & MS_CLS), (flags & DT_TYPE), is_struct(flags) };
+		ea_t next = next_that(ea, seg->end_ea, isOtherKind, &test);
+		TELEMETRY_ADD(TC_ADDRESSES, (((next != BADADDR) ? next : seg->end_ea) - ea));
+		ea = ((next != BADADDR) ? next : seg->end_ea);
+		if (((++steps % 4096) == 0) && !state.Check(ea))
+		{
+			s_stopped = TRUE;
+			return BADADDR;
+		}
+	};
+	TELEMETRY_ADD(TC_GET_FLAGS, steps);
+	TELEMETRY_ADD(TC_NEXT_THAT, steps);
+	return std::min(ea, seg->end_ea);
+}
+
+// Map a segment with a single sweep. Returns FALSE if it was stopped.
+static BOOL buildSegment(segment_t *seg, SEGRUNS &sr)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	sr.startEa = seg->start_ea;
+	sr.endEa = seg->end_ea;
+	sr.runs.clear();
+	if (sweepRuns(seg, get_item_head(seg->start_ea), seg->end_ea, sr.runs) == BADADDR)
+		return FALSE;
+	sr.runs.shrink_to_fit();
+
+	TIMESTAMP buildTime = (GetTimeStamp() - startTime);
+	if (buildTime >= 0.5)
+	{
+		qstring segName;
+		get_segm_name(&segName, seg);
+		char buffer[32];
+		msg("Utility: Mapped %s item runs in segment \"%s\" in %s.\n", NumberCommaString(sr.runs.size(), buffer), segName.c_str(), TimeString(buildTime));
+	}
+	return TRUE;
+}
+
+// Get a segment's runs, building them if needed.
+// Returns NULL for segments too large for 32bit offsets, these have no transitions, or if the build was stopped.
+static SEGRUNS *getSegRuns(segment_t *seg)
+{
+	if (seg->size() > 0xFFFFFFFF)
+		return NULL;
+
+	SEGMAP::iterator it = s_segments.find(seg->start_ea);
+	if ((it != s_segments.end()) && (it->second.endEa == seg->end_ea))
+		return &it->second;
+
+	SEGRUNS &sr = s_segments[seg->start_ea];
+	if (!buildSegment(seg, sr))
+	{
+		s_segments.erase(seg->start_ea);
+		return NULL;
+	}
+	return &sr;
+}
+
+// ======================================================================================
+
+// Re-sweep a changed range of a mapped segment and splice the new runs in
+static void updateRange(SEGRUNS &sr, segment_t *seg, ea_t startEa, ea_t endEa)
+{
+	startEa = get_item_head(std::max(startEa, sr.startEa));
+	endEa = std::min(endEa, sr.endEa);
+	std::vector<TYPERUN> fresh;
+	ea_t sweepEnd = sweepRuns(seg, startEa, endEa, fresh);
+	if (sweepEnd == BADADDR)
+	{
+		// Doesn't happen with LONGSCAN_BLOCK, but don't keep a half updated map
+		s_segments.erase(sr.startEa);
+		return;
+	}
+
+	// Past the changed range the old kinds still hold, the run at the sweep end continues the old one there
+	std::vector<TYPERUN> &runs = sr.runs;
+	UINT32 startOffset = (UINT32) (startEa - sr.startEa), endOffset = (UINT32) (sweepEnd - sr.startEa);
+	std::vector<TYPERUN>::iterator first = std::lower_bound(runs.begin(), runs.end(), startOffset, runOffsetLess);
+	std::vector<TYPERUN>::iterator last = std::upper_bound(runs.begin(), runs.end(), endOffset, offsetRunLess);
+	if ((sweepEnd < sr.endEa) && (last != runs.begin()))
+		fresh.push_back({ endOffset, (last - 1)->kind });
+	size_t index = (first - runs.begin());
+	runs.insert(runs.erase(first, last), fresh.begin(), fresh.end());
+
+	// Merge the runs around the splice that now continue each other
+	size_t mergeStart = std::max(index, (size_t) 1), mergeEnd = std::min((index + fresh.size() + 1), runs.size());
+	for (size_t i = mergeStart; i < mergeEnd;)
+	{
+		if (runs[i].kind == runs[i - 1].kind)
+		{
+			runs.erase(runs.begin() + i);
+			mergeEnd--;
+		}
+		else
+			i++;
+	}
+}
+
+// Apply the queued event ranges
+static void flushPending()
+{
+	if (s_pending.empty())
+		return;
+
+	std::sort(s_pending.begin(), s_pending.end());
+	LONGSCAN longScan = s_longScan;
+	s_longScan = LONGSCAN_BLOCK;
+	for (size_t i = 0; i < s_pending.size();)
+	{
+		// Merge the overlapping and adjacent ranges
+		EARANGE range = s_pending[i++];
+		while ((i < s_pending.size()) && (s_pending[i].startEa <= range.endEa))
+			range.endEa = std::max(range.endEa, s_pending[i++].endEa);
+
+		// A range can span more than one segment
+		for (ea_t ea = range.startEa; ea < range.endEa;)
+		{
+			SEGMAP::iterator it = s_segments.upper_bound(ea);
+			if (it != s_segments.begin())
+			{
+				SEGRUNS &sr = (--it)->second;
+				segment_t *seg = getseg(sr.startEa);
+				if ((ea < sr.endEa) && seg && (seg->start_ea == sr.startEa) && (seg->end_ea == sr.endEa))
+				{
+					ea_t endEa = std::min(range.endEa, sr.endEa);
+					updateRange(sr, seg, ea, endEa);
+					ea = endEa;
+					continue;
+				}
+			}
+			segment_t *seg = get_next_seg(ea);
+			if (!seg)
+				break;
+			ea = seg->start_ea;
+		}
+	}
+	s_pending.clear();
+	s_longScan = longScan;
+}
+
+static void queueRange(ea_t startEa, ea_t endEa)
+{
+	if (s_segments.empty() || (startEa >= endEa))
+		return;
+	if (s_pending.size() < PENDING_MAX)
+		s_pending.push_back({ startEa, endEa });
+	else
+	{
+		// Too many changes to track, drop the maps and rebuild them on demand
+		s_segments.clear();
+		s_pending.clear();
+	}
+}
+
+// Drop any segment map that overlaps the given range
+static void invalidateRange(ea_t startEa, ea_t endEa)
+{
+	for (SEGMAP::iterator it = s_segments.begin(); it != s_segments.end();)
+	{
+		if ((it->second.startEa < endEa) && (startEa < it->second.endEa))
+			it = s_segments.erase(it);
+		else
+			++it;
+	}
+}
+
+static void resetIndex()
+{
+	s_segments.clear();
+	s_pending.clear();
+}
+
+// ======================================================================================
+
+ea_t TypeRunIndexNext(ea_t ea, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+	flushPending();
+
+	// Start in the containing segment, or else the next one
+	int n = get_segm_num(ea);
+	if (n < 0)
+	{
+		segment_t *seg = get_next_seg(ea);
+		if (!seg)
+			return BADADDR;
+		n = get_segm_num(seg->start_ea);
+	}
+
+	s_longScan = longScan;
+	s_stopped = FALSE;
+	ea_t result = BADADDR;
+
+	int segCount = get_segm_qty();
+	for (; (n < segCount) && !s_stopped; n++)
+	{
+		segment_t *seg = getnseg(n);
+		SEGRUNS *sr = getSegRuns(seg);
+		if (!sr)
+			continue;
+
+		// First run start past 'ea', the one at the segment start doesn't count
+		UINT32 offset = ((ea >= seg->start_ea) ? (UINT32) (ea - seg->start_ea) : 0);
+		std::vector<TYPERUN>::const_iterator it = std::upper_bound(sr->runs.begin(), sr->runs.end(), offset, offsetRunLess);
+		if (it != sr->runs.end())
+		{
+			result = (sr->startEa + it->offset);
+			break;
+		}
+	}
+
+	if (stopped)
+		*stopped = s_stopped;
+	s_longScan = LONGSCAN_BLOCK;
+	return result;
+}
+
+ea_t TypeRunIndexPrev(ea_t ea, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+	flushPending();
+
+	// Start in the containing segment, or else the previous one
+	int n = get_segm_num(ea);
+	if (n < 0)
+	{
+		segment_t *seg = get_prev_seg(ea);
+		if (!seg)
+			return BADADDR;
+		n = get_segm_num(seg->start_ea);
+	}
+
+	s_longScan = longScan;
+	s_stopped = FALSE;
+	ea_t result = BADADDR;
+
+	for (; (n >= 0) && !s_stopped; n--)
+	{
+		segment_t *seg = getnseg(n);
+		if (ea <= seg->start_ea)
+			continue;
+		SEGRUNS *sr = getSegRuns(seg);
+		if (!sr)
+			continue;
+
+		// Last run start before 'ea', past the first one
+		UINT32 offset = ((ea < seg->end_ea) ? (UINT32) (ea - seg->start_ea) : (UINT32) seg->size());
+		size_t index = (std::lower_bound(sr->runs.begin(), sr->runs.end(), offset, runOffsetLess) - sr->runs.begin());
+		if (index > 1)
+		{
+			result = (sr->startEa + sr->runs[index - 1].offset);
+			break;
+		}
+	}
+
+	if (stopped)
+		*stopped = s_stopped;
+	s_longScan = LONGSCAN_BLOCK;
+	return result;
+}
+
+// ======================================================================================
+
+// Track the item changes, and the segment changes that drop whole maps
+struct typerun_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
+		{
+			case idb_event::make_code:
+			{
+				const insn_t *insn = va_arg(va, const insn_t*);
+				queueRange(insn->ea, (insn->ea + insn->size));
+			}
+			break;
+
+			case idb_event::make_data:
+			{
+				ea_t ea = va_arg(va, ea_t);
+				va_arg(va, flags64_t);
+				va_arg(va, tid_t);
+				asize_t len = va_arg(va, asize_t);
+				queueRange(ea, (ea + std::max(len, (asize_t) 1)));
+			}
+			break;
+
+			case idb_event::destroyed_items:
+			{
+				ea_t startEa = va_arg(va, ea_t);
+				ea_t endEa = va_arg(va, ea_t);
+				queueRange(startEa, endEa);
+			}
+			break;
+
+			case idb_event::segm_added:
+			{
+				segment_t *seg = va_arg(va, segment_t*);
+				invalidateRange(seg->start_ea, seg->end_ea);
+			}
+			break;
+
+			case idb_event::segm_deleted:
+			{
+				ea_t startEa = va_arg(va, ea_t);
+				ea_t endEa = va_arg(va, ea_t);
+				invalidateRange(startEa, endEa);
+			}
+			break;
+
+			case idb_event::segm_start_changed:
+			case idb_event::segm_end_changed:
+			{
+				segment_t *seg = va_arg(va, segment_t*);
+				ea_t oldEa = va_arg(va, ea_t);
+				invalidateRange(std::min(seg->start_ea, oldEa), std::max(seg->end_ea, oldEa));
+			}
+			break;
+
+			// Struct sizes can change with the types, and moved segments take their items along
+			case idb_event::local_types_changed:
+			case idb_event::segm_moved:
+			case idb_event::allsegs_moved:
+			case idb_event::closebase:
+			resetIndex();
+			break;
+		};
+		return 0;
+	}
+};
+static typerun_listener_t s_listener;
+
+void TypeRunIndexInit()
+{
+	hook_event_listener(HT_IDB, &s_listener);
+}
+
+void TypeRunIndexTerm()
+{
+	unhook_event_listener(HT_IDB, &s_listener);
+	resetIndex();
+}
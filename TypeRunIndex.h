@@ -0,0 +1,13 @@
+// Per-segment run-length map of item kinds for the FindNext/PrevTypeChange commands.
+// A run is a span of consecutive items of the same kind: unknown bytes, code, or data of one type (a struct array's
+// element size counting as part of its type), so a transition is where the formatting changes.
+#pragma once
+#include "LongScan.h"
+
+void TypeRunIndexInit();
+void TypeRunIndexTerm();
+
+// Return the next/previous run start from 'ea' (exclusive), or BADADDR if none. Segment starts aren't transitions.
+// 'longScan' is what to do if a segment map build runs long, 'stopped' is set if it was cancelled or gave up.
+ea_t TypeRunIndexNext(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+ea_t TypeRunIndexPrev(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
@@ -0,0 +1,192 @@
+// Typed value search for the FindNext/PrevValue commands.
+// The per-segment scan is the core SIMD one ("Core/ValueScan.h") over the live database, this adds the query prompt,
+// the segment walk and collapsed ranges. Repeat presses are served by the navigation cache, dropped on a new query.
+#include "StdAfx.h"
+#include "ValueSearch.h"
+#include "NavCache.h"
+#include "IdaDatabase.h"
+#include "Core/ValueScan.h"
+
+static qstring s_queryText;
+static VALUEQUERY s_query;
+static BOOL s_hasQuery = FALSE;
+
+// Synchronous scan slice between long scan checks
+static const size_t SYNC_SLICE_SIZE = (16 * SCAN_CHUNK_SIZE);
+
+// If the address is inside a collapsed hidden range return it, else NULL
+static hidden_range_t *getCollapsedRange(ea_t ea)
+{
+	hidden_range_t *hr = get_hidden_range(ea);
+	return((hr && !hr->visible) ? hr : NULL);
+}
+
+BOOL HasValueQuery() { return s_hasQuery; }
+
+BOOL AskValueQuery()
+{
+	qstring text(s_queryText);
+	if (!ask_str(&text, HIST_SRCH, "Value search, hex: [d|q] <value> | <low>..<high> | <value>&<mask> | <segment name>"))
+		return FALSE;
+
+	VALUEQUERY query;
+	std::string error;
+	if (!ParseValueQuery(LiveDatabase(), text.c_str(), query, error))
+	{
+		msg("Utility: ** Value search: %s. **\n", error.c_str());
+		return FALSE;
+	}
+
+	s_queryText = text;
+	s_query = query;
+	s_hasQuery = TRUE;
+	NavCacheInvalidate(NAV_VALUE);
+	if (query.span)
+		msg("Utility: Value search for %s %llX..%llX (%s).\n", ((query.width == sizeof(UINT64)) ? "QWORDs" : "DWORDs"), query.low, (query.low + query.span), ValueScanISA(query.width));
+	else
+		msg("Utility: Value search for %s %llX mask %llX (%s).\n", ((query.width == sizeof(UINT64)) ? "QWORDs" : "DWORDs"), query.low, query.mask, ValueScanISA(query.width));
+	return TRUE;
+}
+
+// ======================================================================================
+
+// Scan a segment range in slices between the long scan checks.
+// The slices start aligned so no value straddles two of them.
+static ea_t scanSegmentNext(LongScanState &state, ea_t ea, ea_t endEa)
+{
+	ea = ((ea + (s_query.width - 1)) & ~(ea_t) (s_query.width - 1));
+	while (ea < endEa)
+	{
+		ea_t sliceEnd = (ea + std::min((ea_t) SYNC_SLICE_SIZE, (endEa - ea)));
+		ea_t hit = ScanNextValue(LiveDatabase(), ea, sliceEnd, s_query);
+		if (hit != BADADDR)
+			return hit;
+		ea = sliceEnd;
+		if (!state.Check(ea))
+			break;
+	}
+	return BADADDR;
+}
+
+static ea_t scanSegmentPrev(LongScanState &state, ea_t startEa, ea_t ea)
+{
+	ea &= ~(ea_t) (s_query.width - 1);
+	while (ea > startEa)
+	{
+		ea_t sliceStart = (ea - std::min((ea_t) SYNC_SLICE_SIZE, (ea - startEa)));
+		ea_t hit = ScanPrevValue(LiveDatabase(), sliceStart, ea, s_query);
+		if (hit != BADADDR)
+			return hit;
+		ea = sliceStart;
+		if (!state.Check(ea))
+			break;
+	}
+	return BADADDR;
+}
+
+// ======================================================================================
+
+ea_t FindNextValue(ea_t ea, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+	if (!s_hasQuery)
+		return BADADDR;
+
+	ea++;
+	ea_t maxEa = inf_get_max_ea();
+	LongScanState state(longScan, ea, maxEa);
+
+	while ((ea < maxEa) && !state.Stopped())
+	{
+		// Jump over unloaded ranges, and with them any run of segments without initialized bytes, in one step
+		if (!is_loaded(ea))
+		{
+			ea = next_inited(ea, maxEa);
+			if (ea == BADADDR)
+				break;
+		}
+
+		segment_t *seg = getseg(ea);
+		if (!seg)
+		{
+			seg = get_next_seg(ea);
+			if (!seg)
+				break;
+			ea = seg->start_ea;
+			continue;
+		}
+
+		ea_t hit = scanSegmentNext(state, ea, seg->end_ea);
+		if (hit == BADADDR)
+		{
+			ea = seg->end_ea;
+			continue;
+		}
+
+		// Skip over collapsed ranges like next_visea() does
+		if (hidden_range_t *hr = getCollapsedRange(hit))
+		{
+			ea = hr->end_ea;
+			continue;
+		}
+		return hit;
+	}
+
+	if (stopped)
+		*stopped = state.Stopped();
+	return BADADDR;
+}
+
+ea_t FindPrevValue(ea_t ea, LONGSCAN longScan, BOOL *stopped)
+{
+	if (stopped)
+		*stopped = FALSE;
+	if (!s_hasQuery || (ea == 0))
+		return BADADDR;
+
+	// Values that start before 'ea'
+	ea_t width = s_query.width;
+	ea = (((ea - 1) & ~(width - 1)) + width);
+	ea_t minEa = inf_get_min_ea();
+	LongScanState state(longScan, ea, minEa);
+
+	while ((ea > minEa) && !state.Stopped())
+	{
+		if (!is_loaded(ea - 1))
+		{
+			ea_t prev = prev_inited((ea - 1), minEa);
+			if (prev == BADADDR)
+				break;
+			ea = (prev + 1);
+		}
+
+		segment_t *seg = getseg(ea - 1);
+		if (!seg)
+		{
+			seg = get_prev_seg(ea - 1);
+			if (!seg)
+				break;
+			ea = seg->end_ea;
+			continue;
+		}
+
+		ea_t hit = scanSegmentPrev(state, seg->start_ea, std::min(ea, seg->end_ea));
+		if (hit == BADADDR)
+		{
+			ea = seg->start_ea;
+			continue;
+		}
+
+		if (hidden_range_t *hr = getCollapsedRange(hit))
+		{
+			ea = hr->start_ea;
+			continue;
+		}
+		return hit;
+	}
+
+	if (stopped)
+		*stopped = state.Stopped();
+	return BADADDR;
+}
@@ -0,0 +1,14 @@
+// Typed value search for the FindNext/PrevValue commands, aligned DWORDs or QWORDs equal to a value, in a range or matching a mask
+#pragma once
+#include "LongScan.h"
+
+// Ask for a new query (see "Core/ValueScan.h" for the syntax), remembered for the following searches.
+// Returns FALSE if cancelled or it didn't parse.
+BOOL AskValueQuery();
+// TRUE once there is a query to search for
+BOOL HasValueQuery();
+
+// Return the address of the next/previous matching value from 'ea' (exclusive), or BADADDR if none.
+// 'longScan' is what to do if it runs long, 'stopped' is set if it was cancelled or gave up before the end.
+ea_t FindNextValue(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
+ea_t FindPrevValue(ea_t ea, LONGSCAN longScan = LONGSCAN_BLOCK, BOOL *stopped = NULL);
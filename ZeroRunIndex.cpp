@@ -0,0 +1,348 @@
+// Optional per-segment run-length map of zero/non-zero byte spans for the NotZ commands.
+// Each data segment keeps a sorted array of the offsets where the bytes toggle between zero and non-zero,
+// making a next/previous not zero lookup a binary search. Uninitialized bytes count as zero.
+// Patched bytes update the map in place, segment changes and loading additional files drop the affected
+// segments to be rebuilt on demand. Note bytes changed with put_bytes() (e.g. from scripts) don't fire an event.
+// Only the enabled setting is saved with the database, the runs are built again in each session.
+#include "StdAfx.h"
+#include "ZeroRunIndex.h"
+#include "IdaDatabase.h"
+#include "Core/ZeroScan.h"
+#include <algorithm>
+#include <map>
+#include <vector>
+
+static const char NETNODE_NAME[] = "$ utilityfeature.zeroruns";
+static const uchar BLOB_TAG = 'Z';
+
+// Runs of a single segment
+struct SEGRUNS
+{
+	ea_t startEa, endEa;
+	std::vector<UINT32> toggles; // Sorted offsets where zero/non-zero state flips, state before the first one is zero
+	TIMESTAMP buildTime;
+
+	// Return TRUE if the byte at 'offset' is non-zero
+	BOOL isNonZero(UINT32 offset) const
+	{
+		size_t count = (std::upper_bound(toggles.begin(), toggles.end(), offset) - toggles.begin());
+		return(count & 1);
+	}
+
+	// Flip the state of a single byte
+	void flip(UINT32 offset)
+	{
+		toggle(offset);
+		if ((ea_t) (offset + 1) < (endEa - startEa))
+			toggle(offset + 1);
+	}
+
+	void toggle(UINT32 offset)
+	{
+		std::vector<UINT32>::iterator it = std::lower_bound(toggles.begin(), toggles.end(), offset);
+		if ((it != toggles.end()) && (*it == offset))
+			toggles.erase(it);
+		else
+			toggles.insert(it, offset);
+	}
+};
+typedef std::map<ea_t, SEGRUNS> SEGMAP;
+
+static SEGMAP s_segments;     // Keyed by segment start address
+static BOOL s_enabled = FALSE;
+static BOOL s_loaded = FALSE; // Setting loaded for the current database
+static BOOL s_dirty = FALSE;  // Setting changed since the last save
+
+// ======================================================================================
+
+// Only data segments are indexed
+static BOOL isIndexedSegment(segment_t *seg)
+{
+	return((seg->type != SEG_CODE) && (seg->type != SEG_XTRN) && (seg->size() <= 0xFFFFFFFF));
+}
+
+// Build the runs of a segment with the bulk scanner
+static void buildSegment(segment_t *seg, SEGRUNS &sr)
+{
+	TIMESTAMP startTime = GetTimeStamp();
+	sr.startEa = seg->start_ea;
+	sr.endEa = seg->end_ea;
+	sr.toggles.clear();
+
+	BOOL nonZero = FALSE;
+	for (ea_t ea = seg->start_ea; ea < seg->end_ea;)
+	{
+		// Skip uninitialized spans, these are zero
+		if (!is_loaded(ea))
+		{
+			ea_t nextEa = next_inited(ea, seg->end_ea);
+			if (nonZero)
+			{
+				sr.toggles.push_back((UINT32) (ea - seg->start_ea));
+				nonZero = FALSE;
+			}
+			if (nextEa == BADADDR)
+				break;
+			ea = nextEa;
+		}
+
+		size_t size = (size_t) std::min((asize_t) SCAN_CHUNK_SIZE, (seg->end_ea - ea));
+		size_t inited;
+		const BYTE *buffer = LiveDatabase().ReadBytes(ea, size, true, inited);
+		if (inited == 0)
+		{
+			// Unreadable, treat as zero
+			if (nonZero)
+			{
+				sr.toggles.push_back((UINT32) (ea - seg->start_ea));
+				nonZero = FALSE;
+			}
+			ea += size;
+			continue;
+		}
+
+		for (size_t pos = 0; pos < inited;)
+		{
+			size_t offset = (nonZero ? FindFirstZero(buffer + pos, inited - pos) : FindFirstNonZero(buffer + pos, inited - pos));
+			pos += offset;
+			if (pos >= inited)
+				break;
+			sr.toggles.push_back((UINT32) ((ea + pos) - seg->start_ea));
+			nonZero = !nonZero;
+		}
+		ea += inited;
+	}
+
+	sr.toggles.shrink_to_fit();
+	sr.buildTime = (GetTimeStamp() - startTime);
+}
+
+// ======================================================================================
+
+// Just the setting is saved. The runs are rebuilt on demand each session, bytes can change while the plugin isn't
+// loaded and checking them against the database would cost as much as a rebuild.
+static void saveIndex()
+{
+	netnode node(NETNODE_NAME, 0, true);
+	node.altset(0, s_enabled);
+	node.delblob(0, BLOB_TAG); // The runs older versions saved
+	s_dirty = FALSE;
+}
+
+static void loadIndex()
+{
+	s_loaded = TRUE;
+	netnode node(NETNODE_NAME);
+	if (node != BADNODE)
+	{
+		s_enabled = (node.altval(0) != 0);
+		s_dirty = (node.blobsize(0, BLOB_TAG) > 0);
+	}
+}
+
+static void resetIndex()
+{
+	s_segments.clear();
+	s_enabled = s_loaded = s_dirty = FALSE;
+}
+
+static void invalidateRange(ea_t startEa, ea_t endEa)
+{
+	for (SEGMAP::iterator it = s_segments.begin(); it != s_segments.end();)
+	{
+		if ((it->second.startEa < endEa) && (startEa < it->second.endEa))
+			it = s_segments.erase(it);
+		else
+			++it;
+	}
+}
+
+// Get a segment's runs, building them if needed. Returns NULL if not indexed.
+static SEGRUNS *getSegRuns(segment_t *seg)
+{
+	if (!s_loaded)
+		loadIndex();
+	if (!s_enabled || !isIndexedSegment(seg))
+		return NULL;
+
+	SEGMAP::iterator it = s_segments.find(seg->start_ea);
+	if ((it != s_segments.end()) && (it->second.endEa == seg->end_ea))
+		return &it->second;
+
+	SEGRUNS &sr = s_segments[seg->start_ea];
+	buildSegment(seg, sr);
+	return &sr;
+}
+
+// Update the state of a patched byte
+static void updateByte(ea_t ea)
+{
+	SEGMAP::iterator it = s_segments.upper_bound(ea);
+	if (it == s_segments.begin())
+		return;
+	SEGRUNS &sr = (--it)->second;
+	if (ea >= sr.endEa)
+		return;
+
+	UINT32 offset = (UINT32) (ea - sr.startEa);
+	BOOL nonZero = (is_loaded(ea) && (get_byte(ea) != 0));
+	if (nonZero != sr.isNonZero(offset))
+		sr.flip(offset);
+}
+
+// ======================================================================================
+
+BOOL ZeroRunIndexFindNext(segment_t *seg, ea_t startEa, ea_t endEa, ea_t &hit)
+{
+	SEGRUNS *sr = getSegRuns(seg);
+	if (!sr)
+		return FALSE;
+
+	hit = BADADDR;
+	if (startEa < endEa)
+	{
+		UINT32 offset = (UINT32) (startEa - sr->startEa);
+		size_t count = (std::upper_bound(sr->toggles.begin(), sr->toggles.end(), offset) - sr->toggles.begin());
+		ea_t ea = BADADDR;
+		if (count & 1)
+			ea = startEa;
+		else
+		if (count < sr->toggles.size())
+			ea = (sr->startEa + sr->toggles[count]);
+		if (ea < endEa)
+			hit = ea;
+	}
+	return TRUE;
+}
+
+BOOL ZeroRunIndexFindPrev(segment_t *seg, ea_t startEa, ea_t endEa, ea_t &hit)
+{
+	SEGRUNS *sr = getSegRuns(seg);
+	if (!sr)
+		return FALSE;
+
+	hit = BADADDR;
+	if (startEa < endEa)
+	{
+		UINT32 offset = (UINT32) ((endEa - 1) - sr->startEa);
+		size_t count = (std::upper_bound(sr->toggles.begin(), sr->toggles.end(), offset) - sr->toggles.begin());
+		ea_t ea = BADADDR;
+		if (count & 1)
+			ea = (endEa - 1);
+		else
+		if (count > 0)
+			ea = ((sr->startEa + sr->toggles[count - 1]) - 1);
+		if ((ea != BADADDR) && (ea >= startEa))
+			hit = ea;
+	}
+	return TRUE;
+}
+
+void ZeroRunIndexToggle()
+{
+	if (!s_loaded)
+		loadIndex();
+	s_enabled = !s_enabled;
+	s_dirty = TRUE;
+
+	if (!s_enabled)
+	{
+		s_segments.clear();
+		msg("Utility: Zero run index disabled.\n");
+		return;
+	}
+
+	// Build it all now so we can report the cost
+	msg("Utility: Zero run index enabled, building:\n");
+	TIMESTAMP startTime = GetTimeStamp();
+	size_t totalRuns = 0, totalMemory = 0;
+	int segCount = get_segm_qty();
+	for (int n = 0; n < segCount; n++)
+	{
+		segment_t *seg = getnseg(n);
+		if (SEGRUNS *sr = getSegRuns(seg))
+		{
+			qstring segName;
+			get_segm_name(&segName, seg);
+			size_t memory = (sr->toggles.capacity() * sizeof(UINT32));
+			char buffer[32], buffer2[32];
+			msg(" \"%s\": %s runs, %s bytes, %s.\n", segName.c_str(), NumberCommaString((sr->toggles.size() + 1), buffer), NumberCommaString(memory, buffer2), TimeString(sr->buildTime));
+			totalRuns += (sr->toggles.size() + 1);
+			totalMemory += (memory + sizeof(SEGRUNS));
+		}
+	}
+
+	char buffer[32], buffer2[32];
+	msg("Done. %s runs using %s bytes in %s.\n", NumberCommaString(totalRuns, buffer), NumberCommaString(totalMemory, buffer2), TimeString(GetTimeStamp() - startTime));
+}
+
+// ======================================================================================
+
+struct zerorun_listener_t : public event_listener_t
+{
+	virtual ssize_t idaapi on_event(ssize_t code, va_list va) override
+	{
+		switch (code)
+		{
+			case idb_event::byte_patched:
+			if (!s_loaded)
+				loadIndex();
+			if (s_enabled)
+				updateByte(va_arg(va, ea_t));
+			break;
+
+			case idb_event::segm_added:
+			{
+				segment_t *seg = va_arg(va, segment_t*);
+				invalidateRange(seg->start_ea, seg->end_ea);
+			}
+			break;
+
+			case idb_event::segm_deleted:
+			{
+				ea_t startEa = va_arg(va, ea_t);
+				ea_t endEa = va_arg(va, ea_t);
+				invalidateRange(startEa, endEa);
+			}
+			break;
+
+			case idb_event::segm_start_changed:
+			case idb_event::segm_end_changed:
+			{
+				segment_t *seg = va_arg(va, segment_t*);
+				ea_t oldEa = va_arg(va, ea_t);
+				invalidateRange(std::min(seg->start_ea, oldEa), std::max(seg->end_ea, oldEa));
+			}
+			break;
+
+			// Additional file loaded, or segments moved; we can't tell which bytes changed
+			case idb_event::loader_finished:
+			case idb_event::segm_moved:
+			case idb_event::allsegs_moved:
+			s_segments.clear();
+			break;
+
+			case idb_event::savebase:
+			if (s_dirty)
+				saveIndex();
+			break;
+
+			case idb_event::closebase:
+			resetIndex();
+			break;
+		};
+		return 0;
+	}
+};
+static zerorun_listener_t s_listener;
+
+void ZeroRunIndexInit()
+{
+	hook_event_listener(HT_IDB, &s_listener);
+}
+
+void ZeroRunIndexTerm()
+{
+	unhook_event_listener(HT_IDB, &s_listener);
+	resetIndex();
+}
@@ -0,0 +1,13 @@
+// Optional per-segment run-length map of zero/non-zero byte spans for the NotZ commands
+#pragma once
+
+void ZeroRunIndexInit();
+void ZeroRunIndexTerm();
+
+// Enable or disable the index for the current database, reports memory use and build time when enabled
+void ZeroRunIndexToggle();
+
+// Find the first/last non-zero byte in the segment range [startEa, endEa).
+// Returns FALSE if the index is disabled or doesn't cover the segment, the caller should scan instead.
+BOOL ZeroRunIndexFindNext(segment_t *seg, ea_t startEa, ea_t endEa, ea_t &hit);
+BOOL ZeroRunIndexFindPrev(segment_t *seg, ea_t startEa, ea_t endEa, ea_t &hit);
@@ -3,16 +3,25 @@
 // By: Sirmabus 2014, updated 1/2025
 #include "StdAfx.h"
 #include "resource.h"
+#include "AnchorIndex.h"
+#include "NotZeroScan.h"
+#include "ValueSearch.h"
+#include "TypeRunIndex.h"
+#include "ByteRunScan.h"
+#include "NavCache.h"
+#include "ZeroRunIndex.h"
+#include "DataFill.h"
+#include "TableScan.h"
+#include "CloneNamer.h"
+#include "StubRenamer.h"
+#include "StubFingerprints.h"
+#include "BatchReport.h"
+#include "IdaDatabase.h"
+#include "Telemetry.h"
 
 #include <algorithm>
 #include <vector>
 
-
-// From SDK "bytes.hpp"
-const UINT32 FF_REF  = 0x00001000; // has references
-const UINT32 FF_NAME = 0x00004000; // Has name ?
-const UINT32 FF_LABL = 0x00008000; // Has dummy name?
-
 // run(cmd)
 enum COMMAND
 {
@@ -23,15 +32,72 @@ enum COMMAND
     CMD_SetDataDwords = 5, // Set at current address run of DWORDs
     CMD_SetDataQwords = 6, // Set at current address run of QWORDs
     CMD_StubRenamer   = 7, // Automatically names common short function stubs for clarity. (from formerly the " Stub Namer plug-in")
+    CMD_FindNextCodeRef  = 8,  // Next address with a code xref
+    CMD_FindPrevCodeRef  = 9,  // Previous address with a code xref
+    CMD_FindNextDataRef  = 10, // Next address with a data xref
+    CMD_FindPrevDataRef  = 11, // Previous address with a data xref
+    CMD_FindNextUserName = 12, // Next address with a user name
+    CMD_FindPrevUserName = 13, // Previous address with a user name
+    CMD_BenchmarkNotZ    = 14, // Time the bulk not zero scan against the original per-item loop
+    CMD_ToggleZeroIndex  = 15, // Enable/disable the zero run index used by the NotZ commands
+    CMD_SetStructArray   = 16, // Set at current address run of detected struct records
+    CMD_StubRenamerDirty = 17, // Stub renamer over only the functions changed since the last run
+    CMD_StubRenamerVerify = 18, // Full stub renamer classification, reports what a full run would still name
+    CMD_BatchStubNamer   = 19, // Headless stub renamer with a JSON report, for batch runs (see "BatchRun.py")
+    CMD_BatchSurvey      = 20, // Same plus the data fill survey
+    CMD_ExportSnapshot   = 21, // Write a database snapshot for the portable core tools
+    CMD_ToggleTelemetry  = 22, // Turn the per command telemetry recording on/off (see "Telemetry.h")
+    CMD_TelemetryReport  = 23, // Dump the recorded command telemetry to the output window
+    CMD_TelemetryExportCSV = 24, // Write the recorded command telemetry to a CSV file
+    CMD_FindNextXRefN    = 25, // Jump forward over N xref labels at once, asks for N
+    CMD_FindPrevXRefN    = 26, // Jump backwards over N xref labels
+    CMD_FindNextNotZN    = 27, // Jump forward over N not zero items
+    CMD_FindPrevNotZN    = 28, // Jump backwards over N not zero items
+    CMD_AutoFormatSegment = 29, // Format every unformatted run in the current segment by its content
+    CMD_AutoFormatAll    = 30, // Same over all the data segments
+    CMD_AutoFormatDryRun = 31, // Just report what the auto-format over all the data segments would do
+    CMD_PointerTables    = 32, // Find the vtables and other code pointer tables in the data segments, format and name them
+    CMD_PointerTablesDryRun = 33, // Just report the pointer tables found
+    CMD_CloneNamer       = 34, // Cluster the byte identical small functions and name each cluster's members from a shared prefix
+    CMD_CloneNamerDryRun = 35, // Just report the clone clusters
+    CMD_ExportFingerprints = 36, // Save the small functions' user names to the cross database fingerprint file for the stub namer
+    CMD_FindNextValue    = 37, // Next aligned DWORD/QWORD equal to, in the range of, or matching the mask of the value search query
+    CMD_FindPrevValue    = 38, // Previous one
+    CMD_SetValueQuery    = 39, // Ask for a new value search query
+    CMD_FindNextTypeChange = 40, // Next address where the item kind changes (unknown, code, or data of another type)
+    CMD_FindPrevTypeChange = 41, // Previous one
+    CMD_FindNextPadding  = 42, // Next run of unformatted 0x00, 0xCC or 0x90 alignment padding
+    CMD_FindPrevPadding  = 43, // Previous one
+    CMD_FindNextString   = 44, // Next unformatted ASCII or UTF-16 string
+    CMD_FindPrevString   = 45, // Previous one
+    CMD_ConvertByteRuns  = 46, // Make the padding and string runs in the current segment align directives and string literals
+    CMD_ConvertByteRunsDryRun = 47, // Just report the padding and string runs found
 };
 
+#ifdef UTILITY_TELEMETRY
+// Command names for the telemetry, same as the "plugins.cfg" ones
+static LPCSTR commandName(size_t cmd)
+{
+    static const LPCSTR names[] =
+    {
+        "Unknown", "FindNextXRef", "FindPrevXRef", "FindNextNotZ", "FindPrevNotZ", "SetDataDwords", "SetDataQwords", "StubNamer",
+        "FindNextCodeRef", "FindPrevCodeRef", "FindNextDataRef", "FindPrevDataRef", "FindNextUserName", "FindPrevUserName",
+        "BenchmarkNotZ", "ToggleZeroIndex", "SetStructArray", "StubNamerDirty", "StubNamerVerify", "BatchStubNamer", "BatchSurvey",
+        "ExportSnapshot", "ToggleTelemetry", "TelemetryReport", "TelemetryExportCSV", "FindNextXRefN", "FindPrevXRefN", "FindNextNotZN",
+        "FindPrevNotZN", "AutoFormatSegment", "AutoFormatAll", "AutoFormatDryRun", "PointerTables", "PointerTablesDryRun",
+        "CloneNamer", "CloneNamerDryRun", "ExportFingerprints", "FindNextValue", "FindPrevValue", "SetValueQuery",
+        "FindNextTypeChange", "FindPrevTypeChange", "FindNextPadding", "FindPrevPadding", "FindNextString", "FindPrevString",
+        "ConvertByteRuns", "ConvertByteRunsDryRun"
+    };
+    return((cmd < _countof(names)) ? names[cmd] : names[0]);
+}
+#endif
+
 static BOOL  bearchedForSortFunc  = FALSE;
 static BOOL  autoSortDisableTogle = FALSE;
 static PVOID idaSortFunction = NULL;
 static HMODULE myModule = NULL;
 
-extern void RunStubNamer();
-
 
 // ======================================================================================
 static plugmod_t* idaapi init()
@@ -40,12 +106,25 @@ static plugmod_t* idaapi init()
 	msg("\n>> Sirmabus utility feature: v%s, built %s.", GetVersionString(MY_VERSION, version).c_str(), __DATE__);
     
     GetModuleHandleEx((GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT | GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS), (LPCTSTR) &init, &myModule);       
+    AnchorIndexInit();
+    NavCacheInit();
+    TypeRunIndexInit();
+    ZeroRunIndexInit();
+    StubNamerInit();
     return PLUGIN_KEEP;
 }
 
 // ======================================================================================
 static void idaapi term()
 {
+    NavCacheTerm();
+    AnchorIndexTerm();
+    TypeRunIndexTerm();
+    IdaDatabaseTerm();
+    ZeroRunIndexTerm();
+    StubNamerTerm();
+    TelemetryTerm();
+
     // Make sure WAV clips are terminated before returning
     if(myModule)	
         PlaySound(NULL, 0, 0);
@@ -67,9 +146,50 @@ static void errorSound()
 
 // --------------------------------------------------------------------------------------
 
+// Jump 'count' next or previous targets, an anchor (xref, name or label), an item that is not all zeros, a searched value or an item kind change.
+// The targets come from the navigation cache, and the ones past the jump are precomputed while idle.
+static void jumpToTarget(BOOL forward, NAVKIND kind, UINT32 count = 1)
+{
+    BOOL bSuccess = FALSE;
+    ea_t eaScreen = get_screen_ea();
+    if(eaScreen != BADADDR)
+    {
+        UINT32 moved;
+        ea_t eaTarget = (forward ? NavCacheNext(kind, eaScreen, count, moved) : NavCachePrev(kind, eaScreen, count, moved));
+        if(eaTarget != BADADDR)
+        {
+            if(moved < count)
+                msg("Utility: Only %u of %u to jump.\n", moved, count);
+            jumpto(eaTarget, -1);
+            NavCachePrefetch(kind, eaTarget, forward);
+            bSuccess = TRUE;
+        }
+    }
+
+    if(bSuccess)
+        clickSound();
+    else
+        errorSound();
+}
+
+// Jump N variant, asks for the count (remembered for the next time)
+static void jumpToTargetN(BOOL forward, NAVKIND kind)
+{
+    static sval_t count = 10;
+    if(!ask_long(&count, "Jump count"))
+        return;
+    if(count < 1)
+    {
+        errorSound();
+        return;
+    }
+    jumpToTarget(forward, kind, (UINT32) std::min(count, (sval_t) UINT_MAX));
+}
+
 bool idaapi run(size_t cmd)
 {
     plat.Configure();
+    TELEMETRY_COMMAND(cmd, commandName(cmd));
 
     //msg("cmd: %d\n", cmd);
     switch(cmd)
@@ -77,339 +197,201 @@ bool idaapi run(size_t cmd)
         // FindNextXRef
         // Jump forward to the next line with an xref or a label
         case CMD_FindNextXRef:
+        jumpToTarget(TRUE, NAV_XREF);
+        break;       
+
+        // FindPrevXRef
+        // Jump backwards to the previous line with an xref or label
+        case CMD_FindPrevXRef:
+        jumpToTarget(FALSE, NAV_XREF);
+        break;
+
+        // Filtered versions of the above
+        case CMD_FindNextCodeRef:
+        jumpToTarget(TRUE, NAV_CODEREF);
+        break;
+
+        case CMD_FindPrevCodeRef:
+        jumpToTarget(FALSE, NAV_CODEREF);
+        break;
+
+        case CMD_FindNextDataRef:
+        jumpToTarget(TRUE, NAV_DATAREF);
+        break;
+
+        case CMD_FindPrevDataRef:
+        jumpToTarget(FALSE, NAV_DATAREF);
+        break;
+
+        case CMD_FindNextUserName:
+        jumpToTarget(TRUE, NAV_USERNAME);
+        break;
+
+        case CMD_FindPrevUserName:
+        jumpToTarget(FALSE, NAV_USERNAME);
+        break;
+       
+        // Find the next data value address forward that is not zero
+        case CMD_FindNextNotZ:
+        jumpToTarget(TRUE, NAV_NOTZERO);
+        break;
+
+        // Find the previous data value address that is not zero
+        case CMD_FindPrevNotZ:
+        jumpToTarget(FALSE, NAV_NOTZERO);
+        break;
+
+        // Find the next/previous value matching the value search query, asks for one the first time
+        case CMD_FindNextValue:
+        case CMD_FindPrevValue:
+        if(HasValueQuery() || AskValueQuery())
+            jumpToTarget((cmd == CMD_FindNextValue), NAV_VALUE);
+        else
+            errorSound();
+        break;
+
+        case CMD_SetValueQuery:
+        if(AskValueQuery())
+            jumpToTarget(TRUE, NAV_VALUE);
+        break;
+
+        // Find the next/previous change of item kind, like unknown to data, DWORDs to QWORDs or the end of a struct array
+        case CMD_FindNextTypeChange:
+        jumpToTarget(TRUE, NAV_TYPECHANGE);
+        break;
+
+        case CMD_FindPrevTypeChange:
+        jumpToTarget(FALSE, NAV_TYPECHANGE);
+        break;
+
+        // Find the next/previous run of alignment padding or unformatted string
+        case CMD_FindNextPadding:
+        jumpToTarget(TRUE, NAV_PADDING);
+        break;
+
+        case CMD_FindPrevPadding:
+        jumpToTarget(FALSE, NAV_PADDING);
+        break;
+
+        case CMD_FindNextString:
+        jumpToTarget(TRUE, NAV_STRINGRUN);
+        break;
+
+        case CMD_FindPrevString:
+        jumpToTarget(FALSE, NAV_STRINGRUN);
+        break;
+
+        // Jump over N at once
+        case CMD_FindNextXRefN:
+        jumpToTargetN(TRUE, NAV_XREF);
+        break;
+
+        case CMD_FindPrevXRefN:
+        jumpToTargetN(FALSE, NAV_XREF);
+        break;
+
+        case CMD_FindNextNotZN:
+        jumpToTargetN(TRUE, NAV_NOTZERO);
+        break;
+
+        case CMD_FindPrevNotZN:
+        jumpToTargetN(FALSE, NAV_NOTZERO);
+        break;
+
+        // Fill data space with DWORDs
+        case CMD_SetDataDwords:
         {
-            BOOL bSuccess = FALSE;
-            ea_t eaScreen = get_screen_ea();            
-            if(eaScreen != BADADDR)
-            {
-                while((eaScreen = next_addr(eaScreen)) != BADADDR)
-                {                   
-                    if(get_flags(eaScreen) & (FF_REF | FF_NAME | FF_LABL))
-                    {                        
-                        jumpto(eaScreen, -1);
-                        bSuccess = TRUE;
-                        break;
-                    }
-                };
-            }     
-
-            if(bSuccess)
+            if(FillDataRun(sizeof(UINT32)))
                 clickSound();
             else
                 errorSound(); 
+            refresh_idaview_anyway();
         }
-        break;       
+        break;
 
-        // FindPrevXRef
-        // Jump backwards to the previous line with an xref or label
-        case CMD_FindPrevXRef:
+        // Fill data space with QWORDs
+        case CMD_SetDataQwords:
         {
-            BOOL bSuccess = FALSE;
-            ea_t eaScreen = get_screen_ea();            
-            if(eaScreen != BADADDR)
-            {
-                while((eaScreen = prev_addr(eaScreen)) != BADADDR)
-                {                   
-                    if(get_flags(eaScreen) & (FF_REF | FF_NAME | FF_LABL))
-                    {                        
-                        jumpto(eaScreen, -1);
-                        bSuccess = TRUE;
-                        break;
-                    }                
-                };
-            }
-
-            if(bSuccess)
+            if(FillDataRun(sizeof(UINT64)))
                 clickSound();
             else
                 errorSound(); 
+            refresh_idaview_anyway();
         }
         break;
-       
-        // Find the next data value address forward that is not zero
-        case CMD_FindNextNotZ:
+
+        // Fill data space with an array of records
+        case CMD_SetStructArray:
         {
-            BOOL bSuccess = FALSE;
-            ea_t eaAddr = get_screen_ea();            
-            if(eaAddr != BADADDR)
-            {            
-                while((eaAddr = next_visea(eaAddr)) != BADADDR)
-                {                  
-                    // Test typical BYTE to QWORD size values
-                    asize_t size = get_item_size(eaAddr);
-                    if(size <= sizeof(UINT32))
-                    {
-                        uval_t v = 0;
-                        if(get_data_value(&v, eaAddr, size))
-                        {
-                            if(v != 0)
-                            {
-                                jumpto(eaAddr, -1);
-                                bSuccess = TRUE;                            
-                                break;
-                            }
-                        }
-                    }
-                    else
-                    // Test odd size block value
-                    if(PVOID pBuffer = _aligned_malloc(size, 32))
-                    {
-                        if(get_bytes(pBuffer, size, eaAddr, GMB_READALL))
-                        {
-                            PBYTE p = (PBYTE) pBuffer;
-                            while(size--)
-                            {
-                                if(*p++)
-                                {
-                                    bSuccess = TRUE;
-                                    break;
-                                }
-                            };
-                        }
-                        _aligned_free(pBuffer);
-
-                        if(bSuccess)
-                        {
-                            jumpto(eaAddr, -1);                                            
-                            break;
-                        }
-                    }                                                        
-                };
-            }     
-
-            if(bSuccess)
+            if(FillStructArray())
                 clickSound();
             else
-                errorSound();   
+                errorSound();
+            refresh_idaview_anyway();
         }
         break;
 
-        // Find the previous data value address that is not zero
-        case CMD_FindPrevNotZ:
+        // Format all the unformatted runs by content
+        case CMD_AutoFormatSegment:
+        case CMD_AutoFormatAll:
         {
-            BOOL bSuccess = FALSE;
-            ea_t eaAddr = get_screen_ea();            
-            if(eaAddr != BADADDR)
-            {            
-                while((eaAddr = prev_visea(eaAddr)) != BADADDR)
-                {                     
-                    asize_t size = get_item_size(eaAddr);
-                    if(size <= sizeof(UINT32))
-                    {
-                        uval_t v = 0;
-                        if(get_data_value(&v, eaAddr, size))
-                        {
-                            if(v != 0)
-                            {
-                                jumpto(eaAddr, -1);
-                                bSuccess = TRUE;                            
-                                break;
-                            }
-                        }
-                    }
-                    else                   
-                    if(PVOID pBuffer = _aligned_malloc(size, 32))
-                    {
-                        if(get_bytes(pBuffer, size, eaAddr))
-                        {
-                            PBYTE p = (PBYTE) pBuffer;
-                            while(size--)
-                            {
-                                if(*p++)
-                                {
-                                    bSuccess = TRUE;
-                                    break;
-                                }
-                            };
-                        }
-                        _aligned_free(pBuffer);
-
-                        if(bSuccess)
-                        {
-                            jumpto(eaAddr, -1);                                            
-                            break;
-                        }
-                    }                                                        
-                };
-            }     
-
-            if(bSuccess)
+            if(AutoFormatRuns((cmd == CMD_AutoFormatAll), FALSE))
                 clickSound();
             else
-                errorSound();   
+                errorSound();
+            refresh_idaview_anyway();
         }
         break;
 
-        // Fill data space with DWORDs
-        case CMD_SetDataDwords:
+        case CMD_AutoFormatDryRun:
+        AutoFormatRuns(TRUE, TRUE);
+        break;
+
+        // Format the pointer tables to code in one go
+        case CMD_PointerTables:
         {
-            BOOL success = FALSE;
-            ea_t eaScreen = get_screen_ea();            
-            if(eaScreen != BADADDR)
-            {                      
-                // Don't allow fill operation over code
-                if(!is_code(get_flags(eaScreen)))
-                {
-                    // Walk backward to find start of selection
-                    ea_t eaStart = BADADDR, eaLast = BADADDR, eaWalk = eaScreen;               
-                    do 
-                    {
-                        flags64_t flags = get_flags(eaWalk);                          
-                        if((flags & (FF_REF | FF_NAME | FF_LABL)) || is_code(flags))                  
-                        {
-                            eaStart = eaWalk;
-                            break;
-                        }
-                        else
-                        {
-                            eaLast = eaWalk;
-                            eaWalk = prev_visea(eaWalk);
-                        }
-
-                    } while(eaWalk != BADADDR);
-
-                    // Use last good address, we are probably at the top of the segment
-                    // TODO: We could check the segment bounds if this is wrong
-                    if(eaStart == BADADDR)
-                        eaStart = eaLast;
-
-                    // Should be at align 4
-                    if((eaStart & (4 -1)) == 0)
-                    {                        
-                        // Walk forward past the screen address to find the end of the section
-                        ea_t eaEnd = BADADDR;
-                        if(eaStart != BADADDR)
-                        {
-                            ea_t eaWalk = next_visea(eaScreen); 
-                            ea_t eaLast = eaWalk;
-
-                            do 
-                            {
-                                flags64_t flags = get_flags(eaWalk);                              
-                                if((flags & (FF_REF | FF_NAME | FF_LABL)) || is_code(flags))                    
-                                {
-                                    eaEnd = eaWalk;
-                                    break;
-                                }
-                                else
-                                {
-                                    eaLast = eaWalk;
-                                    eaWalk = next_visea(eaWalk);
-                                }
-
-                            } while(eaWalk != BADADDR);                   
-                        }
-
-                        // Found our extents, now fill
-                        if(((eaStart != BADADDR) && (eaEnd != BADADDR)) && ((eaEnd - eaScreen) >= sizeof(UINT32)))
-                        {
-                            UINT32 count = (UINT32) ((eaEnd - eaStart) / sizeof(UINT32));
-                            msg("Utility: DWORD fill: %llX to %llX, count: %u\n", eaStart, eaEnd, count);
-                            while(count--){ create_dword(eaStart, sizeof(UINT32)); eaStart += sizeof(UINT32); };
-                            success = TRUE;
-                        }  
-
-                    }
-                    else
-                        msg("Utility: ** Start address %014llX <click me> is not align 4, aborted. **\n", eaStart);
-                }               
-                else
-                    msg("Utility: ** Code here!, aborted. **\n");                
-            }          
-
-            if(success)
+            if(RunTableScan(FALSE))
                 clickSound();
             else
-                errorSound(); 
+                errorSound();
             refresh_idaview_anyway();
         }
         break;
 
-        // Fill data space with QWORDs
-        case CMD_SetDataQwords:
+        case CMD_PointerTablesDryRun:
+        RunTableScan(TRUE);
+        break;
+
+        // Name the clusters of identical small functions
+        case CMD_CloneNamer:
         {
-            BOOL success = FALSE;
-            ea_t eaScreen = get_screen_ea();            
-            if(eaScreen != BADADDR)
-            {                      
-                // Don't allow fill operation over code
-                if(!is_code(get_flags(eaScreen)))
-                {
-                    // Walk backward to find start of selection
-                    ea_t eaStart = BADADDR, eaLast = BADADDR, eaWalk = eaScreen;               
-                    do 
-                    {
-                        flags64_t flags = get_flags(eaWalk);                          
-                        if((flags & (FF_REF | FF_NAME | FF_LABL)) || is_code(flags))                  
-                        {
-                            eaStart = eaWalk;
-                            break;
-                        }
-                        else
-                        {
-                            eaLast = eaWalk;
-                            eaWalk = prev_visea(eaWalk);
-                        }
-
-                    } while(eaWalk != BADADDR);
-
-                    // Use last good address, we are probably at the top of the segment
-                    // TODO: We could check the segment bounds if this is wrong
-                    if(eaStart == BADADDR)
-                        eaStart = eaLast;
-
-                    // Should be at align 8
-                    if((eaStart & (8 - 1)) == 0)
-                    {                        
-                        // Walk forward past the screen address to find the end of the section
-                        ea_t eaEnd = BADADDR;
-                        if(eaStart != BADADDR)
-                        {
-                            ea_t eaWalk = next_visea(eaScreen); 
-                            ea_t eaLast = eaWalk;
-
-                            do 
-                            {
-                                flags64_t flags = get_flags(eaWalk);                              
-                                if((flags & (FF_REF | FF_NAME | FF_LABL)) || is_code(flags))                    
-                                {
-                                    eaEnd = eaWalk;
-                                    break;
-                                }
-                                else
-                                {
-                                    eaLast = eaWalk;
-                                    eaWalk = next_visea(eaWalk);
-                                }
-
-                            } while(eaWalk != BADADDR);                   
-                        }
-
-                        // Found our extents, now fill
-                        if(((eaStart != BADADDR) && (eaEnd != BADADDR)) && ((eaEnd - eaScreen) >= sizeof(UINT32)))
-                        {
-                            UINT32 count = (UINT32) ((eaEnd - eaStart) / sizeof(UINT64));
-                            msg("Utility: QWORD fill: %014llX to %014llX, count: %u\n", eaStart, eaEnd, count);
-                            while (count--){ create_qword(eaStart, sizeof(UINT64)); eaStart += sizeof(UINT64); };
-                            success = TRUE;
-                        }  
-
-                    }
-                    else
-                        msg("Utility: ** Start address %014llX <click me> is not align 8, aborted. **\n", eaStart);
-                }               
-                else
-                    msg("Utility: ** Code here!, aborted. **\n");                
-            }          
-
-            if(success)
+            if(RunCloneNamer(FALSE))
                 clickSound();
             else
-                errorSound(); 
+                errorSound();
+            refresh_idaview_anyway();
+        }
+        break;
+
+        case CMD_CloneNamerDryRun:
+        RunCloneNamer(TRUE);
+        break;
+
+        // Convert the segment's padding and string runs in one go
+        case CMD_ConvertByteRuns:
+        {
+            if(ConvertByteRuns(FALSE))
+                clickSound();
+            else
+                errorSound();
             refresh_idaview_anyway();
         }
         break;
 
+        case CMD_ConvertByteRunsDryRun:
+        ConvertByteRuns(TRUE);
+        break;
+
         // Run the function stub renamer
         case CMD_StubRenamer:
         {
@@ -417,6 +399,57 @@ bool idaapi run(size_t cmd)
             RunStubNamer();
         }
         break;
+
+        case CMD_StubRenamerDirty:
+        {
+            msg("Utility: Running Stub namer on changed functions:\n");
+            RunStubNamerDirty(FALSE);
+        }
+        break;
+
+        case CMD_StubRenamerVerify:
+        {
+            msg("Utility: Verifying Stub namer:\n");
+            VerifyStubNamer();
+        }
+        break;
+
+        // Batch runs, no UI or sounds
+        case CMD_BatchStubNamer:
+        RunBatchReport(FALSE);
+        break;
+
+        case CMD_BatchSurvey:
+        RunBatchReport(TRUE);
+        break;
+
+        case CMD_ExportSnapshot:
+        ExportSnapshot();
+        break;
+
+        case CMD_ExportFingerprints:
+        ExportFingerprints();
+        break;
+
+        case CMD_BenchmarkNotZ:
+        BenchmarkNotZero();
+        break;
+
+        case CMD_ToggleZeroIndex:
+        ZeroRunIndexToggle();
+        break;
+
+        case CMD_ToggleTelemetry:
+        TelemetryToggle();
+        break;
+
+        case CMD_TelemetryReport:
+        TelemetryReport();
+        break;
+
+        case CMD_TelemetryExportCSV:
+        TelemetryExportCSV();
+        break;
 		
         default:
         {